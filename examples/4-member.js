@@ -1,17 +1,28 @@
-let arr1 = [ null, false, true, 3.14, "hello" ];
-let mbr1 = arr1[3];
-// let mbr2 = arr1[-1];
-// let mbr3 = arr1["foo"];
-let obj1 = {"name" : "tom", "age" : 31};
-let mbr4 = obj1.name;
-let mbr5 = obj1["age"];
-let mbr6 = obj1.foo;
-// let mbr7 = obj1[1234];
-let mbr8 = obj1?.foo?.bar;
-arr1[100] = "bingo";
-let obj2 = {"arr2" : [ obj1, [...arr1 ] ]};
-console.log(arr1); // test if node.js skip null
-
-// test array index
-let a = [1, 2, 3];
-print(a[-1], a[-2.3], a[1], a[2.3], a[100], a[100.1]);
\ No newline at end of file
+let arr1 = [ null, false, true, 3.14, "hello" ];
+let mbr1 = arr1[3];
+// let mbr2 = arr1[-1];
+// let mbr3 = arr1["foo"];
+let obj1 = {"name" : "tom", "age" : 31};
+let mbr4 = obj1.name;
+let mbr5 = obj1["age"];
+let mbr6 = obj1.foo;
+// let mbr7 = obj1[1234];
+let mbr8 = obj1?.foo?.bar;
+arr1[100] = "bingo";
+let obj2 = {"arr2" : [ obj1, [...arr1 ] ]};
+console.log(arr1); // test if node.js skip null
+
+// test array index
+let a = [1, 2, 3];
+print(a[-1], a[-2.3], a[1], a[2.3], a[100], a[100.1]);
+
+// deleting member while looping it visits every other member once
+let obj3 = {"a" : 1, "b" : 2, "c" : 3, "d" : 4};
+let keys = [];
+for (let k in obj3) {
+    push(keys, k);
+    if (k == "b") {
+        obj3["a"] = null;
+    }
+}
+print(keys);
\ No newline at end of file
@@ -237,6 +237,19 @@
 // sort(arr, function(lhs, rhs) { return lhs - rhs; });
 // arr::tojson()::print();
 
+// // garbage may be collected inside callbacks, map and sort keep their results and elements reachable
+// let squares = [ 5, 3, 9, 2, 8 ]::map(function(elem) {
+//     for (let i = 0; i < 10000; i++) {
+//         let tmp = { "i" : i };
+//     }
+//     return { "square" : elem * elem };
+// });
+// sort(squares, function(lhs, rhs) {
+//     let tmp = [ lhs, rhs ];
+//     return lhs.square - rhs.square;
+// });
+// squares::tojson()::print();
+
 // let list = [
 //     "1000X Radonius Maximus",
 //     "10X Radonius",
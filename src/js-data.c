@@ -1,933 +1,1569 @@
-/*
-Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
-
-This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
-
-This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
-
-You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
-*/
-
-#include "js-data.h"
-
-#define X(name) #name,
-static const char *const _value_type_names[] = {js_value_type_list};
-#undef X
-
-void js_map_dump(struct js_kv_pair *base, size_t length, size_t capacity) {
-    size_t i;
-    printf("length=%zu capacity=%zu\n", length, capacity);
-    for (i = 0; i < capacity; i++) {
-        struct js_kv_pair *node = base + i;
-        printf("    %zu %.*s %s\n", i, (int)node->key.length, node->key.base, _value_type_names[node->value.type]);
-    }
-}
-
-static size_t _first_hash(const char *string, uint16_t length, size_t mask) {
-    size_t hash = 0;
-    for (uint16_t i = 0; i < length; i++) {
-        hash = (hash + (hash << 4) + string[i]) & mask;
-    }
-    return hash;
-}
-
-static size_t _next_hash(size_t hash, size_t mask) {
-    // hash = hash * 5 + 1 can perfectly cover 0-2 pow
-    // https://tieba.baidu.com/p/8968552557
-    return (hash + (hash << 4) + 1) & mask;
-}
-
-static struct js_kv_pair *_find_empty(struct js_kv_pair *base, size_t capacity, const char *key, uint16_t key_length) {
-    size_t mask = capacity - 1;
-    for (size_t repeat = 0, hash = _first_hash(key, key_length, mask); repeat < capacity; repeat++, hash = _next_hash(hash, mask)) {
-        struct js_kv_pair *node = base + hash;
-        // js_info("repeat=%d hash=%d", repeat, hash);
-        if (!node->key.base && !node->value.type) {
-            return node;
-        }
-    }
-    fatal("Whole loop ended, this shouldn't happen");
-}
-
-// BUG: Stage 2 should also check rehash
-// void js_map_put(struct js_kv_pair **base, size_t *length, size_t *capacity, const char *key, uint16_t key_length, struct js_value value) {
-//     // js_map_dump(*base, *length, *capacity);
-//     // printf("key=%.*s, value=%s\n", key_length, key, _value_type_names[value.type]);
-//     bool next_stage = false;
-//     struct js_kv_pair *recorded;
-//     if (!*base) { // first allocate
-//         buffer_alloc(*base, *length, *capacity, 2);
-//     }
-//     size_t mask = (*capacity) - 1;
-//     for (size_t repeat = 0, hash = _first_hash(key, key_length, mask); repeat < *capacity; repeat++, hash = _next_hash(hash, mask)) {
-//         struct js_kv_pair *node = *base + hash;
-//         // js_info("repeat=%d hash=%d", repeat, hash);
-//         if (node->key.base == NULL) { // k is empty
-//             if (node->value.type != 0) { // v not empty
-//                 fatal("Key is NULL but value not NULL, this shouldn't happen");
-//             } else {
-//                 if (value.type != 0) {
-//                     if (next_stage) {
-//                         goto next_stage_done;
-//                     } else {
-//                         size_t newlen = *length + 1;
-//                         size_t reqcap = newlen << 1;
-//                         if (*capacity >= reqcap) {
-//                             string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
-//                             node->value = value;
-//                             *length = newlen;
-//                             // printf("++ *length=%zu\n", *length);
-//                             return;
-//                         } else {
-//                             // rehash
-//                             struct js_kv_pair *newbase = NULL;
-//                             size_t newlen = 0;
-//                             size_t newcap = 0;
-//                             size_t i;
-//                             buffer_alloc(newbase, newlen, newcap, reqcap);
-//                             for (i = 0; i < *capacity; i++) {
-//                                 node = *base + i;
-//                                 if (node->key.base && node->value.type) {
-//                                     struct js_kv_pair *newnode = _find_empty(newbase, newcap, node->key.base, node->key.length);
-//                                     *newnode = *node;
-//                                     newlen++;
-//                                 }
-//                             }
-//                             node = _find_empty(newbase, newcap, key, key_length);
-//                             string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
-//                             node->value = value;
-//                             newlen++;
-//                             free(*base);
-//                             *base = newbase;
-//                             *length = newlen;
-//                             *capacity = newcap;
-//                             return;
-//                         }
-//                     }
-//                 } else {
-//                     return;
-//                 }
-//             }
-//         } else if (node->key.length == key_length && memcmp(node->key.base, key, key_length) == 0) { // matched
-//             if (node->value.type != 0) {
-//                 if (value.type == 0) {
-//                     (*length)--;
-//                     // printf("-- *length=%zu\n", *length);
-//                 }
-//                 node->value = value;
-//             } else {
-//                 if (value.type != 0) {
-//                     (*length)++;
-//                     // printf("++ *length=%zu\n", *length);
-//                     node->value = value;
-//                 }
-//             }
-//             return;
-//         } else { // k not matched
-//             if (next_stage) {
-//                 continue;
-//             } else if (node->value.type != 0) {
-//                 continue;
-//             } else {
-//                 recorded = node;
-//                 next_stage = true;
-//                 // string_buffer_clear(node->key.base, node->key.length, node->key.capacity);
-//                 // string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
-//                 // if (value.type != 0) {
-//                 //     node->value = value;
-//                 //     (*length)++;
-//                 //     // printf("++ *length=%zu\n", *length);
-//                 // }
-//                 // return;
-//             }
-//         }
-//     }
-//     if (next_stage) {
-//         goto next_stage_done;
-//     }
-//     fatal("Whole loop ended, this shouldn't happen");
-// next_stage_done:
-//     string_buffer_clear(recorded->key.base, recorded->key.length, recorded->key.capacity);
-//     string_buffer_append(recorded->key.base, recorded->key.length, recorded->key.capacity, key, key_length);
-//     recorded->value = value;
-//     (*length)++;
-//     // printf("++ *length=%zu\n", *length);
-// }
-
-// BUGFIX: always check rehash
-void js_map_put_internal(struct js_kv_pair **base, size_t *length, size_t *capacity, const char *key, uint16_t key_length, struct js_value value) {
-    // js_map_dump(*base, *length, *capacity);
-    // printf("key=%.*s, value=%s\n", key_length, key, _value_type_names[value.type]);
-    bool next_stage = false;
-    struct js_kv_pair *recorded = NULL;
-    if (!*base) { // first allocate
-        buffer_alloc(*base, *length, *capacity, 2);
-    }
-    size_t mask = (*capacity) - 1;
-    struct js_kv_pair *node;
-    for (size_t repeat = 0, hash = _first_hash(key, key_length, mask); repeat < *capacity; repeat++, hash = _next_hash(hash, mask)) {
-        node = *base + hash;
-        // js_info("repeat=%d hash=%d", repeat, hash);
-        if (node->key.base == NULL) { // k is empty
-            if (node->value.type != 0) { // v not empty
-                fatal("Key is NULL but value not NULL, this shouldn't happen");
-            } else {
-                if (value.type != 0) {
-                    if (next_stage) {
-                        goto next_stage_done;
-                    } else {
-                        string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
-                        node->value = value;
-                        (*length)++;
-                        // printf("++ *length=%zu\n", *length);
-                        goto check_rehash;
-                    }
-                } else {
-                    return;
-                }
-            }
-        } else if (node->key.length == key_length && memcmp(node->key.base, key, key_length) == 0) { // matched
-            if (node->value.type != 0) {
-                if (value.type == 0) {
-                    (*length)--;
-                    // printf("-- *length=%zu\n", *length);
-                }
-                node->value = value;
-                return;
-            } else {
-                if (value.type != 0) {
-                    (*length)++;
-                    // printf("++ *length=%zu\n", *length);
-                    node->value = value;
-                }
-                goto check_rehash;
-            }
-        } else { // k not matched
-            if (next_stage) {
-                continue;
-            } else if (node->value.type != 0) {
-                continue;
-            } else {
-                recorded = node;
-                next_stage = true;
-                // string_buffer_clear(node->key.base, node->key.length, node->key.capacity);
-                // string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
-                // if (value.type != 0) {
-                //     node->value = value;
-                //     (*length)++;
-                //     // printf("++ *length=%zu\n", *length);
-                // }
-                // return;
-            }
-        }
-    }
-    if (next_stage) {
-        goto next_stage_done;
-    }
-    fatal("Whole loop ended, this shouldn't happen");
-next_stage_done:
-    string_buffer_clear(recorded->key.base, recorded->key.length, recorded->key.capacity);
-    string_buffer_append(recorded->key.base, recorded->key.length, recorded->key.capacity, key, key_length);
-    recorded->value = value;
-    (*length)++;
-    // printf("++ *length=%zu\n", *length);
-check_rehash:
-    size_t reqcap = *length << 1;
-    if (*capacity < reqcap) {
-        // rehash
-        struct js_kv_pair *newbase = NULL;
-        size_t newlen = 0;
-        size_t newcap = 0;
-        size_t i;
-        buffer_alloc(newbase, newlen, newcap, reqcap);
-        for (i = 0; i < *capacity; i++) {
-            node = *base + i;
-            if (node->key.base) {
-                if (node->value.type) {
-                    struct js_kv_pair *newnode = _find_empty(newbase, newcap, node->key.base, node->key.length);
-                    *newnode = *node;
-                    newlen++;
-                } else {
-                    free(node->key.base);
-                }
-            }
-        }
-        free(*base);
-        *base = newbase;
-        *length = newlen;
-        *capacity = newcap;
-    }
-}
-
-// void js_map_put_sz(struct js_kv_pair **base, size_t *length, size_t *capacity, const char *key, struct js_value value) {
-//     js_map_put(base, length, capacity, key, (uint16_t)strlen(key), value);
-// }
-
-// v can be NULL
-struct js_value js_map_get(struct js_kv_pair *base, size_t length, size_t capacity, const char *key, uint16_t key_length) {
-    size_t mask = capacity - 1;
-    size_t hash;
-    size_t repeat;
-    for (repeat = 0, hash = _first_hash(key, key_length, mask); repeat < capacity; repeat++, hash = _next_hash(hash, mask)) {
-        struct js_kv_pair *node = base + hash;
-        // printf("key=%.*s hash=%zu\n", key_length, key, hash);
-        if (node->key.base == NULL) {
-            // printf("k is NULL\n");
-            return (struct js_value){0};
-        } else if (node->key.length == key_length && memcmp(node->key.base, key, key_length) == 0) {
-            // printf("k matched\n");
-            return node->value;
-        }
-    }
-    // log_debug("Whole loop ended");
-    return (struct js_value){0};
-}
-
-struct js_value js_map_get_sz(struct js_kv_pair *base, size_t length, size_t capacity, const char *key) {
-    return js_map_get(base, length, capacity, key, (uint16_t)strlen(key));
-}
-
-// void js_map_free_internal(struct js_kv_pair **base, size_t *length, size_t *capacity) {
-//     for (size_t i = 0; i < *capacity; i++) {
-//         struct js_kv_pair *node = *base + i;
-//         if (node->key.base) {
-//             free(node->key.base);
-//         }
-//     }
-//     buffer_free(*base, *length, *capacity);
-// }
-
-struct js_value js_null() {
-    return (struct js_value){.type = vt_null};
-}
-
-struct js_value js_boolean(bool boolean) {
-    return (struct js_value){.type = vt_boolean, .boolean = boolean};
-}
-
-struct js_value js_number(double number) {
-    return (struct js_value){.type = vt_number, .number = number};
-}
-
-struct js_value js_scripture_sz(const char *sz) {
-    return (struct js_value){.type = vt_scripture,
-        .scripture.base = (char *)sz,
-        .scripture.length = (uint32_t)strlen(sz)};
-}
-
-// create an empty skeleton value of managed type, and hook it to heap
-struct js_value js_alloc_managed(struct js_heap *heap, enum js_value_type type) {
-    enforce(type == vt_string || type == vt_array || type == vt_object || type == vt_function || type == vt_c_data);
-    struct js_value ret = {.type = type};
-    ret.managed = alloc(struct js_managed_value, 1);
-    ret.managed->type = type;
-    buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    return ret;
-}
-
-struct js_value js_string(struct js_heap *heap, const char *str, size_t slen) {
-    struct js_value ret = js_alloc_managed(heap, vt_string);
-    // struct js_value ret = {.type = vt_string};
-    // ret.managed = alloc(struct js_managed_value, 1);
-    // ret.managed->type = vt_string;
-    // make sure string is always not NULL, or in some C lib functions, will cause error
-    ret.managed->string.base = alloc(char, 1);
-    ret.managed->string.capacity = 1;
-    string_buffer_append(ret.managed->string.base, ret.managed->string.length, ret.managed->string.capacity, str, slen);
-    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    return ret;
-}
-
-struct js_value js_string_sz(struct js_heap *heap, const char *str) {
-    return js_string(heap, str, strlen(str));
-}
-
-// mostly for formatted error messages
-struct js_value js_string_f(struct js_heap *heap, const char *fmt, ...) {
-    //     struct js_value ret = {.type = vt_string};
-    //     ret.managed = alloc(struct js_managed_value, 1);
-    //     ret.managed->type = vt_string;
-    //     va_list args;
-    //     va_start(args, fmt);
-    //     string_buffer_append_fv(ret.managed->string.base, ret.managed->string.length, ret.managed->string.capacity, fmt, args);
-    //     va_end(args);
-    //     buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    //     return ret;
-    struct print_stream out = {.type = string_stream};
-    va_list args;
-    va_start(args, fmt);
-    vprintf_to_stream(&out, fmt, args);
-    va_end(args);
-    struct js_value ret = js_alloc_managed(heap, vt_string);
-    ret.managed->string.base = out.base;
-    ret.managed->string.length = out.length;
-    ret.managed->string.capacity = out.capacity;
-    return ret;
-}
-
-struct js_value js_array(struct js_heap *heap) {
-    struct js_value ret = js_alloc_managed(heap, vt_array);
-    // struct js_value ret = {.type = vt_array};
-    // ret.managed = alloc(struct js_managed_value, 1);
-    // ret.managed->type = vt_array;
-    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    return ret;
-}
-
-void js_push_array_element(struct js_value *container, struct js_value element) {
-    buffer_push(container->managed->array.base, container->managed->array.length, container->managed->array.capacity, element.type == vt_null ? (struct js_value){0} : element);
-}
-
-void js_put_array_element(struct js_value *container, size_t index, struct js_value element) {
-    if (element.type == vt_null) { // special treat to prevent useless expand
-        if (index < container->managed->array.length) {
-            container->managed->array.base[index].type = 0;
-        } // else do nothing
-    } else {
-        buffer_put(container->managed->array.base, container->managed->array.length, container->managed->array.capacity, index, element);
-    }
-}
-
-struct js_value js_get_managed_array_element(struct js_managed_value *managed, size_t index) {
-    if (index < managed->array.length) {
-        struct js_value ret = managed->array.base[index];
-        return ret.type == 0 ? js_null() : ret;
-    } else {
-        return js_null();
-    }
-}
-
-struct js_value js_object(struct js_heap *heap) {
-    struct js_value ret = js_alloc_managed(heap, vt_object);
-    // struct js_value ret = {.type = vt_object};
-    // ret.managed = alloc(struct js_managed_value, 1);
-    // ret.managed->type = vt_object;
-    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    return ret;
-}
-
-void js_put_object_value(struct js_value *container, const char *key, uint16_t key_length, struct js_value element) {
-    js_map_put(container->managed->object.base, container->managed->object.length, container->managed->object.capacity, key, key_length, element.type == vt_null ? (struct js_value){0} : element);
-}
-
-struct js_value js_get_object_value(struct js_value *container, const char *key, uint16_t key_length) {
-    struct js_value ret;
-    ret = js_map_get(container->managed->object.base, container->managed->object.length, container->managed->object.capacity, key, key_length);
-    return ret.type == 0 ? js_null() : ret;
-}
-
-struct js_value js_function(struct js_heap *heap, uint32_t ingress) {
-    struct js_value ret = js_alloc_managed(heap, vt_function);
-    // struct js_value ret = {.type = vt_function};
-    // ret.managed = alloc(struct js_managed_value, 1);
-    // ret.managed->type = vt_function;
-    ret.managed->function.ingress = ingress;
-    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    return ret;
-}
-
-bool js_is_function(struct js_value *value) {
-    return value->type == vt_function || value->type == vt_c_function;
-}
-
-struct js_value js_c_data(struct js_heap *heap, void *data, void (*mark)(void *), void (*sweep)(void *)) {
-    struct js_value ret = js_alloc_managed(heap, vt_c_data);
-    // struct js_value ret = {.type = vt_c_data};
-    // ret.managed = alloc(struct js_managed_value, 1);
-    // ret.managed->type = vt_c_data;
-    ret.managed->c_data.data = data;
-    ret.managed->c_data.mark = mark;
-    ret.managed->c_data.sweep = sweep;
-    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
-    return ret;
-}
-
-void js_mark(struct js_value *value) {
-    // printf("js_mark: ");
-    // js_dump_value(pjs, value);
-    // printf("\n");
-    switch (value->type) {
-    case vt_string:
-        value->managed->in_use = 1;
-        break;
-    case vt_array:
-        if (!value->managed->in_use) {
-            value->managed->in_use = 1;
-            buffer_for_each(value->managed->array.base, value->managed->array.length, _, i, v, {
-                // https://stackoverflow.com/questions/1486904/how-do-i-best-silence-a-warning-about-unused-variables
-                (void)i;
-                js_mark(v);
-            });
-        }
-        break;
-    case vt_object:
-        if (!value->managed->in_use) {
-            value->managed->in_use = 1;
-            js_map_for_each(value->managed->object.base, _, value->managed->object.capacity, k, kl, v, {
-                (void)k;
-                (void)kl;
-                js_mark(v);
-            });
-        }
-        break;
-    case vt_function:
-        if (!value->managed->in_use) {
-            value->managed->in_use = 1;
-            js_map_for_each(value->managed->function.closure.base, _, value->managed->function.closure.capacity, k, kl, v, {
-                (void)k;
-                (void)kl;
-                js_mark(v);
-            });
-        }
-        break;
-    case vt_c_data:
-        if (!value->managed->in_use) {
-            value->managed->in_use = 1;
-            if (value->managed->c_data.mark) {
-                value->managed->c_data.mark(value->managed->c_data.data);
-            }
-        }
-        break;
-    default:
-        // puts("skip");
-        break;
-    }
-}
-
-void _free_managed(struct js_managed_value *managed) {
-    switch (managed->type) {
-    case vt_string:
-        buffer_free(managed->string.base, managed->string.length, managed->string.capacity);
-        free(managed);
-        break;
-    case vt_array:
-        buffer_free(managed->array.base, managed->array.length, managed->array.capacity);
-        free(managed);
-        break;
-    case vt_object: {
-        js_map_free(managed->object.base, managed->object.length, managed->object.capacity);
-        free(managed);
-        break;
-    }
-    case vt_function: {
-        js_map_free(managed->function.closure.base, managed->function.closure.length, managed->function.closure.capacity);
-        free(managed);
-        break;
-    }
-    case vt_c_data: {
-        if (managed->c_data.sweep) {
-            managed->c_data.sweep(managed->c_data.data);
-        }
-        free(managed);
-        break;
-    }
-    default:
-        fatal("Illegal managed type \"%u\"", managed->type);
-        break;
-    }
-}
-
-void js_sweep(struct js_heap *heap) {
-    struct js_managed_value **new_base = NULL;
-    size_t new_length = 0;
-    size_t new_capacity = 0;
-    buffer_for_each(heap->base, heap->length, heap->capacity, i, v, {
-        if ((*v)->in_use) {
-            (*v)->in_use = 0;
-            buffer_push(new_base, new_length, new_capacity, *v);
-        } else {
-            _free_managed(*v);
-        }
-    });
-    free(heap->base);
-    heap->base = new_base;
-    heap->length = new_length;
-    heap->capacity = new_capacity;
-}
-
-static bool _json_unprintable(enum js_value_type type) {
-    return type == vt_undefined || type == vt_function || type == vt_c_function || type == vt_c_data;
-}
-
-static void _serialize_string(struct print_stream *out, enum serialized_style to, char *base, size_t length, size_t depth) {
-    bool zero_depth_tostring = (to == tostring_style && depth == 0);
-    putsz_to_stream(out, zero_depth_tostring ? "" : (to == tojson_style ? "\"" : "'"));
-    if (zero_depth_tostring) {
-        puts_to_stream(out, base, length);
-    } else {
-        escape_to_stream(out, base, length);
-    }
-    putsz_to_stream(out, zero_depth_tostring ? "" : (to == tojson_style ? "\"" : "'"));
-}
-
-void js_serialize_managed_value(struct print_stream *out, enum serialized_style to, struct js_managed_value *managed, size_t depth) {
-    bool first;
-    switch (managed->type) {
-    case vt_string:
-        _serialize_string(out, to, managed->string.base, managed->string.length, depth);
-        break;
-    case vt_array:
-        if (to == tojson_style) {
-            putsz_to_stream(out, "[");
-            first = true;
-            for (size_t i = 0; i < managed->array.length; i++) {
-                first ? (first = false) : putsz_to_stream(out, ",");
-                struct js_value elem = js_get_managed_array_element(managed, i);
-                if (_json_unprintable(elem.type)) {
-                    // in array, un-jsonizables presented as null
-                    putsz_to_stream(out, "null");
-                } else {
-                    js_serialize_value(out, to, &elem, depth + 1);
-                }
-            }
-            putsz_to_stream(out, "]");
-        } else if (to == todump_style || (to == tostring_style && depth == 0)) {
-            putsz_to_stream(out, "[");
-            first = true;
-            js_list_for_each(managed->array.base, managed->array.length, _, i, v, {
-                first ? (first = false) : putsz_to_stream(out, ",");
-                printf_to_stream(out, "%zu:", i);
-                js_serialize_value(out, to, v, depth + 1);
-            });
-            putsz_to_stream(out, "]");
-        } else {
-            putsz_to_stream(out, "<array>");
-        }
-        break;
-    case vt_object:
-        if (to == todump_style || to == tojson_style || (to == tostring_style && depth == 0)) {
-            putsz_to_stream(out, "{");
-            first = true;
-            js_map_for_each(managed->object.base, _, managed->object.capacity, k, kl, v, {
-                if (to == tojson_style && _json_unprintable(v->type)) {
-                    continue;
-                }
-                first ? (first = false) : putsz_to_stream(out, ",");
-                putsz_to_stream(out, to == tojson_style ? "\"" : "'");
-                escape_to_stream(out, k, kl);
-                putsz_to_stream(out, to == tojson_style ? "\"" : "'");
-                putsz_to_stream(out, ":");
-                js_serialize_value(out, to, v, depth + 1);
-            });
-            putsz_to_stream(out, "}");
-        } else {
-            putsz_to_stream(out, "<object>");
-        }
-        break;
-    case vt_function:
-        if (to == todump_style) {
-            printf_to_stream(out, "<function %u {", managed->function.ingress);
-            first = true;
-            js_map_for_each(managed->function.closure.base, _, managed->function.closure.capacity, k, kl, v, {
-                first ? (first = false) : putsz_to_stream(out, ",");
-                printf_to_stream(out, "%.*s:", (int)kl, k);
-                js_serialize_value(out, to, v, depth + 1);
-            });
-            putsz_to_stream(out, "}>");
-        } else if (to == tostring_style) {
-            putsz_to_stream(out, "<function>");
-        }
-        break;
-    case vt_c_data:
-        if (to == todump_style) {
-            printf_to_stream(out, "<c_data %p %p %p>", managed->c_data.data, managed->c_data.mark, managed->c_data.sweep);
-        } else if (to == tostring_style) {
-            putsz_to_stream(out, "<c_data>");
-        }
-        break;
-    default:
-        fatal("Unknown managed value type %d", managed->type);
-    }
-}
-
-// DON'T use '_serialize()', possible confilct with internal functions
-void js_serialize_value(struct print_stream *out, enum serialized_style to, struct js_value *value, size_t depth) {
-    switch (value->type) {
-    case vt_undefined:
-        if (to == todump_style || to == tojson_style) {
-            printf_to_stream(out, "undefined");
-        }
-        break;
-    case vt_null:
-        printf_to_stream(out, "null");
-        break;
-    case vt_boolean:
-        printf_to_stream(out, value->boolean ? "true" : "false");
-        break;
-    case vt_number:
-        printf_to_stream(out, "%lg", value->number);
-        break;
-    case vt_scripture:
-        _serialize_string(out, to, value->scripture.base, value->scripture.length, depth);
-        break;
-    case vt_c_function:
-        if (to == todump_style) {
-            printf_to_stream(out, "<c_function %p>", value->c_function);
-        } else if (to == tostring_style) {
-            putsz_to_stream(out, "<c_function>");
-        }
-        break;
-    case vt_string:
-    case vt_array:
-    case vt_object:
-    case vt_function:
-    case vt_c_data:
-        js_serialize_managed_value(out, to, value->managed, depth);
-        break;
-    default:
-        fatal("Unknown value type %d", value->type);
-    }
-}
-
-void js_dump_value(struct js_value *value) {
-    struct print_stream out = {.type = file_stream, .fp = stdout};
-    js_serialize_value(&out, todump_style, value, 0);
-}
-
-bool js_is_string(struct js_value *value) {
-    return value->type == vt_scripture || value->type == vt_string;
-}
-
-char *js_get_string_base(struct js_value *value) {
-    switch (value->type) {
-    case vt_scripture:
-        return value->scripture.base;
-    case vt_string:
-        return value->managed->string.base;
-    default:
-        return NULL;
-    }
-}
-
-size_t js_get_string_length(struct js_value *value) {
-    switch (value->type) {
-    case vt_scripture:
-        return value->scripture.length;
-    case vt_string:
-        return value->managed->string.length;
-    default:
-        return 0;
-    }
-}
-
-int js_compare_string(struct js_value *lhs, struct js_value *rhs) {
-    char *pl = js_get_string_base(lhs);
-    size_t ll = js_get_string_length(lhs);
-    char *pr = js_get_string_base(rhs);
-    size_t lr = js_get_string_length(rhs);
-    return strncmp(pl, pr, max(ll, lr));
-}
-
-struct js_result js_add(struct js_heap *heap, struct js_value *lhs, struct js_value *rhs) {
-    struct js_value value;
-    if (lhs->type == vt_number && rhs->type == vt_number) {
-        js_return(js_number(lhs->number + rhs->number));
-    } else if (js_is_string(lhs) && js_is_string(rhs)) {
-        value = js_string(heap, js_get_string_base(lhs), js_get_string_length(lhs));
-        string_buffer_append(value.managed->string.base, value.managed->string.length, value.managed->string.capacity, js_get_string_base(rhs), js_get_string_length(rhs));
-        js_return(value);
-    } else {
-        js_throw(js_scripture_sz("Add operand must be number or string"));
-    }
-}
-
-#ifdef DEBUG
-
-void test_data_structure_size() {
-    log_expression("%zu", sizeof(struct js_value));
-    log_expression("%zu", sizeof(struct js_kv_pair));
-    log_expression("%zu", sizeof(struct js_variable_map));
-    log_expression("%zu", sizeof(struct js_managed_value));
-    log_expression("%zu", sizeof(struct js_heap));
-    log_expression("%zu", sizeof(struct js_result));
-}
-
-void test_js_map() {
-    struct js_kv_pair *p = NULL;
-    size_t len = 0;
-    size_t cap = 0;
-    for (int i = 0; i < 10; i++) {
-        char *key = random_sz_static(NULL);
-        struct js_value val, ret;
-        val.type = vt_number;
-        val.number = random_double();
-        js_map_put_sz(p, len, cap, key, val);
-        ret = js_map_get_sz(p, len, cap, key);
-        enforce(ret.type == vt_number);
-        enforce(ret.number == val.number);
-        printf("len=%zu cap=%zu\n", len, cap);
-    }
-    js_map_for_each(p, _, cap, key, klen, val, {
-        printf("%.*s %g\n", (int)klen, key, val->number);
-    });
-    js_map_free(p, len, cap);
-}
-
-void test_js_map_loop() {
-    struct js_kv_pair *p = NULL;
-    size_t len = 0;
-    size_t cap = 0;
-    for (;;) {
-        for (int i = 0; i < 100000; i++) {
-            char *key = random_sz_static(NULL);
-            struct js_value val = js_number(random_double());
-            js_map_put_sz(p, len, cap, key, val);
-            struct js_value ret = js_map_get_sz(p, len, cap, key);
-            enforce(ret.type == vt_number);
-            enforce(ret.number == val.number);
-            // random delete, to check stage 2
-            if (rand() % 2 == 0) {
-                js_map_put_sz(p, len, cap, key, (struct js_value){0});
-            }
-        }
-        printf("len=%zu cap=%zu\n", len, cap);
-        js_map_free(p, len, cap);
-        // js_map_free_internal(&p, &len, &cap);
-    }
-}
-
-static enum js_value_type _random_js_value_type() {
-    return rand() % (countof(_value_type_names) - 1) + 1;
-}
-
-struct tablet {
-    char foo;
-    short bar;
-    const char s[256];
-    int baz;
-    long qux;
-};
-
-static struct js_value _random_js_value(struct js_heap *heap, enum js_value_type type, size_t depth) {
-    // https://www.biblestudytools.com/topical-verses/the-25-most-read-bible-verses/
-    static const char *scriptures[] = {
-        "1. John 3:16 - For God so loved the world that he gave his one and only Son, that whoever believes in him shall not perish but have eternal life.",
-        "2. Jeremiah 29:11 - For I know the plans I have for you,” declares the LORD, “plans to prosper you and not to harm you, plans to give you hope and a future.",
-        "3. Romans 8:28 - And we know that in all things God works for the good of those who love him, who have been called according to his purpose.",
-        "4. Philippians 4:13 - I can do everything through him who gives me strength.",
-        "5. Genesis 1:1 - In the beginning God created the heavens and the earth.",
-        "6. Proverbs 3:5 - Trust in the LORD with all your heart and lean not on your own understanding.",
-        "7. Proverbs 3:6 - In all your ways acknowledge him, and he will make your paths straight.",
-        "8. Romans 12:2 - Do not conform any longer to the pattern of this world, but be transformed by the renewing of your mind. Then you will be able to test and approve what God's will is—his good, pleasing and perfect will.",
-        "9. Philippians 4:6 - Do not be anxious about anything, but in everything, by prayer and petition, with thanksgiving, present your requests to God.",
-        "10. Matthew 28:19 - Therefore go and make disciples of all nations, baptizing them in the name of the Father and of the Son and of the Holy Spirit.",
-    };
-    struct js_value ret;
-    int i;
-    if (depth >= 10) {
-        return js_null();
-    }
-    switch (type) {
-    case vt_null:
-        return js_null();
-    case vt_boolean:
-        return js_boolean(rand() % 2 == 1);
-    case vt_number:
-        return js_number(random_double());
-    case vt_scripture:
-        return js_scripture_sz(scriptures[rand() % countof(scriptures)]);
-    case vt_string:
-        return js_string_sz(heap, random_sz_static(NULL));
-    case vt_array:
-        ret = js_array(heap);
-        for (i = 0; i < rand() % 10; i++) {
-            struct js_value v = _random_js_value(heap, _random_js_value_type(), depth + 1);
-            js_put_array_element(&ret, rand() % 100, v);
-        }
-        return ret;
-    case vt_object:
-        ret = js_object(heap);
-        for (i = 0; i < rand() % 10; i++) {
-            struct js_value v = _random_js_value(heap, _random_js_value_type(), depth + 1);
-            js_put_object_value_sz(&ret, random_sz_static(NULL), v);
-        }
-        return ret;
-    case vt_function:
-        ret = js_function(heap, rand() % UINT32_MAX);
-        for (i = 0; i < rand() % 10; i++) {
-            struct js_value v = _random_js_value(heap, _random_js_value_type(), depth + 1);
-            size_t len = ret.managed->function.closure.length; // uint16_t -> size_t
-            size_t cap = ret.managed->function.closure.capacity;
-            js_map_put_sz(ret.managed->function.closure.base, len, cap, random_sz_static(NULL), v);
-            ret.managed->function.closure.length = (uint16_t)len; // size_t -> uint16_t
-            ret.managed->function.closure.capacity = (uint16_t)cap;
-        }
-        return ret;
-    case vt_c_function:
-        return (struct js_value){.type = vt_c_function, .c_function = (void *)(intptr_t)rand()};
-    case vt_c_data:
-        return js_c_data(heap, random_sz_dynamic(), NULL, free);
-    default:
-        fatal("Unknown value type %u", type);
-    }
-}
-
-void test_js_value() {
-    struct js_heap heap = {0};
-    for (enum js_value_type type = 1; type < countof(_value_type_names); type++) {
-        struct js_value val = _random_js_value(&heap, type, 0);
-        printf("%s: ", _value_type_names[type]);
-        js_dump_value(&val);
-        printf("\n");
-    }
-    js_sweep(&heap);
-    buffer_free(heap.base, heap.length, heap.capacity);
-}
-
-void test_js_value_loop() {
-    struct js_heap heap = {0};
-    for (;;) {
-        for (int i = 0; i < 10000; i++) {
-            struct js_value val = _random_js_value(&heap, _random_js_value_type(), 0);
-            if (rand() % 10 == 0) { // mark 1/10 of them
-                js_mark(&val);
-            }
-        }
-        js_sweep(&heap);
-        js_sweep(&heap); // second round sweep remained all
-        buffer_free(heap.base, heap.length, heap.capacity);
-        putchar('.');
-    }
-}
-
-void test_js_value_bug() {
-    // REPRODUCE BUG:
-    struct js_heap heap = {0};
-    const char *bug_keys[] = {"b",
-        "CVUcQn5KYZkjKSa1eJAsg0nUQsnZBdSNquxXsYnwIoNTEAtZBOt",
-        "Swy4fCH8h03lkwQwW9BxW7O3dH9EReeng80wiI37Jwid6RXMwQ0cgiPn",
-        "EFvi653FKJKm04nqvfux6YzKZhmukC7biyUhulH9eLPxZUX"};
-    for (int i = 0; i < countof(bug_keys); i++) {
-        const char *k = bug_keys[i];
-        size_t fh = _first_hash(k, (uint16_t)strlen(k), 0b01);
-        size_t nh = _next_hash(fh, 0b01);
-        printf("%d. %s %zu %zu\n", i, k, fh, nh);
-    }
-    struct js_value obj = js_object(&heap);
-    js_put_object_value_sz(&obj, bug_keys[0], js_boolean(true));
-    js_put_object_value_sz(&obj, bug_keys[0], js_null());
-    js_put_object_value_sz(&obj, bug_keys[2], js_boolean(true));
-    js_put_object_value_sz(&obj, bug_keys[1], js_boolean(true));
-    js_put_object_value_sz(&obj, bug_keys[3], js_boolean(true));
-}
-
-void test_js_string_family() {
-    struct js_heap heap = {0};
-    for (;;) {
-        for (uint8_t vt = vt_scripture; vt <= vt_string; vt++) {
-            struct js_value str = _random_js_value(&heap, vt, 0);
-            printf("%s %s %.*s\n", js_is_string(&str) ? "true" : "false", _value_type_names[vt], (int)js_get_string_length(&str), js_get_string_base(&str));
-            js_sweep(&heap);
-        }
-    }
-}
-
-void test_js_string_f() {
-    struct js_heap heap = {0};
-    for (;;) {
-        js_string_f(&heap, "/%g/%s", 3.14, "hello");
-        js_sweep(&heap);
-    }
-}
-
+/*
+Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "js-data.h"
+#include <time.h> // clock, for time budget of incremental collection
+
+#define X(name) #name,
+static const char *const _value_type_names[] = {js_value_type_list};
+#undef X
+
+void js_map_dump(struct js_kv_pair *base, size_t length, size_t capacity) {
+    size_t i;
+    printf("length=%zu capacity=%zu\n", length, capacity);
+    for (i = 0; i < capacity; i++) {
+        struct js_kv_pair *node = base + i;
+        printf("    %zu %.*s %s\n", i, (int)node->key.length, node->key.base, _value_type_names[node->value.type]);
+    }
+}
+
+// unmasked, masking it later is same as masking every step, so one hash is shared by all maps and atom table
+static uint32_t _hash(const char *string, uint16_t length) {
+    uint32_t hash = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        hash = hash + (hash << 4) + string[i];
+    }
+    return hash;
+}
+
+static size_t _next_hash(size_t hash, size_t mask) {
+    // hash = hash * 5 + 1 can perfectly cover 0-2 pow
+    // https://tieba.baidu.com/p/8968552557
+    return (hash + (hash << 4) + 1) & mask;
+}
+
+static struct js_kv_pair *_find_empty(struct js_kv_pair *base, size_t capacity, struct js_atom *atom) {
+    size_t mask = capacity - 1;
+    for (size_t repeat = 0, hash = atom->hash & mask; repeat < capacity; repeat++, hash = _next_hash(hash, mask)) {
+        struct js_kv_pair *node = base + hash;
+        // js_info("repeat=%d hash=%d", repeat, hash);
+        if (!node->key.base && !node->value.type) {
+            return node;
+        }
+    }
+    fatal("Whole loop ended, this shouldn't happen");
+}
+
+// returns slot of matched atom in heap's table, open addressing same as js_map, or empty slot where it should be put
+static struct js_atom **_find_atom_slot(struct js_heap *heap, const char *base, uint16_t length, uint32_t hash) {
+    size_t mask = heap->atoms.capacity - 1;
+    for (size_t repeat = 0, index = hash & mask; repeat < heap->atoms.capacity; repeat++, index = _next_hash(index, mask)) {
+        struct js_atom **slot = heap->atoms.base + index;
+        if (*slot == NULL || ((*slot)->hash == hash && (*slot)->length == length && memcmp((*slot)->base, base, length) == 0)) {
+            return slot;
+        }
+    }
+    fatal("Whole loop ended, this shouldn't happen");
+}
+
+// moves atoms to a new table of capacity
+static void _rebuild_atoms(struct js_heap *heap, size_t capacity) {
+    struct js_atom **oldbase = heap->atoms.base;
+    size_t oldcap = heap->atoms.capacity;
+    heap->atoms.base = NULL;
+    heap->atoms.length = 0;
+    heap->atoms.capacity = 0;
+    buffer_alloc(heap->atoms.base, heap->atoms.length, heap->atoms.capacity, capacity);
+    for (size_t i = 0; i < oldcap; i++) {
+        if (oldbase[i]) {
+            *_find_atom_slot(heap, oldbase[i]->base, oldbase[i]->length, oldbase[i]->hash) = oldbase[i];
+            heap->atoms.length++;
+        }
+    }
+    free(oldbase);
+}
+
+// permanent atoms are names known before running, such as bytecode operands and c literals, others are run time object keys
+static struct js_atom *_intern(struct js_heap *heap, const char *base, uint16_t length, bool permanent) {
+    uint32_t hash = _hash(base, length);
+    struct js_atom **slot;
+    if (heap->atoms.capacity < (heap->atoms.length + 1) << 1) {
+        _rebuild_atoms(heap, heap->atoms.capacity ? heap->atoms.capacity << 1 : 256);
+    }
+    slot = _find_atom_slot(heap, base, length, hash);
+    if (*slot == NULL) {
+        struct js_atom *atom = (struct js_atom *)alloc(char, sizeof(struct js_atom) + length + 1);
+        atom->hash = hash;
+        atom->length = length;
+        memcpy(atom->base, base, length);
+        *slot = atom;
+        heap->atoms.length++;
+        if (!permanent) {
+            heap->runtime_atoms++;
+        }
+    }
+    if (permanent) {
+        (*slot)->permanent = 1;
+    } else if (heap->phase == gc_marking) { // may be stored where marking has passed
+        (*slot)->in_use = 1;
+    }
+    return *slot;
+}
+
+struct js_atom *js_atom(struct js_heap *heap, const char *base, uint16_t length) {
+    return _intern(heap, base, length, true);
+}
+
+// returns NULL if not interned, which also means it's not key of any map
+struct js_atom *js_find_atom(struct js_heap *heap, const char *base, uint16_t length) {
+    return heap->atoms.capacity ? *_find_atom_slot(heap, base, length, _hash(base, length)) : NULL;
+}
+
+// after marking, atoms of run time keys which are neither keys of marked objects nor marked scripture values are freed
+static void _sweep_atoms(struct js_heap *heap) {
+    size_t freed = 0;
+    size_t capacity = 256;
+    heap->runtime_atoms = 0;
+    for (size_t i = 0; i < heap->atoms.capacity; i++) {
+        struct js_atom *atom = heap->atoms.base[i];
+        if (atom == NULL) {
+            continue;
+        } else if (atom->permanent || atom->in_use) {
+            atom->in_use = 0;
+        } else {
+            free(atom);
+            heap->atoms.base[i] = NULL;
+            freed++;
+        }
+    }
+    if (freed > 0) { // open addressing can't leave holes, so rebuild, which may shrink too
+        heap->atoms.length -= freed;
+        while (capacity < (heap->atoms.length + 1) << 1) {
+            capacity <<= 1;
+        }
+        _rebuild_atoms(heap, capacity);
+    }
+}
+
+// BUG: Stage 2 should also check rehash
+// void js_map_put(struct js_kv_pair **base, size_t *length, size_t *capacity, const char *key, uint16_t key_length, struct js_value value) {
+//     // js_map_dump(*base, *length, *capacity);
+//     // printf("key=%.*s, value=%s\n", key_length, key, _value_type_names[value.type]);
+//     bool next_stage = false;
+//     struct js_kv_pair *recorded;
+//     if (!*base) { // first allocate
+//         buffer_alloc(*base, *length, *capacity, 2);
+//     }
+//     size_t mask = (*capacity) - 1;
+//     for (size_t repeat = 0, hash = _first_hash(key, key_length, mask); repeat < *capacity; repeat++, hash = _next_hash(hash, mask)) {
+//         struct js_kv_pair *node = *base + hash;
+//         // js_info("repeat=%d hash=%d", repeat, hash);
+//         if (node->key.base == NULL) { // k is empty
+//             if (node->value.type != 0) { // v not empty
+//                 fatal("Key is NULL but value not NULL, this shouldn't happen");
+//             } else {
+//                 if (value.type != 0) {
+//                     if (next_stage) {
+//                         goto next_stage_done;
+//                     } else {
+//                         size_t newlen = *length + 1;
+//                         size_t reqcap = newlen << 1;
+//                         if (*capacity >= reqcap) {
+//                             string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
+//                             node->value = value;
+//                             *length = newlen;
+//                             // printf("++ *length=%zu\n", *length);
+//                             return;
+//                         } else {
+//                             // rehash
+//                             struct js_kv_pair *newbase = NULL;
+//                             size_t newlen = 0;
+//                             size_t newcap = 0;
+//                             size_t i;
+//                             buffer_alloc(newbase, newlen, newcap, reqcap);
+//                             for (i = 0; i < *capacity; i++) {
+//                                 node = *base + i;
+//                                 if (node->key.base && node->value.type) {
+//                                     struct js_kv_pair *newnode = _find_empty(newbase, newcap, node->key.base, node->key.length);
+//                                     *newnode = *node;
+//                                     newlen++;
+//                                 }
+//                             }
+//                             node = _find_empty(newbase, newcap, key, key_length);
+//                             string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
+//                             node->value = value;
+//                             newlen++;
+//                             free(*base);
+//                             *base = newbase;
+//                             *length = newlen;
+//                             *capacity = newcap;
+//                             return;
+//                         }
+//                     }
+//                 } else {
+//                     return;
+//                 }
+//             }
+//         } else if (node->key.length == key_length && memcmp(node->key.base, key, key_length) == 0) { // matched
+//             if (node->value.type != 0) {
+//                 if (value.type == 0) {
+//                     (*length)--;
+//                     // printf("-- *length=%zu\n", *length);
+//                 }
+//                 node->value = value;
+//             } else {
+//                 if (value.type != 0) {
+//                     (*length)++;
+//                     // printf("++ *length=%zu\n", *length);
+//                     node->value = value;
+//                 }
+//             }
+//             return;
+//         } else { // k not matched
+//             if (next_stage) {
+//                 continue;
+//             } else if (node->value.type != 0) {
+//                 continue;
+//             } else {
+//                 recorded = node;
+//                 next_stage = true;
+//                 // string_buffer_clear(node->key.base, node->key.length, node->key.capacity);
+//                 // string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
+//                 // if (value.type != 0) {
+//                 //     node->value = value;
+//                 //     (*length)++;
+//                 //     // printf("++ *length=%zu\n", *length);
+//                 // }
+//                 // return;
+//             }
+//         }
+//     }
+//     if (next_stage) {
+//         goto next_stage_done;
+//     }
+//     fatal("Whole loop ended, this shouldn't happen");
+// next_stage_done:
+//     string_buffer_clear(recorded->key.base, recorded->key.length, recorded->key.capacity);
+//     string_buffer_append(recorded->key.base, recorded->key.length, recorded->key.capacity, key, key_length);
+//     recorded->value = value;
+//     (*length)++;
+//     // printf("++ *length=%zu\n", *length);
+// }
+
+// BUGFIX: always check rehash
+// if 'version' is not NULL, it is increased whenever node addresses or liveness change, so that cached node pointers can be validated, simple value replacement won't touch it
+void js_map_put_atom_internal(struct js_kv_pair **base, size_t *length, size_t *capacity, struct js_atom *atom, struct js_value value, uint32_t *version) {
+    value = js_normalize(value);
+    // js_map_dump(*base, *length, *capacity);
+    // printf("key=%.*s, value=%s\n", key_length, key, _value_type_names[value.type]);
+    bool next_stage = false;
+    struct js_kv_pair *recorded = NULL;
+    if (!*base) { // first allocate
+        buffer_alloc(*base, *length, *capacity, 2);
+    }
+    size_t mask = (*capacity) - 1;
+    struct js_kv_pair *node;
+    for (size_t repeat = 0, hash = atom->hash & mask; repeat < *capacity; repeat++, hash = _next_hash(hash, mask)) {
+        node = *base + hash;
+        // js_info("repeat=%d hash=%d", repeat, hash);
+        if (node->key.base == NULL) { // k is empty
+            if (node->value.type != 0) { // v not empty
+                fatal("Key is NULL but value not NULL, this shouldn't happen");
+            } else {
+                if (value.type != 0) {
+                    if (next_stage) {
+                        goto next_stage_done;
+                    } else {
+                        node->key.base = atom->base;
+                        node->key.length = atom->length;
+                        node->value = value;
+                        (*length)++;
+                        // printf("++ *length=%zu\n", *length);
+                        goto check_rehash;
+                    }
+                } else {
+                    return;
+                }
+            }
+        } else if (node->key.base == atom->base) { // matched
+            if (node->value.type != 0) {
+                if (value.type == 0) {
+                    (*length)--;
+                    // printf("-- *length=%zu\n", *length);
+                    if (version) {
+                        (*version)++;
+                    }
+                }
+                node->value = value;
+                return;
+            } else {
+                if (value.type != 0) {
+                    (*length)++;
+                    // printf("++ *length=%zu\n", *length);
+                    node->value = value;
+                }
+                goto check_rehash;
+            }
+        } else { // k not matched
+            if (next_stage) {
+                continue;
+            } else if (node->value.type != 0) {
+                continue;
+            } else {
+                recorded = node;
+                next_stage = true;
+                // string_buffer_clear(node->key.base, node->key.length, node->key.capacity);
+                // string_buffer_append(node->key.base, node->key.length, node->key.capacity, key, key_length);
+                // if (value.type != 0) {
+                //     node->value = value;
+                //     (*length)++;
+                //     // printf("++ *length=%zu\n", *length);
+                // }
+                // return;
+            }
+        }
+    }
+    if (next_stage) {
+        goto next_stage_done;
+    }
+    fatal("Whole loop ended, this shouldn't happen");
+next_stage_done:
+    recorded->key.base = atom->base;
+    recorded->key.length = atom->length;
+    recorded->value = value;
+    (*length)++;
+    // printf("++ *length=%zu\n", *length);
+check_rehash:
+    if (version) { // something may be added or revived
+        (*version)++;
+    }
+    size_t reqcap = *length << 1;
+    if (*capacity < reqcap) {
+        // rehash
+        struct js_kv_pair *newbase = NULL;
+        size_t newlen = 0;
+        size_t newcap = 0;
+        size_t i;
+        buffer_alloc(newbase, newlen, newcap, reqcap);
+        for (i = 0; i < *capacity; i++) {
+            node = *base + i;
+            if (node->key.base && node->value.type) {
+                struct js_kv_pair *newnode = _find_empty(newbase, newcap, js_atom_of(node->key.base));
+                *newnode = *node;
+                newlen++;
+            }
+        }
+        free(*base);
+        *base = newbase;
+        *length = newlen;
+        *capacity = newcap;
+    }
+}
+
+// deleting a key never interned needs nothing, don't intern it
+void js_map_put_internal(struct js_heap *heap, struct js_kv_pair **base, size_t *length, size_t *capacity, const char *key, uint16_t key_length, struct js_value value, uint32_t *version) {
+    struct js_atom *atom = value.type ? js_atom(heap, key, key_length) : js_find_atom(heap, key, key_length);
+    if (atom) {
+        js_map_put_atom_internal(base, length, capacity, atom, value, version);
+    }
+}
+
+// void js_map_put_sz(struct js_kv_pair **base, size_t *length, size_t *capacity, const char *key, struct js_value value) {
+//     js_map_put(base, length, capacity, key, (uint16_t)strlen(key), value);
+// }
+
+// returns matched node, whose value may be empty if deleted, or NULL if not found
+struct js_kv_pair *js_map_get_atom_node(struct js_kv_pair *base, size_t length, size_t capacity, struct js_atom *atom) {
+    size_t mask = capacity - 1;
+    size_t hash;
+    size_t repeat;
+    for (repeat = 0, hash = atom->hash & mask; repeat < capacity; repeat++, hash = _next_hash(hash, mask)) {
+        struct js_kv_pair *node = base + hash;
+        if (node->key.base == NULL) {
+            return NULL;
+        } else if (node->key.base == atom->base) {
+            return node;
+        }
+    }
+    // log_debug("Whole loop ended");
+    return NULL;
+}
+
+struct js_kv_pair *js_map_get_node(struct js_heap *heap, struct js_kv_pair *base, size_t length, size_t capacity, const char *key, uint16_t key_length) {
+    struct js_atom *atom = js_find_atom(heap, key, key_length);
+    return atom ? js_map_get_atom_node(base, length, capacity, atom) : NULL;
+}
+
+struct js_value js_map_get_atom(struct js_kv_pair *base, size_t length, size_t capacity, struct js_atom *atom) {
+    struct js_kv_pair *node = js_map_get_atom_node(base, length, capacity, atom);
+    return node ? node->value : (struct js_value){0};
+}
+
+struct js_value js_map_get(struct js_heap *heap, struct js_kv_pair *base, size_t length, size_t capacity, const char *key, uint16_t key_length) {
+    struct js_kv_pair *node = js_map_get_node(heap, base, length, capacity, key, key_length);
+    return node ? node->value : (struct js_value){0};
+}
+
+struct js_value js_map_get_sz(struct js_heap *heap, struct js_kv_pair *base, size_t length, size_t capacity, const char *key) {
+    return js_map_get(heap, base, length, capacity, key, (uint16_t)strlen(key));
+}
+
+// void js_map_free_internal(struct js_kv_pair **base, size_t *length, size_t *capacity) {
+//     for (size_t i = 0; i < *capacity; i++) {
+//         struct js_kv_pair *node = *base + i;
+//         if (node->key.base) {
+//             free(node->key.base);
+//         }
+//     }
+//     buffer_free(*base, *length, *capacity);
+// }
+
+struct js_value js_null() {
+    return (struct js_value){.type = vt_null};
+}
+
+struct js_value js_boolean(bool boolean) {
+    return (struct js_value){.type = vt_boolean, .boolean = boolean};
+}
+
+struct js_value js_number(double number) {
+    return (struct js_value){.type = vt_number, .number = number};
+}
+
+struct js_value js_scripture(struct js_heap *heap, const char *base, uint16_t length) {
+    return js_scripture_atom(js_atom(heap, base, length));
+}
+
+struct js_value js_scripture_sz(struct js_heap *heap, const char *sz) {
+    size_t length = strlen(sz);
+    enforce(length <= UINT16_MAX);
+    return js_scripture(heap, sz, (uint16_t)length);
+}
+
+static void _gray(struct js_heap *, struct js_managed_value *);
+
+// create an empty skeleton value of managed type, and hook it to heap
+// young if nursery has room, c data is always old because its mark function may keep values without write barrier
+// old value is gray while marking, because its creator fills it without write barrier, and survives sweeping in progress
+struct js_value js_alloc_managed(struct js_heap *heap, enum js_value_type type) {
+    enforce(js_is_managed(type));
+    struct js_value ret = {.type = type};
+    struct js_nursery *nursery = heap->nursery;
+    if (nursery && nursery->length < nursery->capacity && type != vt_c_data) {
+        ret.managed = nursery->cells + nursery->length++; // cleared when nursery is reset
+        ret.managed->young = 1;
+    } else {
+        ret.managed = alloc(struct js_managed_value, 1);
+        buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+        if (heap->phase == gc_marking) {
+            _gray(heap, ret.managed);
+        } else if (heap->phase == gc_sweeping) {
+            ret.managed->in_use = 1;
+        }
+    }
+    ret.managed->type = type;
+    heap->allocated++;
+    if (heap->threshold != SIZE_MAX && js_heap_exhausted(heap)) {
+        heap->due = true; // caller's temporaries may not be rooted yet, so only requested here
+    }
+    return ret;
+}
+
+struct js_value js_string(struct js_heap *heap, const char *str, size_t slen) {
+    struct js_value ret = js_alloc_managed(heap, vt_string);
+    // struct js_value ret = {.type = vt_string};
+    // ret.managed = alloc(struct js_managed_value, 1);
+    // ret.managed->type = vt_string;
+    // make sure string is always not NULL, or in some C lib functions, will cause error
+    ret.managed->string.base = alloc(char, 1);
+    ret.managed->string.capacity = 1;
+    string_buffer_append(ret.managed->string.base, ret.managed->string.length, ret.managed->string.capacity, str, slen);
+    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+    return ret;
+}
+
+struct js_value js_string_sz(struct js_heap *heap, const char *str) {
+    return js_string(heap, str, strlen(str));
+}
+
+// mostly for formatted error messages
+struct js_value js_string_f(struct js_heap *heap, const char *fmt, ...) {
+    //     struct js_value ret = {.type = vt_string};
+    //     ret.managed = alloc(struct js_managed_value, 1);
+    //     ret.managed->type = vt_string;
+    //     va_list args;
+    //     va_start(args, fmt);
+    //     string_buffer_append_fv(ret.managed->string.base, ret.managed->string.length, ret.managed->string.capacity, fmt, args);
+    //     va_end(args);
+    //     buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+    //     return ret;
+    struct print_stream out = {.type = string_stream};
+    va_list args;
+    va_start(args, fmt);
+    vprintf_to_stream(&out, fmt, args);
+    va_end(args);
+    struct js_value ret = js_alloc_managed(heap, vt_string);
+    ret.managed->string.base = out.base;
+    ret.managed->string.length = out.length;
+    ret.managed->string.capacity = out.capacity;
+    return ret;
+}
+
+struct js_value js_array(struct js_heap *heap) {
+    struct js_value ret = js_alloc_managed(heap, vt_array);
+    // struct js_value ret = {.type = vt_array};
+    // ret.managed = alloc(struct js_managed_value, 1);
+    // ret.managed->type = vt_array;
+    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+    return ret;
+}
+
+// array may be long, so collecting young generation only visits elements from lowest index stored since last time
+static void _array_write_barrier(struct js_heap *heap, struct js_managed_value *array, size_t index, struct js_value element) {
+    if (element.type == vt_scripture) {
+        js_write_barrier(heap, array, element);
+        return;
+    } else if (!js_is_managed(element.type)) {
+        return;
+    } else if (element.managed->young) {
+        if (array->young) {
+            return;
+        } else if (!array->remembered) {
+            js_remember(array, element.managed);
+            array->array.remembered_from = index;
+        } else if (index < array->array.remembered_from) {
+            array->array.remembered_from = index;
+        }
+    } else if (array->in_use && !element.managed->in_use) {
+        js_shade(heap, element.managed);
+    }
+}
+
+void js_push_array_element(struct js_heap *heap, struct js_value *container, struct js_value element) {
+    _array_write_barrier(heap, container->managed, container->managed->array.length, element);
+    buffer_push(container->managed->array.base, container->managed->array.length, container->managed->array.capacity, element.type == vt_null ? (struct js_value){0} : js_normalize(element));
+}
+
+void js_put_array_element(struct js_heap *heap, struct js_value *container, size_t index, struct js_value element) {
+    _array_write_barrier(heap, container->managed, index, element);
+    if (element.type == vt_null) { // special treat to prevent useless expand
+        if (index < container->managed->array.length) {
+            container->managed->array.base[index].type = 0;
+        } // else do nothing
+    } else {
+        buffer_put(container->managed->array.base, container->managed->array.length, container->managed->array.capacity, index, js_normalize(element));
+    }
+}
+
+struct js_value js_get_managed_array_element(struct js_managed_value *managed, size_t index) {
+    if (index < managed->array.length) {
+        struct js_value ret = managed->array.base[index];
+        return ret.type == 0 ? js_null() : ret;
+    } else {
+        return js_null();
+    }
+}
+
+// objects with more keys than js_shape_max_length are treated as maps and fall back to dictionary mode, so are all new layouts after heap has too many shapes
+#define _shape_max_count 16384
+
+// returns slot index, or -1 if not found
+int32_t js_shape_find(struct js_shape *shape, struct js_atom *atom) {
+    for (uint32_t i = 0; i < shape->length; i++) {
+        if (shape->keys[i] == atom) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+// returns child which adds atom, or NULL if should fall back to dictionary mode
+static struct js_shape *_shape_transit(struct js_heap *heap, struct js_shape *shape, struct js_atom *atom) {
+    struct js_shape *child;
+    struct js_value index = js_map_get_atom(shape->transitions.base, shape->transitions.length, shape->transitions.capacity, atom);
+    if (index.type == vt_number) {
+        return shape->children.base[(uint32_t)index.number];
+    }
+    if (shape->length >= js_shape_max_length || heap->shapes.length >= _shape_max_count) {
+        return NULL;
+    }
+    child = alloc(struct js_shape, 1);
+    child->parent = shape;
+    child->length = shape->length + 1;
+    child->keys = alloc(struct js_atom *, child->length);
+    if (shape->length > 0) {
+        memcpy(child->keys, shape->keys, shape->length * sizeof(struct js_atom *));
+    }
+    child->keys[shape->length] = atom;
+    child->id = (uint32_t)heap->shapes.length;
+    atom->permanent = 1; // shapes live as long as heap
+    js_map_put_atom(shape->transitions.base, shape->transitions.length, shape->transitions.capacity, atom, js_number(shape->children.length));
+    buffer_push(shape->children.base, shape->children.length, shape->children.capacity, child);
+    buffer_push(heap->shapes.base, heap->shapes.length, heap->shapes.capacity, child);
+    return child;
+}
+
+// move slots into a newly built map, irreversible
+static void _object_to_dictionary(struct js_managed_value *managed) {
+    struct js_shape *shape = managed->object.shape;
+    struct js_value *slots = managed->object.slots;
+    size_t length = managed->object.length;
+    managed->object.base = NULL;
+    managed->object.length = 0;
+    managed->object.capacity = 0;
+    managed->object.shape = NULL;
+    for (size_t i = 0; i < length; i++) {
+        js_map_put_atom(managed->object.base, managed->object.length, managed->object.capacity, shape->keys[i], slots[i]);
+    }
+    free(slots);
+}
+
+struct js_value js_object(struct js_heap *heap) {
+    struct js_value ret = js_alloc_managed(heap, vt_object);
+    // struct js_value ret = {.type = vt_object};
+    // ret.managed = alloc(struct js_managed_value, 1);
+    // ret.managed->type = vt_object;
+    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+    if (heap->shapes.length == 0) {
+        struct js_shape *root = alloc(struct js_shape, 1);
+        buffer_push(heap->shapes.base, heap->shapes.length, heap->shapes.capacity, root);
+    }
+    ret.managed->object.shape = heap->shapes.base[0];
+    return ret;
+}
+
+// null means delete
+void js_put_object_atom(struct js_heap *heap, struct js_value *container, struct js_atom *atom, struct js_value element) {
+    struct js_managed_value *managed = container->managed;
+    element = js_normalize(element);
+    if (element.type == vt_null) {
+        element = (struct js_value){0};
+    }
+    js_write_barrier(heap, managed, element);
+    if (managed->in_use && heap->phase == gc_marking) { // key of marked object, see _mark_keys
+        atom->in_use = 1;
+    }
+    if (managed->object.shape) {
+        int32_t index = js_shape_find(managed->object.shape, atom);
+        if (index >= 0 && element.type != 0) {
+            managed->object.slots[index] = element;
+            return;
+        } else if (index < 0 && element.type == 0) {
+            return;
+        } else if (index < 0) {
+            struct js_shape *child = _shape_transit(heap, managed->object.shape, atom);
+            if (child) {
+                buffer_push(managed->object.slots, managed->object.length, managed->object.capacity, element);
+                managed->object.shape = child;
+                return;
+            }
+        }
+        _object_to_dictionary(managed); // deleting or too many keys
+    }
+    js_map_put_atom(managed->object.base, managed->object.length, managed->object.capacity, atom, element);
+}
+
+void js_put_object_value(struct js_heap *heap, struct js_value *container, const char *key, uint16_t key_length, struct js_value element) {
+    struct js_atom *atom = element.type == vt_null ? js_find_atom(heap, key, key_length) : _intern(heap, key, key_length, false);
+    if (atom) {
+        js_put_object_atom(heap, container, atom, element);
+    }
+}
+
+struct js_value js_get_object_atom(struct js_value *container, struct js_atom *atom) {
+    struct js_managed_value *managed = container->managed;
+    struct js_value ret;
+    if (managed->object.shape) {
+        int32_t index = js_shape_find(managed->object.shape, atom);
+        return index >= 0 ? managed->object.slots[index] : js_null();
+    }
+    ret = js_map_get_atom(managed->object.base, managed->object.length, managed->object.capacity, atom);
+    return ret.type == 0 ? js_null() : ret;
+}
+
+struct js_value js_get_object_value(struct js_heap *heap, struct js_value *container, const char *key, uint16_t key_length) {
+    struct js_atom *atom = js_find_atom(heap, key, key_length);
+    return atom ? js_get_object_atom(container, atom) : js_null();
+}
+
+struct js_value js_function(struct js_heap *heap, uint32_t ingress) {
+    struct js_value ret = js_alloc_managed(heap, vt_function);
+    // struct js_value ret = {.type = vt_function};
+    // ret.managed = alloc(struct js_managed_value, 1);
+    // ret.managed->type = vt_function;
+    ret.managed->function.ingress = ingress;
+    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+    return ret;
+}
+
+bool js_is_function(struct js_value *value) {
+    return value->type == vt_function || value->type == vt_c_function;
+}
+
+struct js_value js_c_data(struct js_heap *heap, void *data, void (*mark)(struct js_heap *, void *), void (*sweep)(void *)) {
+    struct js_value ret = js_alloc_managed(heap, vt_c_data);
+    // struct js_value ret = {.type = vt_c_data};
+    // ret.managed = alloc(struct js_managed_value, 1);
+    // ret.managed->type = vt_c_data;
+    ret.managed->c_data.data = data;
+    ret.managed->c_data.mark = mark;
+    ret.managed->c_data.sweep = sweep;
+    if (heap->nursery && mark) { // see js_alloc_nursery
+        ret.managed->remembered = 1;
+        buffer_push(heap->nursery->remembered.base, heap->nursery->remembered.length, heap->nursery->remembered.capacity, ret.managed);
+    }
+    // buffer_push(heap->base, heap->length, heap->capacity, ret.managed);
+    return ret;
+}
+
+
+static void _promote(struct js_heap *, struct js_value *);
+static void _visit_children(struct js_heap *, struct js_managed_value *, void (*)(struct js_heap *, struct js_value *));
+
+#define _mark_chunk 4096 // elements of array visited before the rest is pushed back, so long array doesn't flood mark stack
+#define _prefetch_distance 8 // elements ahead whose headers are prefetched
+
+static inline void _mark_stack_push(struct js_heap *heap, struct js_value *value) {
+    struct js_managed_value *managed = value->managed;
+    struct js_mark_entry entry;
+    if (value->type == vt_scripture) {
+        js_atom_of(value->scripture.base)->in_use = 1;
+    } else if (js_is_managed(value->type) && !managed->in_use) {
+        managed->in_use = 1;
+        if (managed->type != vt_string) {
+            entry.managed = managed;
+            entry.index = 0;
+            buffer_push(heap->mark_stack.base, heap->mark_stack.length, heap->mark_stack.capacity, entry);
+        }
+    }
+}
+
+// marks value, its children are visited later from mark stack, c data's mark function may call it instead of js_mark
+void js_mark_push(struct js_heap *heap, struct js_value *value) {
+    if (heap->scavenging) {
+        _promote(heap, value);
+    } else if (heap->shading) {
+        if (js_is_managed(value->type)) {
+            js_shade(heap, value->managed);
+        } else if (value->type == vt_scripture) {
+            js_atom_of(value->scripture.base)->in_use = 1;
+        }
+    } else {
+        _mark_stack_push(heap, value);
+    }
+}
+
+// keys of dictionary mode object may be atoms of run time strings, deleted ones are kept as key too, shape keys are permanent
+static void _mark_keys(struct js_managed_value *managed) {
+    if (managed->type == vt_object && managed->object.shape == NULL) {
+        for (size_t i = 0; i < managed->object.capacity; i++) {
+            if (managed->object.base[i].key.base) {
+                js_atom_of(managed->object.base[i].key.base)->in_use = 1;
+            }
+        }
+    }
+}
+
+static void _drain_mark_stack(struct js_heap *heap) {
+    struct js_mark_entry entry;
+    struct js_managed_value *managed;
+    struct js_value *base;
+    size_t end;
+    heap->draining = true;
+    while (heap->mark_stack.length > 0) {
+        entry = heap->mark_stack.base[--heap->mark_stack.length];
+        managed = entry.managed;
+        switch (managed->type) {
+        case vt_array:
+            base = managed->array.base;
+            end = managed->array.length;
+            if (end - entry.index > _mark_chunk) {
+                end = entry.index + _mark_chunk;
+                heap->mark_stack.base[heap->mark_stack.length++] = (struct js_mark_entry){.managed = managed, .index = end}; // popped slot
+            }
+            for (size_t i = entry.index; i < end; i++) {
+                if (i + _prefetch_distance < end && js_is_managed(base[i + _prefetch_distance].type)) {
+                    prefetch(base[i + _prefetch_distance].managed);
+                }
+                _mark_stack_push(heap, base + i);
+            }
+            break;
+        case vt_object:
+            _mark_keys(managed);
+            js_object_for_each(managed, k, kl, v, {
+                (void)k;
+                (void)kl;
+                _mark_stack_push(heap, v);
+            });
+            break;
+        case vt_function:
+            js_map_for_each(managed->function.closure.base, _, managed->function.closure.capacity, k, kl, v, {
+                (void)k;
+                (void)kl;
+                _mark_stack_push(heap, v);
+            });
+            break;
+        default:
+            _visit_children(heap, managed, js_mark_push); // c data's mark function calls js_mark, which only pushes now
+            break;
+        }
+    }
+    heap->draining = false;
+}
+
+// marks value and everything it refers to, with mark stack instead of recursion, so deep structures don't overflow c stack
+void js_mark(struct js_heap *heap, struct js_value *value) {
+    js_mark_push(heap, value);
+    if (!heap->draining && !heap->scavenging && !heap->shading) {
+        _drain_mark_stack(heap);
+    }
+}
+
+// frees what managed value owns, not itself, which may be a nursery cell
+static void _free_managed(struct js_managed_value *managed) {
+    switch (managed->type) {
+    case vt_string:
+        buffer_free(managed->string.base, managed->string.length, managed->string.capacity);
+        break;
+    case vt_array:
+        buffer_free(managed->array.base, managed->array.length, managed->array.capacity);
+        break;
+    case vt_object: {
+        if (managed->object.shape) {
+            buffer_free(managed->object.slots, managed->object.length, managed->object.capacity);
+        } else {
+            js_map_free(managed->object.base, managed->object.length, managed->object.capacity);
+        }
+        break;
+    }
+    case vt_function: {
+        js_map_free(managed->function.closure.base, managed->function.closure.length, managed->function.closure.capacity);
+        break;
+    }
+    case vt_c_data: {
+        if (managed->c_data.sweep) {
+            managed->c_data.sweep(managed->c_data.data);
+        }
+        break;
+    }
+    default:
+        fatal("Illegal managed type \"%u\"", managed->type);
+        break;
+    }
+}
+
+// remembered entries are old, drop those to be freed, in place
+static void _forget_unmarked(struct js_nursery *nursery) {
+    size_t kept = 0;
+    for (size_t i = 0; i < nursery->remembered.length; i++) {
+        if (nursery->remembered.base[i]->in_use) {
+            nursery->remembered.base[kept++] = nursery->remembered.base[i];
+        }
+    }
+    nursery->remembered.length = kept;
+}
+
+// heap vector grows again until next collection, so memory is given back only if survivors use less than a quarter of it
+static void _shrink_heap(struct js_heap *heap) {
+    size_t capacity = max(heap->length * 2, (size_t)64);
+    if (capacity < heap->capacity / 2) {
+        heap->base = (struct js_managed_value **)realloc(heap->base, capacity * sizeof(struct js_managed_value *));
+        enforce(heap->base != NULL);
+        heap->capacity = capacity;
+    }
+}
+
+// marks from js_mark decide, incremental collection in progress is abandoned
+// survivors are moved to front of heap vector in place, keeping order
+void js_sweep(struct js_heap *heap) {
+    struct js_nursery *nursery = heap->nursery;
+    struct js_managed_value *v;
+    size_t kept = 0;
+    bool empty = true;
+    heap->phase = gc_idle;
+    buffer_free(heap->gray.base, heap->gray.length, heap->gray.capacity);
+    buffer_free(heap->mark_stack.base, heap->mark_stack.length, heap->mark_stack.capacity);
+    if (nursery) {
+        _forget_unmarked(nursery);
+        // normally empty after js_scavenge, marked ones stay where they are
+        for (size_t i = 0; i < nursery->length; i++) {
+            v = nursery->cells + i;
+            if (v->type == 0) {
+                continue;
+            } else if (v->in_use) {
+                v->in_use = 0;
+                empty = false;
+            } else {
+                _free_managed(v);
+                v->type = 0;
+            }
+        }
+        if (empty) {
+            memset(nursery->cells, 0, nursery->length * sizeof(struct js_managed_value));
+            nursery->length = 0;
+        }
+    }
+    for (size_t i = 0; i < heap->length; i++) {
+        v = heap->base[i];
+        if (v->in_use) {
+            v->in_use = 0;
+            heap->base[kept++] = v;
+        } else {
+            _free_managed(v);
+            free(v);
+        }
+    }
+    heap->length = kept;
+    _shrink_heap(heap);
+    _sweep_atoms(heap);
+}
+
+// frees every value, then what heap itself owns, it can be used again as an empty heap
+void js_free_heap(struct js_heap *heap) {
+    js_sweep(heap);
+    js_sweep(heap); // second round sweep remained all
+    buffer_free(heap->base, heap->length, heap->capacity);
+    js_free_nursery(heap);
+    buffer_for_each(heap->shapes.base, heap->shapes.length, heap->shapes.capacity, i, shape, {
+        buffer_free((*shape)->children.base, (*shape)->children.length, (*shape)->children.capacity);
+        js_map_free((*shape)->transitions.base, (*shape)->transitions.length, (*shape)->transitions.capacity);
+        free((*shape)->keys);
+        free(*shape);
+    });
+    buffer_free(heap->shapes.base, heap->shapes.length, heap->shapes.capacity);
+    for (size_t i = 0; i < heap->atoms.capacity; i++) {
+        free(heap->atoms.base[i]);
+    }
+    buffer_free(heap->atoms.base, heap->atoms.length, heap->atoms.capacity);
+}
+
+void js_alloc_nursery(struct js_heap *heap) {
+    void *allocation;
+    struct js_nursery *nursery;
+    if (heap->nursery) {
+        return;
+    }
+    // over allocate to align, pages never touched are not committed by most systems
+    allocation = malloc(js_nursery_size * 2);
+    enforce(allocation != NULL);
+    nursery = (struct js_nursery *)(((uintptr_t)allocation + js_nursery_size - 1) & ~(uintptr_t)(js_nursery_size - 1));
+    memset(nursery, 0, js_nursery_size);
+    nursery->allocation = allocation;
+    nursery->capacity = (js_nursery_size - sizeof(struct js_nursery)) / sizeof(struct js_managed_value);
+    heap->nursery = nursery;
+    // c data's mark function may keep young values without write barrier, so it is always remembered
+    buffer_for_each(heap->base, heap->length, heap->capacity, i, v, {
+        if ((*v)->type == vt_c_data && (*v)->c_data.mark) {
+            (*v)->remembered = 1;
+            buffer_push(nursery->remembered.base, nursery->remembered.length, nursery->remembered.capacity, *v);
+        }
+    });
+}
+
+// after values are swept, so it is empty
+void js_free_nursery(struct js_heap *heap) {
+    struct js_nursery *nursery = heap->nursery;
+    if (nursery) {
+        enforce(nursery->length == 0);
+        buffer_free(nursery->remembered.base, nursery->remembered.length, nursery->remembered.capacity);
+        free(nursery->allocation);
+        heap->nursery = NULL;
+    }
+}
+
+// nursery has no room, or old generation reaches threshold, or incremental collection is due for next slice
+bool js_heap_exhausted(struct js_heap *heap) {
+    if (heap->nursery && heap->nursery->length >= heap->nursery->capacity) {
+        return true;
+    } else if (heap->phase != gc_idle) {
+        return heap->allocated >= js_gc_slice_interval;
+    } else {
+        return heap->threshold != 0 && heap->length + heap->runtime_atoms >= heap->threshold;
+    }
+}
+
+// slow path of js_write_barrier, container doesn't know its heap, but young value's nursery is found by address
+void js_remember(struct js_managed_value *container, struct js_managed_value *young) {
+    struct js_nursery *nursery = (struct js_nursery *)((uintptr_t)young & ~(uintptr_t)(js_nursery_size - 1));
+    container->remembered = 1;
+    buffer_push(nursery->remembered.base, nursery->remembered.length, nursery->remembered.capacity, container);
+}
+
+// copy young value to old generation once, its cell keeps forward address, then value refers to copy
+static void _promote(struct js_heap *heap, struct js_value *value) {
+    struct js_managed_value *young = value->managed, *old;
+    if (!js_is_managed(value->type) || !young->young) {
+        return;
+    }
+    if (young->type != 0) {
+        old = alloc(struct js_managed_value, 1);
+        *old = *young;
+        old->young = 0;
+        buffer_push(heap->base, heap->length, heap->capacity, old);
+        if (heap->phase == gc_marking) { // like js_alloc_managed
+            _gray(heap, old);
+        } else if (heap->phase == gc_sweeping) {
+            old->in_use = 1;
+        }
+        young->type = 0;
+        young->forward = old;
+    }
+    value->managed = young->forward;
+}
+
+// calls visit on every value managed value refers to, c data's mark function calls js_mark instead
+static void _visit_children(struct js_heap *heap, struct js_managed_value *managed, void (*visit)(struct js_heap *, struct js_value *)) {
+    switch (managed->type) {
+    case vt_array:
+        buffer_for_each(managed->array.base, managed->array.length, _, i, v, {
+            (void)i;
+            visit(heap, v);
+        });
+        break;
+    case vt_object:
+        js_object_for_each(managed, k, kl, v, {
+            (void)k;
+            (void)kl;
+            visit(heap, v);
+        });
+        break;
+    case vt_function:
+        js_map_for_each(managed->function.closure.base, _, managed->function.closure.capacity, k, kl, v, {
+            (void)k;
+            (void)kl;
+            visit(heap, v);
+        });
+        break;
+    case vt_c_data:
+        if (managed->c_data.mark) {
+            managed->c_data.mark(heap, managed->c_data.data);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// collect young generation only, roots function calls js_mark on every root like before js_sweep, which promotes young ones in place
+// then values referred by remembered and promoted ones are promoted breadth first, others left in nursery are freed
+// old values are neither visited nor freed, leave them to js_mark and js_sweep
+void js_scavenge(struct js_heap *heap, void (*roots)(void *), void *context) {
+    struct js_nursery *nursery = heap->nursery;
+    size_t kept = 0;
+    size_t scanned = heap->length;
+    if (nursery == NULL) {
+        return;
+    }
+    heap->scavenging = true;
+    roots(context);
+    buffer_for_each(nursery->remembered.base, nursery->remembered.length, nursery->remembered.capacity, i, v, {
+        if ((*v)->type == vt_array) {
+            for (size_t j = (*v)->array.remembered_from; j < (*v)->array.length; j++) {
+                _promote(heap, (*v)->array.base + j);
+            }
+        } else {
+            _visit_children(heap, *v, _promote);
+        }
+        if ((*v)->type == vt_c_data) { // stays, see js_alloc_nursery
+            nursery->remembered.base[kept++] = *v;
+        } else {
+            (*v)->remembered = 0;
+        }
+    });
+    nursery->remembered.length = kept;
+    for (; scanned < heap->length; scanned++) {
+        _visit_children(heap, heap->base[scanned], _promote);
+    }
+    heap->scavenging = false;
+    for (size_t i = 0; i < nursery->length; i++) {
+        if (nursery->cells[i].type != 0) {
+            _free_managed(nursery->cells + i);
+        }
+    }
+    memset(nursery->cells, 0, nursery->length * sizeof(struct js_managed_value));
+    nursery->length = 0;
+}
+
+static void _gray(struct js_heap *heap, struct js_managed_value *managed) {
+    managed->in_use = 1;
+    buffer_push(heap->gray.base, heap->gray.length, heap->gray.capacity, managed);
+}
+
+// slow path of js_write_barrier, white old value of heap being marked turns gray, young ones are left to js_scavenge
+void js_shade(struct js_heap *heap, struct js_managed_value *managed) {
+    if (heap->phase == gc_marking && !managed->young && !managed->in_use) {
+        _gray(heap, managed);
+    }
+}
+
+// one slice of collecting old generation incrementally, returns true if a whole cycle is done
+// first slice shades roots, each slice turns gray values black, or frees unmarked values, until budget of objects or microseconds is used up
+// roots and c data's mark functions have no write barrier, young values aren't marked, so marking ends with collecting young generation, then shading all of them again
+// budget 0 and 0, or heap without nursery, collects at once
+bool js_collect_slice(struct js_heap *heap, void (*roots)(void *), void *context, size_t objects, uint32_t microseconds) {
+    clock_t deadline = microseconds ? clock() + (clock_t)((double)microseconds * CLOCKS_PER_SEC / 1000000) : 0;
+    size_t visited = 0;
+    bool final = false;
+    struct js_nursery *nursery = heap->nursery;
+    struct js_managed_value *managed;
+    if (nursery == NULL || (objects == 0 && microseconds == 0)) {
+        objects = SIZE_MAX;
+        deadline = 0;
+    } else if (objects == 0) {
+        objects = SIZE_MAX;
+    }
+#define __used_up() (visited >= objects || (deadline && visited % 64 == 0 && clock() >= deadline))
+    heap->allocated = 0;
+    if (heap->phase == gc_idle) {
+        heap->phase = gc_marking;
+        heap->shading = true;
+        roots(context);
+        heap->shading = false;
+    }
+    while (heap->phase == gc_marking) {
+        if (heap->gray.length > 0) {
+            if (!final && __used_up()) {
+                return false;
+            }
+            managed = heap->gray.base[--heap->gray.length];
+            _mark_keys(managed);
+            heap->shading = true;
+            _visit_children(heap, managed, js_mark_push);
+            heap->shading = false;
+            visited++;
+        } else if (!final) {
+            final = true;
+            js_scavenge(heap, roots, context); // promoted values are gray
+            heap->shading = true;
+            roots(context);
+            if (nursery) {
+                buffer_for_each(nursery->remembered.base, nursery->remembered.length, nursery->remembered.capacity, i, v, {
+                    if ((*v)->type == vt_c_data) {
+                        _visit_children(heap, *v, js_mark_push);
+                    }
+                });
+            }
+            heap->shading = false;
+        } else {
+            if (nursery) {
+                _forget_unmarked(nursery);
+            }
+            buffer_free(heap->gray.base, heap->gray.length, heap->gray.capacity);
+            _sweep_atoms(heap); // at once, values freed later don't use them
+            heap->phase = gc_sweeping;
+            heap->swept = 0;
+        }
+    }
+    // values allocated or promoted meanwhile are appended and marked, freed one is replaced by last one, so every value is checked once
+    while (heap->swept < heap->length) {
+        if (__used_up()) {
+            return false;
+        }
+        managed = heap->base[heap->swept];
+        if (managed->in_use) {
+            managed->in_use = 0;
+            heap->swept++;
+        } else {
+            _free_managed(managed);
+            free(managed);
+            heap->base[heap->swept] = heap->base[--heap->length];
+        }
+        visited++;
+    }
+#undef __used_up
+    _shrink_heap(heap);
+    heap->phase = gc_idle;
+    return true;
+}
+
+static bool _json_unprintable(enum js_value_type type) {
+    return type == vt_undefined || type == vt_function || type == vt_c_function || type == vt_c_data;
+}
+
+static void _serialize_string(struct print_stream *out, enum serialized_style to, char *base, size_t length, size_t depth) {
+    bool zero_depth_tostring = (to == tostring_style && depth == 0);
+    putsz_to_stream(out, zero_depth_tostring ? "" : (to == tojson_style ? "\"" : "'"));
+    if (zero_depth_tostring) {
+        puts_to_stream(out, base, length);
+    } else {
+        escape_to_stream(out, base, length);
+    }
+    putsz_to_stream(out, zero_depth_tostring ? "" : (to == tojson_style ? "\"" : "'"));
+}
+
+void js_serialize_managed_value(struct print_stream *out, enum serialized_style to, struct js_managed_value *managed, size_t depth) {
+    bool first;
+    switch (managed->type) {
+    case vt_string:
+        _serialize_string(out, to, managed->string.base, managed->string.length, depth);
+        break;
+    case vt_array:
+        if (to == tojson_style) {
+            putsz_to_stream(out, "[");
+            first = true;
+            for (size_t i = 0; i < managed->array.length; i++) {
+                first ? (first = false) : putsz_to_stream(out, ",");
+                struct js_value elem = js_get_managed_array_element(managed, i);
+                if (_json_unprintable(elem.type)) {
+                    // in array, un-jsonizables presented as null
+                    putsz_to_stream(out, "null");
+                } else {
+                    js_serialize_value(out, to, &elem, depth + 1);
+                }
+            }
+            putsz_to_stream(out, "]");
+        } else if (to == todump_style || (to == tostring_style && depth == 0)) {
+            putsz_to_stream(out, "[");
+            first = true;
+            js_list_for_each(managed->array.base, managed->array.length, _, i, v, {
+                first ? (first = false) : putsz_to_stream(out, ",");
+                printf_to_stream(out, "%zu:", i);
+                js_serialize_value(out, to, v, depth + 1);
+            });
+            putsz_to_stream(out, "]");
+        } else {
+            putsz_to_stream(out, "<array>");
+        }
+        break;
+    case vt_object:
+        if (to == todump_style || to == tojson_style || (to == tostring_style && depth == 0)) {
+            putsz_to_stream(out, "{");
+            first = true;
+            js_object_for_each(managed, k, kl, v, {
+                if (to == tojson_style && _json_unprintable(v->type)) {
+                    continue;
+                }
+                first ? (first = false) : putsz_to_stream(out, ",");
+                putsz_to_stream(out, to == tojson_style ? "\"" : "'");
+                escape_to_stream(out, k, kl);
+                putsz_to_stream(out, to == tojson_style ? "\"" : "'");
+                putsz_to_stream(out, ":");
+                js_serialize_value(out, to, v, depth + 1);
+            });
+            putsz_to_stream(out, "}");
+        } else {
+            putsz_to_stream(out, "<object>");
+        }
+        break;
+    case vt_function:
+        if (to == todump_style) {
+            printf_to_stream(out, "<function %u {", managed->function.ingress);
+            first = true;
+            js_map_for_each(managed->function.closure.base, _, managed->function.closure.capacity, k, kl, v, {
+                first ? (first = false) : putsz_to_stream(out, ",");
+                printf_to_stream(out, "%.*s:", (int)kl, k);
+                js_serialize_value(out, to, v, depth + 1);
+            });
+            putsz_to_stream(out, "}>");
+        } else if (to == tostring_style) {
+            putsz_to_stream(out, "<function>");
+        }
+        break;
+    case vt_c_data:
+        if (to == todump_style) {
+            printf_to_stream(out, "<c_data %p %p %p>", managed->c_data.data, managed->c_data.mark, managed->c_data.sweep);
+        } else if (to == tostring_style) {
+            putsz_to_stream(out, "<c_data>");
+        }
+        break;
+    default:
+        fatal("Unknown managed value type %d", managed->type);
+    }
+}
+
+// DON'T use '_serialize()', possible confilct with internal functions
+void js_serialize_value(struct print_stream *out, enum serialized_style to, struct js_value *value, size_t depth) {
+    switch (value->type) {
+    case vt_undefined:
+        if (to == todump_style || to == tojson_style) {
+            printf_to_stream(out, "undefined");
+        }
+        break;
+    case vt_null:
+        printf_to_stream(out, "null");
+        break;
+    case vt_boolean:
+        printf_to_stream(out, value->boolean ? "true" : "false");
+        break;
+    case vt_number:
+        printf_to_stream(out, "%lg", value->number);
+        break;
+    case vt_integer:
+        printf_to_stream(out, "%lg", (double)value->integer);
+        break;
+    case vt_scripture:
+        _serialize_string(out, to, value->scripture.base, js_atom_of(value->scripture.base)->length, depth);
+        break;
+    case vt_c_function:
+        if (to == todump_style) {
+            printf_to_stream(out, "<c_function %p>", value->c_function);
+        } else if (to == tostring_style) {
+            putsz_to_stream(out, "<c_function>");
+        }
+        break;
+    case vt_string:
+    case vt_array:
+    case vt_object:
+    case vt_function:
+    case vt_c_data:
+        js_serialize_managed_value(out, to, value->managed, depth);
+        break;
+    default:
+        fatal("Unknown value type %d", value->type);
+    }
+}
+
+void js_dump_value(struct js_value *value) {
+    struct print_stream out = {.type = file_stream, .fp = stdout};
+    js_serialize_value(&out, todump_style, value, 0);
+}
+
+bool js_is_string(struct js_value *value) {
+    return value->type == vt_scripture || value->type == vt_string;
+}
+
+char *js_get_string_base(struct js_value *value) {
+    switch (value->type) {
+    case vt_scripture:
+        return value->scripture.base;
+    case vt_string:
+        return value->managed->string.base;
+    default:
+        return NULL;
+    }
+}
+
+size_t js_get_string_length(struct js_value *value) {
+    switch (value->type) {
+    case vt_scripture:
+        return js_atom_of(value->scripture.base)->length;
+    case vt_string:
+        return value->managed->string.length;
+    default:
+        return 0;
+    }
+}
+
+int js_compare_string(struct js_value *lhs, struct js_value *rhs) {
+    if (lhs->type == vt_scripture && rhs->type == vt_scripture && lhs->scripture.base == rhs->scripture.base) { // same atom
+        return 0;
+    }
+    char *pl = js_get_string_base(lhs);
+    size_t ll = js_get_string_length(lhs);
+    char *pr = js_get_string_base(rhs);
+    size_t lr = js_get_string_length(rhs);
+    return strncmp(pl, pr, max(ll, lr));
+}
+
+struct js_result js_add(struct js_heap *heap, struct js_value *lhs, struct js_value *rhs) {
+    struct js_value value;
+    if (js_is_number(lhs) && js_is_number(rhs)) {
+        js_return(js_number(js_get_number(lhs) + js_get_number(rhs)));
+    } else if (js_is_string(lhs) && js_is_string(rhs)) {
+        value = js_string(heap, js_get_string_base(lhs), js_get_string_length(lhs));
+        string_buffer_append(value.managed->string.base, value.managed->string.length, value.managed->string.capacity, js_get_string_base(rhs), js_get_string_length(rhs));
+        js_return(value);
+    } else {
+        js_throw(js_scripture_sz(heap, "Add operand must be number or string"));
+    }
+}
+
+#ifdef DEBUG
+
+void test_data_structure_size() {
+    log_expression("%zu", sizeof(struct js_value));
+    log_expression("%zu", sizeof(struct js_kv_pair));
+    log_expression("%zu", sizeof(struct js_variable_map));
+    log_expression("%zu", sizeof(struct js_managed_value));
+    log_expression("%zu", sizeof(struct js_heap));
+    log_expression("%zu", sizeof(struct js_result));
+}
+
+void test_js_map() {
+    struct js_heap heap = {0};
+    struct js_kv_pair *p = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    for (int i = 0; i < 10; i++) {
+        char *key = random_sz_static(NULL);
+        struct js_value val, ret;
+        val.type = vt_number;
+        val.number = random_double();
+        js_map_put_sz(&heap, p, len, cap, key, val);
+        ret = js_map_get_sz(&heap, p, len, cap, key);
+        enforce(ret.type == vt_number);
+        enforce(ret.number == val.number);
+        printf("len=%zu cap=%zu\n", len, cap);
+    }
+    js_map_for_each(p, _, cap, key, klen, val, {
+        printf("%.*s %g\n", (int)klen, key, val->number);
+    });
+    js_map_free(p, len, cap);
+    js_free_heap(&heap);
+}
+
+void test_js_map_loop() {
+    struct js_heap heap = {0};
+    struct js_kv_pair *p = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    for (;;) {
+        for (int i = 0; i < 100000; i++) {
+            char *key = random_sz_static(NULL);
+            struct js_value val = js_number(random_double());
+            js_map_put_sz(&heap, p, len, cap, key, val);
+            struct js_value ret = js_map_get_sz(&heap, p, len, cap, key);
+            enforce(ret.type == vt_number);
+            enforce(ret.number == val.number);
+            // random delete, to check stage 2
+            if (rand() % 2 == 0) {
+                js_map_put_sz(&heap, p, len, cap, key, (struct js_value){0});
+            }
+        }
+        printf("len=%zu cap=%zu\n", len, cap);
+        js_map_free(p, len, cap);
+        js_free_heap(&heap);
+        // js_map_free_internal(&p, &len, &cap);
+    }
+}
+
+static enum js_value_type _random_js_value_type() {
+    return rand() % (countof(_value_type_names) - 1) + 1;
+}
+
+struct tablet {
+    char foo;
+    short bar;
+    const char s[256];
+    int baz;
+    long qux;
+};
+
+static struct js_value _random_js_value(struct js_heap *heap, enum js_value_type type, size_t depth) {
+    // https://www.biblestudytools.com/topical-verses/the-25-most-read-bible-verses/
+    static const char *scriptures[] = {
+        "1. John 3:16 - For God so loved the world that he gave his one and only Son, that whoever believes in him shall not perish but have eternal life.",
+        "2. Jeremiah 29:11 - For I know the plans I have for you,” declares the LORD, “plans to prosper you and not to harm you, plans to give you hope and a future.",
+        "3. Romans 8:28 - And we know that in all things God works for the good of those who love him, who have been called according to his purpose.",
+        "4. Philippians 4:13 - I can do everything through him who gives me strength.",
+        "5. Genesis 1:1 - In the beginning God created the heavens and the earth.",
+        "6. Proverbs 3:5 - Trust in the LORD with all your heart and lean not on your own understanding.",
+        "7. Proverbs 3:6 - In all your ways acknowledge him, and he will make your paths straight.",
+        "8. Romans 12:2 - Do not conform any longer to the pattern of this world, but be transformed by the renewing of your mind. Then you will be able to test and approve what God's will is—his good, pleasing and perfect will.",
+        "9. Philippians 4:6 - Do not be anxious about anything, but in everything, by prayer and petition, with thanksgiving, present your requests to God.",
+        "10. Matthew 28:19 - Therefore go and make disciples of all nations, baptizing them in the name of the Father and of the Son and of the Holy Spirit.",
+    };
+    struct js_value ret;
+    int i;
+    if (depth >= 10) {
+        return js_null();
+    }
+    switch (type) {
+    case vt_null:
+        return js_null();
+    case vt_boolean:
+        return js_boolean(rand() % 2 == 1);
+    case vt_number:
+    case vt_integer:
+        return js_number(random_double());
+    case vt_scripture:
+        return js_scripture_sz(heap, scriptures[rand() % countof(scriptures)]);
+    case vt_string:
+        return js_string_sz(heap, random_sz_static(NULL));
+    case vt_array:
+        ret = js_array(heap);
+        for (i = 0; i < rand() % 10; i++) {
+            struct js_value v = _random_js_value(heap, _random_js_value_type(), depth + 1);
+            js_put_array_element(heap, &ret, rand() % 100, v);
+        }
+        return ret;
+    case vt_object:
+        ret = js_object(heap);
+        for (i = 0; i < rand() % 10; i++) {
+            struct js_value v = _random_js_value(heap, _random_js_value_type(), depth + 1);
+            js_put_object_value_sz(heap, &ret, random_sz_static(NULL), v);
+        }
+        return ret;
+    case vt_function:
+        ret = js_function(heap, rand() % UINT32_MAX);
+        for (i = 0; i < rand() % 10; i++) {
+            struct js_value v = _random_js_value(heap, _random_js_value_type(), depth + 1);
+            size_t len = ret.managed->function.closure.length; // uint16_t -> size_t
+            size_t cap = ret.managed->function.closure.capacity;
+            js_map_put_sz(heap, ret.managed->function.closure.base, len, cap, random_sz_static(NULL), v);
+            ret.managed->function.closure.length = (uint16_t)len; // size_t -> uint16_t
+            ret.managed->function.closure.capacity = (uint16_t)cap;
+        }
+        return ret;
+    case vt_c_function:
+        return (struct js_value){.type = vt_c_function, .c_function = (void *)(intptr_t)rand()};
+    case vt_c_data:
+        return js_c_data(heap, random_sz_dynamic(), NULL, free);
+    default:
+        fatal("Unknown value type %u", type);
+    }
+}
+
+void test_js_value() {
+    struct js_heap heap = {0};
+    for (enum js_value_type type = 1; type < countof(_value_type_names); type++) {
+        struct js_value val = _random_js_value(&heap, type, 0);
+        printf("%s: ", _value_type_names[type]);
+        js_dump_value(&val);
+        printf("\n");
+    }
+    js_free_heap(&heap);
+}
+
+void test_js_value_loop() {
+    struct js_heap heap = {0};
+    for (;;) {
+        for (int i = 0; i < 10000; i++) {
+            struct js_value val = _random_js_value(&heap, _random_js_value_type(), 0);
+            if (rand() % 10 == 0) { // mark 1/10 of them
+                js_mark(&heap, &val);
+            }
+        }
+        js_free_heap(&heap);
+        putchar('.');
+    }
+}
+
+void test_js_value_bug() {
+    // REPRODUCE BUG:
+    struct js_heap heap = {0};
+    const char *bug_keys[] = {"b",
+        "CVUcQn5KYZkjKSa1eJAsg0nUQsnZBdSNquxXsYnwIoNTEAtZBOt",
+        "Swy4fCH8h03lkwQwW9BxW7O3dH9EReeng80wiI37Jwid6RXMwQ0cgiPn",
+        "EFvi653FKJKm04nqvfux6YzKZhmukC7biyUhulH9eLPxZUX"};
+    for (int i = 0; i < countof(bug_keys); i++) {
+        const char *k = bug_keys[i];
+        size_t fh = _hash(k, (uint16_t)strlen(k)) & 0b01;
+        size_t nh = _next_hash(fh, 0b01);
+        printf("%d. %s %zu %zu\n", i, k, fh, nh);
+    }
+    struct js_value obj = js_object(&heap);
+    js_put_object_value_sz(&heap, &obj, bug_keys[0], js_boolean(true));
+    js_put_object_value_sz(&heap, &obj, bug_keys[0], js_null());
+    js_put_object_value_sz(&heap, &obj, bug_keys[2], js_boolean(true));
+    js_put_object_value_sz(&heap, &obj, bug_keys[1], js_boolean(true));
+    js_put_object_value_sz(&heap, &obj, bug_keys[3], js_boolean(true));
+}
+
+void test_js_string_family() {
+    struct js_heap heap = {0};
+    for (;;) {
+        for (uint8_t vt = vt_scripture; vt <= vt_string; vt++) {
+            struct js_value str = _random_js_value(&heap, vt, 0);
+            printf("%s %s %.*s\n", js_is_string(&str) ? "true" : "false", _value_type_names[vt], (int)js_get_string_length(&str), js_get_string_base(&str));
+            js_sweep(&heap);
+        }
+    }
+}
+
+void test_js_string_f() {
+    struct js_heap heap = {0};
+    for (;;) {
+        js_string_f(&heap, "/%g/%s", 3.14, "hello");
+        js_sweep(&heap);
+    }
+}
+
 #endif
\ No newline at end of file
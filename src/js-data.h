@@ -1,240 +1,467 @@
-/*
-Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
-
-This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
-
-This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
-
-You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
-*/
-
-#ifndef JS_DATA_H
-#define JS_DATA_H
-
-#include "js-common.h"
-
-// vt_undefined is used to distinguish between variable not exists and it's value is null, never return to user
-// remove 'inscription' string type, which is harmful, useless complexity, and i wan't strings always null terminated, or so many stdlib functions require null terminated string as argument will need to extra duplication and free operations, too complicated.
-#define js_value_type_list \
-    X(vt_undefined) /* 0 always means empty initial state  */ \
-    X(vt_null) \
-    X(vt_boolean) \
-    X(vt_number) \
-    X(vt_scripture) /* c string literal, always exists and null terminated */ \
-    X(vt_string) /*managed  */ \
-    X(vt_array) /* managed */ \
-    X(vt_object) /* managed */ \
-    X(vt_function) /* managed */ \
-    X(vt_c_function) \
-    X(vt_c_data) /* managed */
-
-#define X(name) name,
-enum js_value_type { js_value_type_list };
-#undef X
-
-struct js_managed_value;
-
-#pragma pack(push, 1)
-struct js_value {
-    uint8_t type;
-    union {
-        bool boolean;
-        double number;
-        struct {
-            char *base;
-            uint32_t length;
-        } scripture;
-        struct js_managed_value *managed; // string, array, object, function
-        void *c_function; // for source code module isolation, DON'T typedef
-    };
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct js_kv_pair {
-    struct {
-        char *base;
-        uint16_t length; // different length with string, DON'T use one struct definition
-        uint16_t capacity;
-    } key;
-    struct js_value value;
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct js_variable_map { // for globals, locals, arguments, closure, use uint16_t instead of size_t
-    struct js_kv_pair *base;
-    uint16_t length;
-    uint16_t capacity;
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct js_managed_value {
-    uint8_t type : 7;
-    uint8_t in_use : 1;
-    union {
-        struct {
-            char *base;
-            size_t length;
-            size_t capacity;
-        } string;
-        struct {
-            struct js_value *base;
-            size_t length;
-            size_t capacity;
-        } array;
-        struct {
-            struct js_kv_pair *base;
-            size_t length;
-            size_t capacity;
-        } object; // TODO: Add "last visited"? or in higher level such as js_get_variable?
-        struct {
-            uint32_t ingress; // Caution: egress is NOT fixed
-            struct js_variable_map closure;
-        } function;
-        struct {
-            void *data;
-            void (*mark)(void *); // this function pointer can also be used to verify data type
-            void (*sweep)(void *); // this function pointer can also be used to verify data type
-        } c_data;
-    };
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct js_heap {
-    struct js_managed_value **base;
-    size_t length;
-    size_t capacity;
-};
-#pragma pack(pop)
-
-// if success, value is return data, or it is error description
-#pragma pack(push, 1)
-struct js_result {
-    bool success;
-    struct js_value value;
-};
-#pragma pack(pop)
-
-enum serialized_style {
-    tostring_style,
-    tojson_style,
-    todump_style,
-};
-
-// DON'T use conflict name such as 'k' 'v'
-#define js_map_for_each(__arg_base, __arg_length, __arg_capacity, __arg_k, __arg_kl, __arg_v, __arg_statement) \
-    do { \
-        struct js_kv_pair *__base = (__arg_base); \
-        typeof(__arg_capacity) __cap = (__arg_capacity); \
-        for (typeof(__cap) __i = 0; __i < __cap; __i++) { \
-            struct js_kv_pair *__kv = __base + __i; \
-            char *__arg_k = __kv->key.base; \
-            typeof(__kv->key.length) __arg_kl = __kv->key.length; \
-            struct js_value *__arg_v = &(__kv->value); \
-            if (__arg_k != NULL && __arg_v->type != 0) { \
-                __arg_statement; \
-            } \
-        } \
-    } while (0)
-
-// DON'T use conflict name such as 'list'
-#define js_list_for_each(__arg_base, __arg_length, __arg_capacity, __arg_i, __arg_v, __arg_statement) \
-    buffer_for_each(__arg_base, __arg_length, __arg_capacity, __arg_i, __arg_v, { \
-        if (__arg_v->type != 0) { \
-            __arg_statement; \
-        } \
-    })
-
-shared void js_map_dump(struct js_kv_pair *, size_t, size_t);
-shared void js_map_put_internal(struct js_kv_pair **, size_t *, size_t *, const char *, uint16_t, struct js_value);
-// remove '*' prefix, and fit for any type of 'length' 'capacity'
-#define js_map_put(__arg_base, __arg_length, __arg_capacity, __arg_key, __arg_key_length, __arg_value) \
-    do { \
-        size_t __len = __arg_length; \
-        size_t __cap = __arg_capacity; \
-        js_map_put_internal(&(__arg_base), &__len, &__cap, __arg_key, __arg_key_length, __arg_value); \
-        __arg_length = (typeof(__arg_length))__len; \
-        __arg_capacity = (typeof(__arg_capacity))__cap; \
-    } while (0)
-#define js_map_put_sz(__arg_base, __arg_length, __arg_capacity, __arg_key, __arg_value) \
-    js_map_put(__arg_base, __arg_length, __arg_capacity, __arg_key, (uint16_t)strlen(__arg_key), __arg_value)
-shared struct js_value js_map_get(struct js_kv_pair *, size_t, size_t, const char *, uint16_t);
-shared struct js_value js_map_get_sz(struct js_kv_pair *, size_t, size_t, const char *);
-// same as js_map_put
-#define js_map_free(__arg_base, __arg_length, __arg_capacity) \
-    do { \
-        for (typeof(__arg_capacity) __i = 0; __i < __arg_capacity; __i++) { \
-            struct js_kv_pair *__node = __arg_base + __i; \
-            if (__node->key.base) { \
-                buffer_free(__node->key.base, __node->key.length, __node->key.capacity); \
-            } \
-        } \
-        buffer_free(__arg_base, __arg_length, __arg_capacity); \
-    } while (0)
-// TODO: unify all js_value * parameters to js_value? is it necessary?
-shared struct js_value js_null();
-shared struct js_value js_boolean(bool);
-shared struct js_value js_number(double);
-shared struct js_value js_scripture_sz(const char *);
-shared struct js_value js_alloc_managed(struct js_heap *, enum js_value_type);
-shared struct js_value js_string(struct js_heap *, const char *, size_t);
-shared struct js_value js_string_sz(struct js_heap *, const char *);
-shared struct js_value js_string_f(struct js_heap *, const char *, ...);
-shared struct js_value js_array(struct js_heap *);
-shared void js_push_array_element(struct js_value *, struct js_value);
-shared void js_put_array_element(struct js_value *, size_t, struct js_value);
-shared struct js_value js_get_managed_array_element(struct js_managed_value *, size_t);
-static inline struct js_value js_get_array_element(struct js_value *container, size_t index) {
-    return js_get_managed_array_element(container->managed, index);
-}
-shared struct js_value js_object(struct js_heap *);
-shared void js_put_object_value(struct js_value *, const char *, uint16_t, struct js_value);
-static inline void js_put_object_value_sz(struct js_value *container, const char *key, struct js_value element) {
-    js_put_object_value(container, key, (uint16_t)strlen(key), element);
-}
-shared struct js_value js_get_object_value(struct js_value *, const char *, uint16_t);
-static inline struct js_value js_get_object_value_sz(struct js_value *container, const char *key) {
-    return js_get_object_value(container, key, (uint16_t)strlen(key));
-}
-shared struct js_value js_function(struct js_heap *, uint32_t);
-shared bool js_is_function(struct js_value *);
-shared struct js_value js_c_data(struct js_heap *, void *, void (*)(void *), void (*)(void *));
-shared void js_mark(struct js_value *);
-shared void js_sweep(struct js_heap *);
-shared void js_serialize_managed_value(struct print_stream *, enum serialized_style, struct js_managed_value *, size_t depth);
-shared void js_serialize_value(struct print_stream *, enum serialized_style, struct js_value *, size_t depth);
-shared void js_dump_value(struct js_value *);
-shared bool js_is_string(struct js_value *);
-shared char *js_get_string_base(struct js_value *); // Caution: No guarantee it ends with 0
-shared size_t js_get_string_length(struct js_value *);
-shared int js_compare_string(struct js_value *, struct js_value *);
-// Caution: '()' must be added in following macros
-#define js_return(__arg_value) \
-    return ((struct js_result){.success = true, .value = (__arg_value)})
-#define js_throw(__arg_value) \
-    return ((struct js_result){.success = false, .value = (__arg_value)})
-#define js_assert(__arg_expr) \
-    do { \
-        if (!(__arg_expr)) { \
-            js_throw(js_scripture_sz("Assertion failed: " #__arg_expr)); \
-        } \
-    } while (0)
-shared struct js_result js_add(struct js_heap *, struct js_value *, struct js_value *);
-
-#ifdef DEBUG
-
-shared void test_data_structure_size();
-shared void test_js_map();
-shared void test_js_map_loop();
-shared void test_js_value();
-shared void test_js_value_loop();
-shared void test_js_value_bug();
-shared void test_js_string_family();
-shared void test_js_string_f();
-
-#endif
-
+/*
+Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef JS_DATA_H
+#define JS_DATA_H
+
+#include "js-common.h"
+
+// vt_undefined is used to distinguish between variable not exists and it's value is null, never return to user
+// remove 'inscription' string type, which is harmful, useless complexity, and i wan't strings always null terminated, or so many stdlib functions require null terminated string as argument will need to extra duplication and free operations, too complicated.
+#define js_value_type_list \
+    X(vt_undefined) /* 0 always means empty initial state  */ \
+    X(vt_null) \
+    X(vt_boolean) \
+    X(vt_number) \
+    X(vt_integer) /* internal to vm, kept by arithmetic while results stay integral, normalized to vt_number before leaving vm */ \
+    X(vt_scripture) /* interned atom, always exists and null terminated, equal content means equal address */ \
+    X(vt_string) /*managed  */ \
+    X(vt_array) /* managed */ \
+    X(vt_object) /* managed */ \
+    X(vt_function) /* managed */ \
+    X(vt_c_function) \
+    X(vt_c_data) /* managed */
+
+#define X(name) name,
+enum js_value_type { js_value_type_list };
+#undef X
+
+struct js_managed_value;
+struct js_heap;
+
+// js_value layout, chosen at build time, all units and programs including this file must agree
+// default packs it into 9 bytes, number loads are unaligned
+// JS_VALUE_ALIGNED makes it 16 bytes naturally aligned, also structures embedding it
+#ifdef JS_VALUE_ALIGNED
+    #define js_value_pack_push
+    #define js_value_pack_pop
+#else
+    #define js_value_pack_push _Pragma("pack(push, 1)")
+    #define js_value_pack_pop _Pragma("pack(pop)")
+#endif
+
+js_value_pack_push
+struct js_value {
+    uint8_t type;
+    union {
+        bool boolean;
+        double number;
+        int32_t integer;
+        struct {
+            char *base; // atom's base, length is in atom
+        } scripture;
+        struct js_managed_value *managed; // string, array, object, function
+        void *c_function; // for source code module isolation, DON'T typedef
+    };
+};
+js_value_pack_pop
+
+// interned string of heap, same content always gets same atom, so that map keys and scriptures can be compared by address
+// all map keys are atoms, so length is limited to uint16_t, atoms of run time object keys are freed by collection when unreachable
+#pragma pack(push, 1)
+struct js_atom {
+    uint32_t hash; // unmasked, each map masks it with it's own capacity
+    uint16_t length;
+    uint8_t permanent : 1; // never freed until heap is, such as bytecode names, c literals and shape keys
+    uint8_t in_use : 1; // marked as object key or scripture value
+    char base[]; // null terminated
+};
+#pragma pack(pop)
+
+// hidden class, shared by objects whose keys are added in same order, so that objects only keep values
+// shapes form a transition tree from an empty root, each child adds one key, each heap has its own tree, freed with heap
+#define js_shape_max_length 32
+struct js_shape {
+    struct js_shape *parent;
+    struct js_atom **keys; // keys[i] is key of slot i, parent's keys are copied
+    uint32_t length;
+    uint32_t id; // index in heap's shapes
+    struct {
+        struct js_shape **base;
+        uint32_t length;
+        uint32_t capacity;
+    } children;
+    struct {
+        struct js_kv_pair *base;
+        size_t length;
+        size_t capacity;
+    } transitions; // key added -> index of children
+};
+
+#define js_atom_of(__arg_base) ((struct js_atom *)((char *)(__arg_base) - offsetof(struct js_atom, base)))
+
+js_value_pack_push
+struct js_kv_pair {
+    struct {
+        char *base; // atom's base, NULL means never used, kept after deletion, never freed by map
+        uint16_t length; // different length with string, DON'T use one struct definition
+    } key;
+    struct js_value value;
+};
+js_value_pack_pop
+
+#pragma pack(push, 1)
+struct js_variable_map { // for globals, locals, arguments, closure, use uint16_t instead of size_t
+    struct js_kv_pair *base;
+    uint16_t length;
+    uint16_t capacity;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct js_managed_value {
+    uint8_t type : 5; // 0 means promoted, only seen in young generation while collecting it
+    uint8_t young : 1; // in nursery, see js_nursery
+    uint8_t remembered : 1; // old value in nursery's remembered set
+    uint8_t in_use : 1; // marked, gray or black while old generation is marked incrementally, see js_collect_slice
+    union {
+        struct js_managed_value *forward; // promoted copy, if type is 0
+        struct {
+            char *base;
+            size_t length;
+            size_t capacity;
+        } string;
+        struct {
+            struct js_value *base;
+            size_t length;
+            size_t capacity;
+            size_t remembered_from; // if remembered, elements before it don't refer to young values
+        } array;
+        struct {
+            union {
+                struct js_kv_pair *base; // dictionary mode
+                struct js_value *slots; // shape mode, values of shape's keys by order, never empty
+            };
+            size_t length; // number of keys in both modes
+            size_t capacity;
+            struct js_shape *shape; // NULL means dictionary mode
+        } object; // use js_object_for_each instead of js_map_for_each
+        struct {
+            uint32_t ingress; // Caution: egress is NOT fixed
+            struct js_variable_map closure;
+        } function;
+        struct {
+            void *data;
+            void (*mark)(struct js_heap *, void *); // calls js_mark or js_mark_push on values data refers to, this function pointer can also be used to verify data type
+            void (*sweep)(void *); // this function pointer can also be used to verify data type
+        } c_data;
+    };
+};
+#pragma pack(pop)
+
+// automatic collection, old generation may grow to minimum managed values, then to survivors of last collection times growth
+#define js_gc_default_minimum 65536
+#define js_gc_default_growth 2.0
+
+// young generation, new values are bump allocated here, survivors of collecting it are promoted to heap by copying
+// its block is aligned to js_nursery_size, so that write barrier finds it by young value's address, must be power of 2
+#ifndef js_nursery_size
+    #define js_nursery_size (1 << 20)
+#endif
+
+struct js_nursery {
+    struct {
+        struct js_managed_value **base;
+        size_t length;
+        size_t capacity;
+    } remembered; // old values which may refer to young ones, roots of collecting young generation besides vm's
+    void *allocation; // unaligned, to be freed
+    size_t length;
+    size_t capacity;
+    struct js_managed_value cells[];
+};
+
+// incremental collection of old generation, each heap keeps its own phase and worklist
+enum js_gc_phase {
+    gc_idle,
+    gc_marking, // marked values are gray in worklist or black, write barrier shades values stored into marked containers
+    gc_sweeping, // unmarked values are freed, base before swept is done
+};
+
+// incremental collection runs a slice whenever this many values are allocated, or young generation is collected
+#define js_gc_slice_interval 4096
+
+// marked value whose children are not visited yet, array resumes from index, see js_mark
+struct js_mark_entry {
+    struct js_managed_value *managed;
+    size_t index;
+};
+
+#pragma pack(push, 1)
+struct js_heap {
+    struct js_managed_value **base; // old generation, or all values if there is no nursery
+    size_t length;
+    size_t capacity;
+    struct js_nursery *nursery; // NULL until automatic collection is configured
+    size_t threshold; // length which makes collection due, 0 means not configured, SIZE_MAX means disabled or suspended
+    size_t minimum;
+    double growth;
+    bool due; // set by js_alloc_managed, collected by vm at next safe point
+    uint8_t phase; // enum js_gc_phase
+    struct {
+        struct js_managed_value **base;
+        size_t length;
+        size_t capacity;
+    } gray; // marked old values whose children are not visited yet
+    struct {
+        struct js_mark_entry *base;
+        size_t length;
+        size_t capacity;
+    } mark_stack; // values marked by js_mark whose children are not visited yet
+    bool draining; // mark stack is being drained, js_mark called meanwhile only pushes
+    bool scavenging; // young generation is being collected, js_mark promotes young values instead
+    bool shading; // js_mark shades instead of marking recursively, for roots function and c data's mark function while marking incrementally
+    size_t swept;
+    size_t allocated; // since last slice
+    size_t slice_objects; // values visited by a slice, 0 and slice_microseconds 0 mean collecting old generation at once
+    uint32_t slice_microseconds; // time of a slice, checked every few values
+    struct {
+        struct js_shape **base;
+        size_t length;
+        size_t capacity;
+    } shapes; // by id, first is root of empty objects allocated by first js_object, objects fall back to dictionary mode instead of adding more, see js_shape
+    struct {
+        struct js_atom **base;
+        size_t length;
+        size_t capacity;
+    } atoms; // interned strings, see js_atom
+    size_t runtime_atoms; // of run time keys interned since atoms were swept, count towards threshold like old values
+};
+#pragma pack(pop)
+
+// if success, value is return data, or it is error description
+js_value_pack_push
+struct js_result {
+    bool success;
+    struct js_value value;
+};
+js_value_pack_pop
+
+enum serialized_style {
+    tostring_style,
+    tojson_style,
+    todump_style,
+};
+
+// DON'T use conflict name such as 'k' 'v'
+#define js_map_for_each(__arg_base, __arg_length, __arg_capacity, __arg_k, __arg_kl, __arg_v, __arg_statement) \
+    do { \
+        struct js_kv_pair *__base = (__arg_base); \
+        typeof(__arg_capacity) __cap = (__arg_capacity); \
+        for (typeof(__cap) __i = 0; __i < __cap; __i++) { \
+            struct js_kv_pair *__kv = __base + __i; \
+            char *__arg_k = __kv->key.base; \
+            typeof(__kv->key.length) __arg_kl = __kv->key.length; \
+            struct js_value *__arg_v = &(__kv->value); \
+            if (__arg_k != NULL && __arg_v->type != 0) { \
+                __arg_statement; \
+            } \
+        } \
+    } while (0)
+
+// iterate keys and values of object in both modes, shape mode follows insertion order, statement may 'continue'
+#define js_object_for_each(__arg_managed, __arg_k, __arg_kl, __arg_v, __arg_statement) \
+    do { \
+        struct js_managed_value *__object = (__arg_managed); \
+        if (__object->object.shape) { \
+            for (size_t __j = 0; __j < __object->object.length; __j++) { \
+                char *__arg_k = __object->object.shape->keys[__j]->base; \
+                uint16_t __arg_kl = __object->object.shape->keys[__j]->length; \
+                struct js_value *__arg_v = __object->object.slots + __j; \
+                __arg_statement; \
+            } \
+        } else { \
+            js_map_for_each(__object->object.base, _, __object->object.capacity, __arg_k, __arg_kl, __arg_v, __arg_statement); \
+        } \
+    } while (0)
+
+// DON'T use conflict name such as 'list'
+#define js_list_for_each(__arg_base, __arg_length, __arg_capacity, __arg_i, __arg_v, __arg_statement) \
+    buffer_for_each(__arg_base, __arg_length, __arg_capacity, __arg_i, __arg_v, { \
+        if (__arg_v->type != 0) { \
+            __arg_statement; \
+        } \
+    })
+
+shared struct js_atom *js_atom(struct js_heap *, const char *, uint16_t);
+shared struct js_atom *js_find_atom(struct js_heap *, const char *, uint16_t);
+shared void js_map_dump(struct js_kv_pair *, size_t, size_t);
+shared void js_map_put_internal(struct js_heap *, struct js_kv_pair **, size_t *, size_t *, const char *, uint16_t, struct js_value, uint32_t *);
+shared void js_map_put_atom_internal(struct js_kv_pair **, size_t *, size_t *, struct js_atom *, struct js_value, uint32_t *);
+// remove '*' prefix, and fit for any type of 'length' 'capacity'
+#define js_map_put_versioned(__arg_heap, __arg_base, __arg_length, __arg_capacity, __arg_key, __arg_key_length, __arg_value, __arg_version) \
+    do { \
+        size_t __len = __arg_length; \
+        size_t __cap = __arg_capacity; \
+        js_map_put_internal(__arg_heap, &(__arg_base), &__len, &__cap, __arg_key, __arg_key_length, __arg_value, __arg_version); \
+        __arg_length = (typeof(__arg_length))__len; \
+        __arg_capacity = (typeof(__arg_capacity))__cap; \
+    } while (0)
+#define js_map_put(__arg_heap, __arg_base, __arg_length, __arg_capacity, __arg_key, __arg_key_length, __arg_value) \
+    js_map_put_versioned(__arg_heap, __arg_base, __arg_length, __arg_capacity, __arg_key, __arg_key_length, __arg_value, NULL)
+#define js_map_put_sz(__arg_heap, __arg_base, __arg_length, __arg_capacity, __arg_key, __arg_value) \
+    js_map_put(__arg_heap, __arg_base, __arg_length, __arg_capacity, __arg_key, (uint16_t)strlen(__arg_key), __arg_value)
+#define js_map_put_atom(__arg_base, __arg_length, __arg_capacity, __arg_atom, __arg_value) \
+    do { \
+        size_t __len = __arg_length; \
+        size_t __cap = __arg_capacity; \
+        js_map_put_atom_internal(&(__arg_base), &__len, &__cap, __arg_atom, __arg_value, NULL); \
+        __arg_length = (typeof(__arg_length))__len; \
+        __arg_capacity = (typeof(__arg_capacity))__cap; \
+    } while (0)
+shared struct js_kv_pair *js_map_get_node(struct js_heap *, struct js_kv_pair *, size_t, size_t, const char *, uint16_t);
+shared struct js_kv_pair *js_map_get_atom_node(struct js_kv_pair *, size_t, size_t, struct js_atom *);
+shared struct js_value js_map_get(struct js_heap *, struct js_kv_pair *, size_t, size_t, const char *, uint16_t);
+shared struct js_value js_map_get_atom(struct js_kv_pair *, size_t, size_t, struct js_atom *);
+shared struct js_value js_map_get_sz(struct js_heap *, struct js_kv_pair *, size_t, size_t, const char *);
+// same as js_map_put, keys are atoms and not freed
+#define js_map_free(__arg_base, __arg_length, __arg_capacity) \
+    buffer_free(__arg_base, __arg_length, __arg_capacity)
+// TODO: unify all js_value * parameters to js_value? is it necessary?
+shared struct js_value js_null();
+shared struct js_value js_boolean(bool);
+shared struct js_value js_number(double);
+shared struct js_value js_scripture(struct js_heap *, const char *, uint16_t);
+shared struct js_value js_scripture_sz(struct js_heap *, const char *);
+static inline struct js_value js_scripture_atom(struct js_atom *atom) {
+    return (struct js_value){.type = vt_scripture, .scripture.base = atom->base};
+}
+shared struct js_value js_alloc_managed(struct js_heap *, enum js_value_type);
+shared struct js_value js_string(struct js_heap *, const char *, size_t);
+shared struct js_value js_string_sz(struct js_heap *, const char *);
+shared struct js_value js_string_f(struct js_heap *, const char *, ...);
+shared struct js_value js_array(struct js_heap *);
+shared void js_push_array_element(struct js_heap *, struct js_value *, struct js_value);
+shared void js_put_array_element(struct js_heap *, struct js_value *, size_t, struct js_value);
+shared struct js_value js_get_managed_array_element(struct js_managed_value *, size_t);
+static inline struct js_value js_get_array_element(struct js_value *container, size_t index) {
+    return js_get_managed_array_element(container->managed, index);
+}
+shared struct js_value js_object(struct js_heap *);
+shared int32_t js_shape_find(struct js_shape *, struct js_atom *);
+shared void js_put_object_value(struct js_heap *, struct js_value *, const char *, uint16_t, struct js_value);
+static inline void js_put_object_value_sz(struct js_heap *heap, struct js_value *container, const char *key, struct js_value element) {
+    js_put_object_value(heap, container, key, (uint16_t)strlen(key), element);
+}
+shared void js_put_object_atom(struct js_heap *, struct js_value *, struct js_atom *, struct js_value);
+shared struct js_value js_get_object_value(struct js_heap *, struct js_value *, const char *, uint16_t);
+shared struct js_value js_get_object_atom(struct js_value *, struct js_atom *);
+static inline struct js_value js_get_object_value_sz(struct js_heap *heap, struct js_value *container, const char *key) {
+    return js_get_object_value(heap, container, key, (uint16_t)strlen(key));
+}
+shared struct js_value js_function(struct js_heap *, uint32_t);
+shared bool js_is_function(struct js_value *);
+shared struct js_value js_c_data(struct js_heap *, void *, void (*)(struct js_heap *, void *), void (*)(void *));
+shared void js_mark(struct js_heap *, struct js_value *);
+shared void js_mark_push(struct js_heap *, struct js_value *);
+shared void js_sweep(struct js_heap *);
+shared void js_free_heap(struct js_heap *);
+shared void js_alloc_nursery(struct js_heap *);
+shared void js_free_nursery(struct js_heap *);
+shared bool js_heap_exhausted(struct js_heap *);
+shared void js_scavenge(struct js_heap *, void (*)(void *), void *);
+shared void js_remember(struct js_managed_value *, struct js_managed_value *);
+shared void js_shade(struct js_heap *, struct js_managed_value *);
+shared bool js_collect_slice(struct js_heap *, void (*)(void *), void *, size_t, uint32_t);
+static inline bool js_is_managed(enum js_value_type type) {
+    return type == vt_string || type == vt_array || type == vt_object || type == vt_function || type == vt_c_data;
+}
+// old container which gets young value is remembered, must be called whenever a value is stored into object or closure
+// array remembers where it is stored too, see js_put_array_element, moving elements must set remembered_from to 0
+// while marking, old value stored into marked container is shaded into worklist of heap owning container
+// scripture stored into marked container has its atom marked, it may be a run time object key
+static inline void js_write_barrier(struct js_heap *heap, struct js_managed_value *container, struct js_value value) {
+    if (value.type == vt_scripture) {
+        if (container->in_use && heap->phase == gc_marking) {
+            js_atom_of(value.scripture.base)->in_use = 1;
+        }
+        return;
+    } else if (!js_is_managed(value.type)) {
+        return;
+    } else if (value.managed->young) {
+        if (!container->young && !container->remembered) {
+            js_remember(container, value.managed);
+        }
+    } else if (container->in_use && !value.managed->in_use) {
+        js_shade(heap, value.managed);
+    }
+}
+shared void js_serialize_managed_value(struct print_stream *, enum serialized_style, struct js_managed_value *, size_t depth);
+shared void js_serialize_value(struct print_stream *, enum serialized_style, struct js_value *, size_t depth);
+shared void js_dump_value(struct js_value *);
+shared bool js_is_string(struct js_value *);
+// vt_integer never leaves vm, it is converted when stored into containers and maps, or passed to c functions
+static inline struct js_value js_normalize(struct js_value value) {
+    return value.type == vt_integer ? (struct js_value){.type = vt_number, .number = (double)value.integer} : value;
+}
+
+static inline bool js_is_number(struct js_value *value) {
+    return value->type == vt_number || value->type == vt_integer;
+}
+
+static inline double js_get_number(struct js_value *value) {
+    return value->type == vt_integer ? (double)value->integer : value->number;
+}
+
+// same type and same content, compares by member instead of memcmp so that padding of either layout is ignored
+// numbers are equal if same bits or ==, same value may have different bits, such as -0 +0
+static inline bool js_is_identical(struct js_value *lhs, struct js_value *rhs) {
+    if (lhs->type != rhs->type) {
+        return false;
+    }
+    switch (lhs->type) {
+    case vt_undefined:
+    case vt_null:
+        return true;
+    case vt_boolean:
+        return lhs->boolean == rhs->boolean;
+    case vt_number:
+        return memcmp(&(lhs->number), &(rhs->number), sizeof(double)) == 0 || lhs->number == rhs->number;
+    case vt_integer:
+        return lhs->integer == rhs->integer;
+    case vt_scripture:
+        return lhs->scripture.base == rhs->scripture.base;
+    case vt_c_function:
+        return lhs->c_function == rhs->c_function;
+    default:
+        return lhs->managed == rhs->managed;
+    }
+}
+shared char *js_get_string_base(struct js_value *); // Caution: No guarantee it ends with 0
+shared size_t js_get_string_length(struct js_value *);
+shared int js_compare_string(struct js_value *, struct js_value *);
+// Caution: '()' must be added in following macros
+#define js_return(__arg_value) \
+    return ((struct js_result){.success = true, .value = (__arg_value)})
+#define js_throw(__arg_value) \
+    return ((struct js_result){.success = false, .value = (__arg_value)})
+// message is interned into heap's atoms, see js_assert for functions having vm
+#define js_assert_heap(__arg_heap, __arg_expr) \
+    do { \
+        if (!(__arg_expr)) { \
+            js_throw(js_scripture_sz((__arg_heap), "Assertion failed: " #__arg_expr)); \
+        } \
+    } while (0)
+shared struct js_result js_add(struct js_heap *, struct js_value *, struct js_value *);
+
+#ifdef DEBUG
+
+shared void test_data_structure_size();
+shared void test_js_map();
+shared void test_js_map_loop();
+shared void test_js_value();
+shared void test_js_value_loop();
+shared void test_js_value_bug();
+shared void test_js_string_family();
+shared void test_js_string_f();
+
+#endif
+
 #endif
\ No newline at end of file
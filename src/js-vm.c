@@ -1,1396 +1,4873 @@
-/*
-Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
-
-This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
-
-This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
-
-You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
-*/
-
-#include <math.h>
-#include "js-vm.h"
-
-#define X(name) #name,
-static const char *const _opcode_names[] = {js_opcode_list};
-#undef X
-
-#pragma pack(push, 1)
-struct _operand {
-    uint8_t type;
-    union {
-        bool value_bool;
-        uint8_t value_uint8;
-        uint16_t value_uint16;
-        int32_t value_int32;
-        uint32_t value_uint32;
-        double value_double;
-        struct {
-            uint32_t offset;
-            uint32_t length;
-        } value_string;
-        struct {
-            uint32_t ingress;
-        } value_function;
-    };
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct _instruction {
-    uint8_t opcode : 6;
-    uint8_t num_operands : 2;
-    struct _operand operands[3];
-};
-#pragma pack(pop)
-
-static bool _get_instruction(struct js_bytecode *bytecode, uint32_t *offset /* in,out */, struct _instruction *instruction /* out */) {
-#define __safe_forward(__arg_num_bytes, __arg_statement) \
-    do { \
-        if ((bytecode->length - *offset) < __arg_num_bytes) { \
-            log_warning("__safe_forward failed"); \
-            return false; \
-        } \
-        __arg_statement; \
-        (*offset) += __arg_num_bytes; \
-    } while (0)
-#define __current_position (bytecode->base + *offset)
-    if ((bytecode->length - *offset) < 1) {
-        return false; // end of bytecode, skip warning
-    }
-    __safe_forward(1, *((uint8_t *)instruction) = *__current_position);
-    if (instruction->num_operands > 0) {
-        __safe_forward(1, {
-            instruction->operands[0].type = *__current_position & 0b00001111;
-            instruction->operands[1].type = *__current_position >> 4;
-        });
-    }
-    if (instruction->num_operands > 2) {
-        __safe_forward(1, instruction->operands[2].type = *__current_position & 0b00001111);
-    }
-    for (uint8_t i = 0; i < instruction->num_operands; i++) { // be careful: 0 means 1 operand
-        switch (instruction->operands[i].type) {
-        case opd_undefined:
-        case opd_null:
-        case opd_empty_array:
-        case opd_empty_object:
-            break;
-        case opd_boolean:
-            __safe_forward(1, instruction->operands[i].value_bool = *__current_position != 0);
-            break;
-        case opd_uint8:
-            __safe_forward(1, instruction->operands[i].value_uint8 = *__current_position);
-            break;
-        case opd_uint16:
-            __safe_forward(2, instruction->operands[i].value_uint16 = *((uint16_t *)__current_position));
-            break;
-        case opd_uint32:
-            __safe_forward(4, instruction->operands[i].value_uint32 = *((uint32_t *)__current_position));
-            break;
-        case opd_double:
-            __safe_forward(8, instruction->operands[i].value_double = *((double *)__current_position));
-            break;
-        case opd_string:
-            __safe_forward(4, instruction->operands[i].value_string.length = *((uint32_t *)__current_position));
-            instruction->operands[i].value_string.offset = *offset;
-            __safe_forward(instruction->operands[i].value_string.length, );
-            break;
-        case opd_function:
-            __safe_forward(4, instruction->operands[i].value_function.ingress = *((uint32_t *)__current_position));
-            break;
-        default:
-            printf("Unknown type %u\n", instruction->operands[i].type);
-            return false;
-        }
-    }
-    return true;
-#undef __current_position
-#undef __safe_forward
-}
-
-// args are: operand types, operands, and with string, are length and base address
-static void _put_instruction(struct js_bytecode *bytecode /* in,out */, uint32_t *offset /* in,out */, uint8_t opcode, uint8_t num_operands, va_list args) {
-#define __safe_forward(__arg_num_bytes, __arg_statement) \
-    do { \
-        buffer_alloc(bytecode->base, bytecode->length, bytecode->capacity, *offset + __arg_num_bytes); \
-        __arg_statement; \
-        (*offset) += __arg_num_bytes; \
-        if (bytecode->length < *offset) { \
-            bytecode->length = *offset; \
-        } \
-    } while (0)
-#define __current_position (bytecode->base + *offset)
-    enforce(opcode < 64);
-    enforce(num_operands < 4);
-    __safe_forward(1, *__current_position = opcode + (num_operands << 6));
-    uint8_t types[3] = {0};
-    for (uint8_t i = 0; i < num_operands; i++) {
-        types[i] = (uint8_t)va_arg(args, int);
-    }
-    if (num_operands > 0) {
-        __safe_forward(1, *__current_position = types[0] + (types[1] << 4));
-    }
-    if (num_operands > 2) {
-        __safe_forward(1, *__current_position = types[2]);
-    }
-    for (uint8_t i = 0; i < num_operands; i++) {
-        switch (types[i]) {
-        case opd_undefined:
-        case opd_null:
-        case opd_empty_array:
-        case opd_empty_object:
-            break;
-        case opd_boolean:
-            __safe_forward(1, *__current_position = (bool)va_arg(args, int) ? 1 : 0); // is promoted to 'int'
-            break;
-        case opd_uint8:
-            __safe_forward(1, *((uint8_t *)__current_position) = (uint8_t)va_arg(args, int)); // is promoted to 'int'
-            break;
-        case opd_uint16:
-            __safe_forward(2, *((uint16_t *)__current_position) = (uint16_t)va_arg(args, int)); // is promoted to 'int'
-            break;
-        case opd_uint32:
-            __safe_forward(4, *((uint32_t *)__current_position) = va_arg(args, uint32_t));
-            break;
-        case opd_double:
-            __safe_forward(8, *((double *)__current_position) = va_arg(args, double));
-            break;
-        case opd_string:
-            uint32_t slen = va_arg(args, uint32_t);
-            __safe_forward(4, *((uint32_t *)__current_position) = slen);
-            const char *s = va_arg(args, const char *);
-            __safe_forward(slen, memcpy(__current_position, s, slen));
-            break;
-        case opd_function:
-            __safe_forward(4, *((uint32_t *)__current_position) = (uint32_t)va_arg(args, int));
-            break;
-        default:
-            fatal("Unknown type %u", types[i]);
-        }
-    }
-#undef __current_position
-#undef __safe_forward
-}
-
-void js_put_instruction(struct js_bytecode *bytecode /* in,out */, uint32_t *offset /* in,out */, uint8_t opcode, uint8_t num_operands, ...) {
-    va_list args;
-    va_start(args, num_operands);
-    _put_instruction(bytecode, offset, opcode, num_operands, args);
-    va_end(args);
-}
-
-void js_add_instruction(struct js_bytecode *bytecode /* in,out */, uint8_t opcode, uint8_t num_operands, ...) {
-    uint32_t offset = bytecode->length;
-    va_list args;
-    va_start(args, num_operands);
-    _put_instruction(bytecode, &offset, opcode, num_operands, args);
-    va_end(args);
-}
-
-void js_add_cross_reference(struct js_cross_reference *cross_reference, uint32_t source_line, uint32_t bytecode_offset) {
-    buffer_put(cross_reference->base, cross_reference->length, cross_reference->capacity, source_line, bytecode_offset);
-}
-
-// #define X(name) #name,
-// static const char *const _call_stack_frame_type_names[] = {js_call_stack_frame_type_list};
-// #undef X
-
-#define X(name) #name,
-static const char *const _stack_frame_type_names[] = {js_stack_frame_type_list};
-#undef X
-
-static void _instruction_dump(uint8_t *base, struct _instruction *instruction) {
-    int n = 0;
-    printf("%-24s    ", _opcode_names[instruction->opcode]);
-    for (uint8_t i = 0; i < instruction->num_operands; i++) {
-        if (i > 0) {
-            n += printf("  ");
-        }
-        switch (instruction->operands[i].type) {
-        case opd_undefined:
-            n += printf("undefined");
-            break;
-        case opd_null:
-            n += printf("null");
-            break;
-        case opd_empty_array:
-            n += printf("[]");
-            break;
-        case opd_empty_object:
-            n += printf("{}");
-            break;
-        case opd_boolean:
-            n += printf("%s", instruction->operands[i].value_bool ? "true" : "false");
-            break;
-        case opd_uint8:
-            n += printf("<u8 %u>", instruction->operands[i].value_uint8);
-            break;
-        case opd_uint16:
-            n += printf("<u16 %u>", instruction->operands[i].value_uint16);
-            break;
-        case opd_uint32:
-            n += printf("<u32 %u>", instruction->operands[i].value_uint32);
-            break;
-        case opd_double:
-            n += printf("%g", instruction->operands[i].value_double);
-            break;
-        case opd_string:
-            n += printf("''%.*s''", instruction->operands[i].value_string.length, base + instruction->operands[i].value_string.offset);
-            break;
-        case opd_function:
-            n += printf("<function %u>", instruction->operands[i].value_function.ingress);
-            break;
-        default:
-            break;
-        }
-    }
-    printf("%*s", max(24 - n, 2), "");
-    // comment for special types
-    switch (instruction->opcode) {
-    case op_stack_push:
-        enforce(instruction->num_operands > 0);
-        enforce(instruction->operands[0].type == opd_uint8);
-        enforce(instruction->operands[0].value_uint8 < countof(_stack_frame_type_names));
-        if (instruction->operands[0].value_uint8 != sf_value) {
-            printf("; %s", _stack_frame_type_names[instruction->operands[0].value_uint8]);
-        }
-        break;
-    default:
-        break;
-    }
-}
-
-void js_bytecode_dump(struct js_bytecode *bytecode) {
-    struct _instruction instruction;
-    for (uint32_t offset = 0, next_offset = 0; _get_instruction(bytecode, &next_offset, &instruction); offset = next_offset) {
-        printf("%10u  ", offset);
-        _instruction_dump(bytecode->base, &instruction);
-        printf("\n");
-    };
-    printf("\n");
-}
-
-void js_dump_vm(struct js_vm *vm) {
-    struct print_stream out = {.type = file_stream, .fp = stdout};
-    printf("heap base=%p length=%zu capacity=%zu\n", vm->heap.base, vm->heap.length, vm->heap.capacity);
-    buffer_for_each(vm->heap.base, vm->heap.length, vm->heap.capacity, i, v, {
-        printf("    %zu. ", i);
-        js_serialize_managed_value(&out, todump_style, *v, 0);
-        printf("\n");
-    });
-    // printf("globals base=%p length=%u capacity=%u\n", vm->globals.base, vm->globals.length, vm->globals.capacity);
-    // js_map_for_each(vm->globals.base, _, vm->globals.capacity, k, kl, v, {
-    //     printf("    %.*s = ", (int)kl, k);
-    //     js_serialize_value(&out, todump_style, v, 0);
-    //     printf("\n");
-    // });
-    printf("stack base=%p length=%u capacity=%u\n", vm->stack.base, vm->stack.length, vm->stack.capacity);
-    for (uint16_t depth = 0; depth < vm->stack.length; depth++) {
-        struct js_stack_frame *frame = vm->stack.base + depth;
-        printf("    %u: (%u)%s", depth, frame->type, _stack_frame_type_names[frame->type]);
-        switch (frame->type) {
-        case sf_value:
-            printf(": ");
-            js_serialize_value(&out, todump_style, &(frame->value), 0);
-            printf("\n");
-            break;
-        case sf_block:
-        case sf_loop:
-        case sf_try:
-        case sf_function:
-            printf("\n");
-            printf("        locals: base=%p length=%u capacity=%u\n", frame->locals.base, frame->locals.length, frame->locals.capacity);
-            js_map_for_each(frame->locals.base, _, frame->locals.capacity, k, kl, v, {
-                printf("            %.*s = ", (int)kl, k);
-                js_serialize_value(&out, todump_style, v, 0);
-                printf("\n");
-            });
-            printf("        egress: %u\n", frame->egress);
-            if (frame->type == sf_function) {
-                printf("        function: %p ", frame->function);
-                if (frame->function != NULL) {
-                    js_serialize_managed_value(&out, todump_style, frame->function, 0);
-                }
-                printf("\n");
-                printf("        arguments: base=%p length=%u capacity=%u index=%u\n", frame->arguments.base, frame->arguments.length, frame->arguments.capacity, frame->arguments.index);
-                buffer_for_each(frame->arguments.base, frame->arguments.length, frame->arguments.capacity, i, v, {
-                    printf("            %u. ", i);
-                    js_serialize_value(&out, todump_style, v, 0);
-                    printf("\n");
-                });
-            } else {
-                printf("        ingress: %u\n", frame->ingress);
-            }
-            break;
-        default:
-            printf("    Unknown frame type %u\n", frame->type);
-            break;
-        }
-    }
-    printf("pc=%u\n", vm->pc);
-    printf("\n");
-}
-
-// reverse order, from top to down
-#define _stack_for_each(__arg_vm, __arg_frame, __arg_statement) \
-    do { \
-        /* DON'T use "for (uint16_t i = vm->stack.length - 1; i >= 0; i--)", \
-        because turn unsigned i into negative will result a huge positive value */ \
-        for (uint16_t i = 0; i < __arg_vm->stack.length; i++) { \
-            struct js_stack_frame *__arg_frame = __arg_vm->stack.base + __arg_vm->stack.length - 1 - i; \
-            __arg_statement; \
-        } \
-    } while (0)
-
-#define _call_stack_for_each(__arg_vm, __arg_frame, __arg_statement) \
-    _stack_for_each(__arg_vm, __arg_frame, { \
-        if (__arg_frame->type != sf_value) { \
-            __arg_statement; \
-        } \
-    })
-
-static struct js_variable_map *_get_current_scope(struct js_vm *vm) {
-    _call_stack_for_each(vm, frame, return &(frame->locals));
-    return &(vm->globals);
-}
-
-struct js_result js_declare_variable(struct js_vm *vm, const char *name, uint16_t name_length, struct js_value value) {
-    struct js_variable_map *scope = _get_current_scope(vm);
-    if (js_map_get(scope->base, scope->length, scope->capacity, name, name_length).type != 0) {
-        js_throw(js_string_f(&(vm->heap),
-            "Variable \"%.*s\" already exists", (int)name_length, name));
-    }
-    js_map_put(scope->base, scope->length, scope->capacity, name, name_length, value);
-    js_return(js_null());
-}
-
-struct js_result js_delete_variable(struct js_vm *vm, const char *name, uint16_t name_length) {
-    struct js_variable_map *scope = _get_current_scope(vm);
-    if (js_map_get(scope->base, scope->length, scope->capacity, name, name_length).type == 0) {
-        js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" not found", (int)name_length, name));
-    }
-    js_map_put(scope->base, scope->length, scope->capacity, name, name_length, (struct js_value){0});
-    js_return(js_null());
-}
-
-struct js_result js_put_variable(struct js_vm *vm, const char *name, uint16_t name_length, struct js_value value) {
-    // first, check current stack variables
-    // second, check current stack closure if is function
-    // there may be multiple nested functions, so each stack should check closure
-    _call_stack_for_each(vm, frame, {
-        if (js_map_get(frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length).type != 0) {
-            js_map_put(frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length, value);
-            js_return(js_null());
-        }
-        if (frame->type == sf_function && frame->function != NULL) {
-            if (js_map_get(frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length).type != 0) {
-                js_map_put(frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length, value);
-                js_return(js_null());
-            }
-        }
-    });
-    // at last, check globals
-    if (js_map_get(vm->globals.base, vm->globals.length, vm->globals.capacity, name, name_length).type != 0) {
-        js_map_put(vm->globals.base, vm->globals.length, vm->globals.capacity, name, name_length, value);
-        js_return(js_null());
-    }
-    js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" not found", (int)name_length, name));
-}
-
-struct js_result js_get_variable(struct js_vm *vm, const char *name, uint16_t name_length) {
-    // first, check current stack variables
-    // second, check current stack closure if is function
-    // there may be multiple nested functions, so each stack should check closure
-    struct js_value ret;
-    _call_stack_for_each(vm, frame, {
-        ret = js_map_get(frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length);
-        if (ret.type != 0) {
-            js_return(ret);
-        }
-        if (frame->type == sf_function && frame->function != NULL) {
-            ret = js_map_get(frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length);
-            if (ret.type != 0) {
-                js_return(ret);
-            }
-        }
-    });
-    // at last, check globals
-    ret = js_map_get(vm->globals.base, vm->globals.length, vm->globals.capacity, name, name_length);
-    if (ret.type != 0) {
-        js_return(ret);
-    }
-    js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" not found", (int)name_length, name));
-}
-
-static void _stack_push(struct js_vm *vm, struct js_stack_frame frame) {
-    // compound literal which contains comma can not be used inside macro
-    // https://stackoverflow.com/questions/5558159/compound-literals-and-function-like-macros-bug-in-gcc-or-the-c-standard
-    // finally it can, just surround with extra parentheses
-    // such as: ((struct foo){.a = 1, .b = 2, .c = 3})
-    buffer_push(vm->stack.base, vm->stack.length, vm->stack.capacity, frame);
-}
-
-static struct js_stack_frame *_stack_peek(struct js_vm *vm, uint16_t depth) { // depth from 0 (top) to length-1 (bottom)
-    // js_dump_vm(vm);
-    // js_bytecode_dump(&(vm->bytecode));
-    enforce(vm->stack.length > depth);
-    return vm->stack.base + vm->stack.length - 1 - depth;
-}
-
-static void _stack_swap(struct js_vm *vm, uint16_t depth_1, uint16_t depth_2) {
-    enforce(vm->stack.length > depth_1);
-    enforce(vm->stack.length > depth_2);
-    struct js_stack_frame swap = vm->stack.base[vm->stack.length - 1 - depth_1];
-    vm->stack.base[vm->stack.length - 1 - depth_1] = vm->stack.base[vm->stack.length - 1 - depth_2];
-    vm->stack.base[vm->stack.length - 1 - depth_2] = swap;
-}
-
-static void _stack_frame_free(struct js_stack_frame *frame) {
-    if (frame->type != sf_value) {
-        js_map_free(frame->locals.base, frame->locals.length, frame->locals.capacity);
-        if (frame->type == sf_function) {
-            buffer_free(frame->arguments.base, frame->arguments.length, frame->arguments.capacity);
-        }
-    }
-}
-
-static void _stack_pop(struct js_vm *vm, uint16_t depth) {
-    for (uint16_t i = 0; i < depth; i++) {
-        _stack_frame_free(_stack_peek(vm, i));
-    }
-    vm->stack.length -= depth;
-}
-
-static struct js_value _stack_peek_value(struct js_vm *vm, uint16_t depth) { // depth from 0 (top) to length-1 (bottom)
-    struct js_stack_frame *frame = _stack_peek(vm, depth);
-    enforce(frame->type == sf_value);
-    return frame->value;
-}
-
-static struct js_value _stack_pop_value(struct js_vm *vm) {
-    struct js_value value = _stack_peek_value(vm, 0);
-    _stack_pop(vm, 1); // clear this value before following stack operations
-    return value;
-}
-
-static void _stack_pop_to(struct js_vm *vm, enum js_stack_frame_type type) {
-    uint16_t depth = 0;
-    _stack_for_each(vm, frame, {
-        if (frame->type == type) {
-            break;
-        }
-        depth++;
-    });
-    _stack_pop(vm, depth);
-}
-
-static void _stack_push_value(struct js_vm *vm, struct js_value value) {
-    _stack_push(vm, (struct js_stack_frame){.type = sf_value, .value = value});
-}
-
-static const char *const _typeof_table[] = {"undefined", "null", "boolean", "number", "string", "string", "string", "array", "object", "function", "function", "c_data"};
-
-static struct js_value *_get_arguments_base(struct js_vm *vm) {
-    struct js_stack_frame *frame = _stack_peek(vm, 0);
-    enforce(frame->type == sf_function);
-    return frame->arguments.base;
-}
-
-static uint16_t _get_arguments_length(struct js_vm *vm) {
-    struct js_stack_frame *frame = _stack_peek(vm, 0);
-    enforce(frame->type == sf_function);
-    return frame->arguments.length;
-}
-
-static struct js_value _get_argument(struct js_vm *vm, uint16_t index) {
-    struct js_stack_frame *frame = _stack_peek(vm, 0);
-    enforce(frame->type == sf_function);
-    if (index < frame->arguments.length) {
-        return frame->arguments.base[index];
-    } else {
-        return js_null();
-    }
-}
-
-static struct js_value js_error(struct js_vm *vm, uint32_t curr_offset, struct js_value message) {
-    // see https://developer.mozilla.org/zh-CN/docs/Web/JavaScript/Reference/Global_Objects/Error
-    /*
-        A special case:
-
-        //...
-        //...
-        //...
-        throw greetings;
-
-        throws variable not found error at curr_offset=0, but there are many lines corresponding to offset 0, because these 0 are array holes during buffer_put, so line will wrongly break at first 0;
-    */
-    if (vm->cross_reference.base) {
-        struct js_value error = js_object(&(vm->heap));
-        js_put_object_value_sz(&error, "message", message);
-        // for (uint32_t line = 0; line < vm->cross_reference.length; line++) {
-        //     log_debug("line=%lu, offset=%lu, curr_offset=%lu", line, vm->cross_reference.base[line], curr_offset);
-        // }
-        for (uint32_t line = 0; line < vm->cross_reference.length; line++) {
-            uint32_t offset = vm->cross_reference.base[line];
-            if (curr_offset == 0 && offset == 0) {
-                continue;
-            }
-            if (curr_offset <= offset) {
-                // log_debug("line=%lu, break", line);
-                js_put_object_value_sz(&error, "line", js_number(line + 1));
-                break;
-            }
-        }
-        return error;
-    } else {
-        return message;
-    }
-}
-
-struct js_result js_run(struct js_vm *vm) {
-    struct _instruction instruction;
-    struct js_stack_frame *frame;
-    struct js_value container, selector, value;
-    struct js_result result;
-    size_t index;
-    bool yes;
-    uint32_t curr_offset;
-#define __debug() \
-    do { \
-        _instruction_dump(vm->bytecode.base, &instruction); \
-        printf("\n"); \
-        js_dump_vm(vm); \
-    } while (0)
-#define __operand_offset(__arg_i) (char *)(vm->bytecode.base + instruction.operands[__arg_i].value_string.offset)
-#define __operand_length(__arg_i) (instruction.operands[__arg_i].value_string.length)
-#define __throw(__arg_message) \
-    do { \
-        /* side effect: if __arg_message is _stack_pop_value, it will disappear after _stack_pop_to */ \
-        typeof(__arg_message) __error = js_error(vm, curr_offset, __arg_message); \
-        /* if is in c_function, must exit loop, for example, a 'try' 'c function' function' chain, \
-        function 'throw's, stack will be emptied to 'try' and vm_run will return to c function, \
-        and stack is corrupted now */ \
-        for (; vm->stack.length > 0; _stack_pop(vm, 1)) { \
-            frame = _stack_peek(vm, 0); \
-            if (frame->type == sf_try) { \
-                vm->pc = frame->egress; \
-                _stack_pop(vm, 1); \
-                _stack_push_value(vm, __error); \
-                goto end_of_while_loop; /* DON'T use 'break' because it may be in another loop */ \
-                /* function != NULL but egress == 0 means called by c function, see js_call() */ \
-            } else if (frame->type == sf_function && frame->egress == 0) { \
-                js_throw(__error); \
-            } \
-        } \
-        if (vm->stack.length == 0) { \
-            js_throw(__error); \
-        } \
-    } while (0)
-#define __do_try(__arg_expr) /* if using __try, clang_format will add new line after it */ \
-    do { \
-        result = (__arg_expr); \
-        if (!result.success) { \
-            __throw(result.value); \
-        } \
-    } while (0);
-#define __lhs container
-#define __rhs selector
-    curr_offset = vm->pc;
-    while (_get_instruction(&(vm->bytecode), &(vm->pc), &instruction)) {
-        switch (instruction.opcode) {
-        case op_nop:
-            break;
-        case op_stack_push:
-            // __debug();
-            enforce(instruction.num_operands > 0);
-            enforce(instruction.operands[0].type == opd_uint8);
-            switch (instruction.operands[0].value_uint8) {
-            case sf_value:
-                enforce(instruction.num_operands == 2);
-                switch (instruction.operands[1].type) {
-                case opd_undefined:
-                    _stack_push(vm, (struct js_stack_frame){0});
-                    break;
-                case opd_null:
-                    _stack_push_value(vm, js_null());
-                    break;
-                case opd_empty_array:
-                    _stack_push_value(vm, js_array(&(vm->heap)));
-                    break;
-                case opd_empty_object:
-                    _stack_push_value(vm, js_object(&(vm->heap)));
-                    break;
-                case opd_boolean:
-                    _stack_push_value(vm, js_boolean(instruction.operands[1].value_bool));
-                    break;
-                case opd_double:
-                    _stack_push_value(vm, js_number(instruction.operands[1].value_double));
-                    break;
-                case opd_string:
-                    _stack_push_value(vm, js_string(&(vm->heap), __operand_offset(1), __operand_length(1)));
-                    break;
-                case opd_function:
-                    // closure must be added just before return, NOT here, because closure = local variables before return
-                    // NONONO, closure must be added just after function definition, not before return, for example, returning function is declared outside this function, shoun't carry this function's local variable as closure.
-                    value = js_function(&(vm->heap), instruction.operands[1].value_function.ingress);
-                    yes = false; // if is created inside another function (if not, closure is not necessary)
-                    // if c function is in call stack chain, definitely there are atleast 1 script function stack after c stack
-                    _call_stack_for_each(vm, frame, {
-                        if (frame->type == sf_function) {
-                            yes = true;
-                            break;
-                        }
-                    });
-                    if (yes) {
-#define __put_to_closure() \
-    do { \
-        /* add only when not equals to value (DON'T add self) and closure not have it */ \
-        if ((v->type != vt_function || v->managed != value.managed) && \
-            js_map_get(value.managed->function.closure.base, \
-                value.managed->function.closure.length, \
-                value.managed->function.closure.capacity, k, kl) \
-                    .type == 0) { \
-            js_map_put(value.managed->function.closure.base, \
-                value.managed->function.closure.length, \
-                value.managed->function.closure.capacity, k, kl, *v); \
-        } \
-    } while (0)
-                        // reverse traverse all call stack until first function stack
-                        _call_stack_for_each(vm, frame, {
-                            js_map_for_each(frame->locals.base, _, frame->locals.capacity, k, kl, v, {
-                                __put_to_closure();
-                            });
-                            if (frame->type == sf_function && frame->function != NULL) {
-                                // also put frame's recorded closure into (return closure function from another closure function)
-                                js_map_for_each(frame->function->function.closure.base, _, frame->function->function.closure.capacity, k, kl, v, {
-                                    __put_to_closure();
-                                });
-                                // and stop traversel
-                                break;
-                            }
-                        });
-#undef __put_to_closure
-                    }
-                    _stack_push_value(vm, value);
-                    break;
-                default:
-                    fatal("Invalid value type %u", instruction.operands[1].type);
-                }
-                break;
-            case sf_function:
-            case sf_try:
-                enforce(instruction.num_operands = 2);
-                enforce(instruction.operands[1].type == opd_uint32);
-                _stack_push(vm, (struct js_stack_frame){.type = instruction.operands[0].value_uint8, .egress = instruction.operands[1].value_uint32});
-                break;
-            case sf_block:
-                enforce(instruction.num_operands = 1);
-                _stack_push(vm, (struct js_stack_frame){.type = instruction.operands[0].value_uint8});
-                break;
-            case sf_loop:
-                enforce(instruction.num_operands = 3);
-                enforce(instruction.operands[1].type == opd_uint32);
-                enforce(instruction.operands[2].type == opd_uint32);
-                _stack_push(vm, (struct js_stack_frame){.type = instruction.operands[0].value_uint8, .ingress = instruction.operands[1].value_uint32, .egress = instruction.operands[2].value_uint32});
-                break;
-            default:
-                fatal("Invalid stack type %u", instruction.operands[0].value_uint8);
-                break;
-            }
-            // __debug();
-            break;
-        case op_stack_pop:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_uint8);
-            _stack_pop(vm, instruction.operands[0].value_uint8);
-            break;
-        case op_variable_declare:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_string);
-            __do_try(js_declare_variable(vm, __operand_offset(0), __operand_length(0), _stack_pop_value(vm)));
-            break;
-        case op_variable_delete:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_string);
-            __do_try(js_delete_variable(vm, __operand_offset(0), __operand_length(0)));
-            break;
-        case op_variable_put:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_string);
-            __do_try(js_put_variable(vm, __operand_offset(0), __operand_length(0), _stack_pop_value(vm)));
-            break;
-        case op_variable_get:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_string);
-            __do_try(js_get_variable(vm, __operand_offset(0), __operand_length(0)));
-            _stack_push_value(vm, result.value);
-            break;
-        case op_jump:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_uint32);
-            vm->pc = instruction.operands[0].value_uint32;
-            break;
-        case op_argument_append:
-            value = _stack_pop_value(vm);
-            frame = _stack_peek(vm, 0);
-            enforce(frame->type == sf_function);
-            buffer_push(frame->arguments.base, frame->arguments.length, frame->arguments.capacity, value);
-            break;
-        case op_call:
-            frame = _stack_peek(vm, 1);
-            enforce(frame->type == sf_value);
-            value = frame->value;
-            frame = _stack_peek(vm, 0);
-            enforce(frame->type == sf_function);
-            switch (value.type) {
-            case vt_function:
-                frame->function = value.managed; // complete sf_function
-                vm->pc = value.managed->function.ingress;
-                // __debug();
-                break;
-            case vt_c_function:
-                // result = ((js_c_function_type)value.c_function)(vm, _get_arguments_length(vm), _get_arguments_base(vm));
-                // if (result.success) {
-                //     _stack_pop(vm, 2);
-                //     _stack_push_value(vm, result.value);
-                // } else {
-                //     // exception handling
-                //     __throw(result.value);
-                // }
-                __do_try(((js_c_function_type)value.c_function)(vm, _get_arguments_length(vm), _get_arguments_base(vm)));
-                _stack_pop(vm, 2);
-                _stack_push_value(vm, result.value);
-                // __debug();
-                break;
-            default:
-                fatal("Value type %u is not function", value.type);
-                break;
-            }
-            break;
-        case op_return:
-            if (_stack_peek(vm, 0)->type == sf_value) {
-                value = _stack_pop_value(vm); // return value
-            } else {
-                value = js_null(); // if there are no return value, return NULL
-            }
-            // DON'T add closure here, for example, returning function is defined outside this function
-            // 'return' may be in deep call stack level, all cleanup
-            _stack_pop_to(vm, sf_function);
-            if (vm->stack.length == 0) {
-                // if there are no stacks, which means 'return' outside function, exit loop
-                js_return(value);
-            } else if (_stack_peek(vm, 0)->egress == 0) {
-                // is called by c function, exit loop
-                _stack_pop(vm, 2); // cleanup
-                js_return(value);
-            } else {
-                // else jump to function egress
-                vm->pc = _stack_peek(vm, 0)->egress;
-                _stack_pop(vm, 2); // cleanup
-                _stack_push_value(vm, value); // push return value
-            }
-            // __debug();
-            break;
-        case op_argument_first:
-            frame = _stack_peek(vm, 0);
-            enforce(frame->type == sf_function);
-            frame->arguments.index = 0;
-            break;
-        case op_argument_get_next:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_string);
-            // default value
-            if (_stack_peek(vm, 0)->type == sf_value) {
-                __lhs = _stack_pop_value(vm);
-            } else {
-                __lhs = js_null();
-            }
-            __rhs = _get_argument(vm, _stack_peek(vm, 0)->arguments.index++);
-            if (__rhs.type != vt_null) {
-                __lhs = __rhs;
-            }
-            __do_try(js_declare_variable(vm, __operand_offset(0), __operand_length(0), __lhs));
-            break;
-        case op_catch:
-            enforce(instruction.num_operands == 2);
-            enforce(instruction.operands[0].type == opd_string);
-            enforce(instruction.operands[1].type == opd_uint32);
-            value = _stack_pop_value(vm);
-            if (value.type == 0) { // no exception
-                vm->pc = instruction.operands[1].value_uint32;
-            } else {
-                _stack_push(vm, (struct js_stack_frame){.type = sf_block, .egress = instruction.operands[1].value_uint32});
-                __do_try(js_declare_variable(vm, __operand_offset(0), __operand_length(0), value));
-            }
-            break;
-        case op_throw:
-            enforce(instruction.num_operands == 0);
-            __throw(_stack_pop_value(vm));
-            break;
-        case op_member_put:
-            value = _stack_pop_value(vm);
-            selector = _stack_pop_value(vm);
-            container = _stack_peek_value(vm, 0);
-            if (container.type == vt_array && selector.type == vt_number) {
-                index = (size_t)selector.number;
-                if (index != selector.number) {
-                    __throw(js_scripture_sz("Invalid array index, must be positive integer"));
-                }
-                js_put_array_element(&container, index, value);
-            } else if (container.type == vt_object && js_is_string(&selector)) {
-                js_put_object_value(&container, js_get_string_base(&selector), (uint16_t)js_get_string_length(&selector), value);
-            } else {
-                __throw(js_scripture_sz("Must be array[number] or object[string]"));
-            }
-            break;
-        case op_member_get:
-            selector = _stack_pop_value(vm);
-            container = _stack_pop_value(vm);
-            if (container.type == vt_array && selector.type == vt_number) {
-                if (selector.number < 0) {
-                    _stack_push_value(vm, js_null());
-                } else {
-                    index = (size_t)selector.number;
-                    if (index != selector.number) {
-                        // __throw(js_scripture_sz("Invalid array index, must be positive integer"));
-                        _stack_push_value(vm, js_null());
-                    } else {
-                        _stack_push_value(vm, js_get_array_element(&container, index));
-                    }
-                }
-            } else if (container.type == vt_object && js_is_string(&selector)) {
-                _stack_push_value(vm, js_get_object_value(&container, js_get_string_base(&selector), (uint16_t)js_get_string_length(&selector)));
-            } else {
-                __throw(js_scripture_sz("Must be array[number] or object[string]"));
-            }
-            break;
-        case op_array_append:
-            value = _stack_pop_value(vm);
-            container = _stack_peek_value(vm, 0);
-            if (container.type == vt_array) {
-                js_push_array_element(&container, value);
-            } else {
-                __throw(js_scripture_sz("Must be array"));
-            }
-            break;
-        case op_array_spread:
-            value = _stack_pop_value(vm);
-            container = _stack_peek_value(vm, 0);
-            if (container.type == vt_array && value.type == vt_array) {
-                // no skip null
-                buffer_for_each(value.managed->array.base, value.managed->array.length, _, i, v, {
-                    js_push_array_element(&container, *v);
-                });
-            } else {
-                __throw(js_scripture_sz("Must be array[...array]"));
-            }
-            break;
-        case op_object_optional:
-            selector = _stack_pop_value(vm);
-            container = _stack_pop_value(vm);
-            if (container.type == vt_object && js_is_string(&selector)) {
-                _stack_push_value(vm, js_get_object_value(&container, js_get_string_base(&selector), (uint8_t)js_get_string_length(&selector)));
-            } else {
-                _stack_push_value(vm, js_null());
-            }
-            break;
-        case op_argument_spread:
-            value = _stack_pop_value(vm);
-            frame = _stack_peek(vm, 0);
-            enforce(frame->type == sf_function);
-            if (value.type != vt_array) {
-                __throw(js_scripture_sz("Parameter to be spreaded must be array"));
-            }
-            buffer_for_each(value.managed->array.base, value.managed->array.length, _, i, v, {
-                // arguments will be used by 3rd-party c functions, so special treat js_undefined here
-                buffer_push(frame->arguments.base, frame->arguments.length, frame->arguments.capacity, v->type == 0 ? js_null() : *v);
-            });
-            break;
-        case op_argument_get_rest:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_string);
-            value = js_array(&(vm->heap));
-            frame = _stack_peek(vm, 0);
-            enforce(frame->type == sf_function);
-            while (frame->arguments.index < frame->arguments.length) {
-                // special treat js_undefined come from argument spread
-                // if (frame->arguments.base[frame->arguments.index].type == 0) {
-                //     js_push_array_element(&value, js_null());
-                //     frame->arguments.index++;
-                // } else {
-                js_push_array_element(&value, frame->arguments.base[frame->arguments.index++]);
-                // }
-            };
-            __do_try(js_declare_variable(vm, __operand_offset(0), __operand_length(0), value));
-            break;
-        case op_add:
-            __rhs = _stack_pop_value(vm);
-            __lhs = _stack_pop_value(vm);
-            __do_try(js_add(&(vm->heap), &__lhs, &__rhs));
-            _stack_push_value(vm, result.value);
-            break;
-        case op_sub:
-        case op_mul:
-        case op_pow:
-        case op_div:
-        case op_mod:
-            __rhs = _stack_pop_value(vm);
-            __lhs = _stack_pop_value(vm);
-            if (__lhs.type != vt_number || __rhs.type != vt_number) {
-                __throw(js_scripture_sz("Arithmatic operand must be number"));
-            }
-            switch (instruction.opcode) {
-            case op_sub:
-                _stack_push_value(vm, js_number(__lhs.number - __rhs.number));
-                break;
-            case op_mul:
-                _stack_push_value(vm, js_number(__lhs.number * __rhs.number));
-                break;
-            case op_pow:
-                _stack_push_value(vm, js_number(pow(__lhs.number, __rhs.number)));
-                break;
-            case op_div:
-                _stack_push_value(vm, js_number(__lhs.number / __rhs.number));
-                break;
-            case op_mod:
-                _stack_push_value(vm, js_number(fmod(__lhs.number, __rhs.number)));
-                break;
-            default:
-                break;
-            }
-            break;
-        case op_eq:
-        case op_ne:
-            __rhs = _stack_pop_value(vm);
-            __lhs = _stack_pop_value(vm);
-            if (memcmp(&__lhs, &__rhs, sizeof(struct js_value)) == 0) {
-                yes = true;
-            } else if (__lhs.type == vt_number && __rhs.type == vt_number) {
-                yes = __lhs.number == __rhs.number; // DONT memcmp two double, same value may be different memory content, for example, mod result 0 == 0 may be false perhaps -0 +0
-            } else if (js_is_string(&__lhs) && js_is_string(&__rhs)) {
-                yes = js_compare_string(&__lhs, &__rhs) == 0;
-            } else {
-                yes = false;
-            }
-            if (instruction.opcode == op_ne) {
-                yes = !yes;
-            }
-            _stack_push_value(vm, js_boolean(yes));
-            break;
-        case op_lt:
-        case op_le:
-        case op_gt:
-        case op_ge:
-            __rhs = _stack_pop_value(vm);
-            __lhs = _stack_pop_value(vm);
-            if (__lhs.type == vt_number && __rhs.type == vt_number) {
-                switch (instruction.opcode) {
-                case op_lt:
-                    yes = __lhs.number < __rhs.number;
-                    break;
-                case op_le:
-                    yes = __lhs.number <= __rhs.number;
-                    break;
-                case op_gt:
-                    yes = __lhs.number > __rhs.number;
-                    break;
-                case op_ge:
-                    yes = __lhs.number >= __rhs.number;
-                    break;
-                default:
-                    break;
-                }
-            } else if (js_is_string(&__lhs) && js_is_string(&__rhs)) {
-                switch (instruction.opcode) {
-                case op_lt:
-                    yes = js_compare_string(&__lhs, &__rhs) < 0;
-                    break;
-                case op_le:
-                    yes = js_compare_string(&__lhs, &__rhs) <= 0;
-                    break;
-                case op_gt:
-                    yes = js_compare_string(&__lhs, &__rhs) > 0;
-                    break;
-                case op_ge:
-                    yes = js_compare_string(&__lhs, &__rhs) >= 0;
-                    break;
-                default:
-                    break;
-                }
-            } else {
-                __throw(js_scripture_sz("Relational operand must be number or string"));
-            }
-            _stack_push_value(vm, js_boolean(yes));
-            break;
-        case op_and:
-        case op_or:
-            __rhs = _stack_pop_value(vm);
-            __lhs = _stack_pop_value(vm);
-            if (__lhs.type != vt_boolean || __rhs.type != vt_boolean) {
-                __throw(js_scripture_sz("Logical operand must be boolean"));
-            }
-            switch (instruction.opcode) {
-            case op_and:
-                __lhs.boolean = __lhs.boolean && __rhs.boolean; //  there are no &&= ||= operators
-                break;
-            case op_or:
-                __lhs.boolean = __lhs.boolean || __rhs.boolean;
-                break;
-            default:
-                break;
-            }
-            _stack_push_value(vm, __lhs);
-            break;
-        case op_not:
-            __rhs = _stack_pop_value(vm);
-            if (__rhs.type != vt_boolean) {
-                __throw(js_scripture_sz("Logical operand must be boolean"));
-            }
-            __rhs.boolean = !__rhs.boolean;
-            _stack_push_value(vm, __rhs);
-            break;
-        // case op_ternary:
-        //     __rhs = _stack_pop_value(vm);
-        //     __lhs = _stack_pop_value(vm);
-        //     value = _stack_pop_value(vm);
-        //     if (value.type != vt_boolean) {
-        //         __throw(js_scripture_sz("Ternary condition must be boolean"));
-        //     }
-        //     _stack_push_value(vm, value.boolean ? __lhs : __rhs);
-        //     break;
-        case op_typeof:
-            __rhs = _stack_pop_value(vm);
-            enforce(__rhs.type < countof(_typeof_table));
-            _stack_push_value(vm, js_scripture_sz(_typeof_table[__rhs.type]));
-            break;
-        case op_stack_dupe: // duplicate value from stack count from top to down
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_uint8);
-            _stack_push_value(vm, _stack_peek_value(vm, instruction.operands[0].value_uint8));
-            break;
-        case op_jump_if_false:
-        case op_jump_if_true:
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_uint32);
-            value = _stack_pop_value(vm); // DONT place multiple conditional jumps together, because condition is poped
-            if (value.type != vt_boolean) {
-                __throw(js_scripture_sz("Conditional jump needs boolean"));
-            }
-            yes = instruction.opcode == op_jump_if_true ? value.boolean : !value.boolean;
-            if (yes) {
-                vm->pc = instruction.operands[0].value_uint32;
-            }
-            break;
-        case op_break:
-            _stack_pop_to(vm, sf_loop);
-            enforce(vm->stack.length > 0);
-            frame = _stack_peek(vm, 0);
-            vm->pc = frame->egress;
-            _stack_pop(vm, 1);
-            break;
-        case op_continue:
-            _stack_pop_to(vm, sf_loop);
-            enforce(vm->stack.length > 0);
-            frame = _stack_peek(vm, 0);
-            vm->pc = frame->ingress;
-            break;
-        case op_for_in_next: // push next value into stack top
-        case op_for_of_next: // push next value into stack top
-            enforce(instruction.num_operands == 1);
-            enforce(instruction.operands[0].type == opd_uint32);
-            value = _stack_pop_value(vm);
-            index = (size_t)value.number; // loop number
-            container = _stack_peek_value(vm, 0); // array/object to be looped
-            yes = false; // whether success
-            if (container.type == vt_array) {
-                for (; index < container.managed->array.length; index++) {
-                    value = container.managed->array.base[index];
-                    if (value.type != vt_undefined && value.type != vt_null) {
-                        if (instruction.opcode == op_for_in_next) {
-                            value = js_number((double)index);
-                        }
-                        yes = true;
-                        break;
-                    }
-                }
-            } else if (container.type == vt_object) {
-                // js_value_map_dump(value->value.object->p, value->value.object->len, value->value.object->cap);
-                for (; index < container.managed->object.capacity; index++) {
-                    struct js_kv_pair *kv = container.managed->object.base + index;
-                    if (kv->key.base != NULL && kv->value.type != vt_undefined && kv->value.type != vt_null) {
-                        // printf("index = %llu\index", index);
-                        if (instruction.opcode == op_for_in_next) {
-                            value = js_string(&(vm->heap), kv->key.base, kv->key.length);
-                        } else {
-                            value = kv->value;
-                        }
-                        yes = true;
-                        break;
-                    }
-                }
-            } else {
-                __throw(js_scripture_sz("'for in/of' operand must be array or object"));
-            }
-            _stack_push_value(vm, js_number((double)(index + 1))); // write back loop number
-            if (yes) {
-                _stack_push_value(vm, value);
-            } else {
-                vm->pc = instruction.operands[0].value_uint32;
-            }
-            break;
-        case op_stack_swap:
-            enforce(instruction.num_operands == 2);
-            enforce(instruction.operands[0].type == opd_uint8);
-            enforce(instruction.operands[1].type == opd_uint8);
-            _stack_swap(vm, instruction.operands[0].value_uint8, instruction.operands[1].value_uint8);
-            break;
-        default:
-            fatal("Unknown opcode %u", instruction.opcode);
-            break;
-        }
-    end_of_while_loop:
-        // (void)0;
-        curr_offset = vm->pc;
-    }
-    js_return(js_null());
-#undef __rhs
-#undef __lhs
-#undef __throw
-#undef __operand_0_length
-#undef __operand_0_offset
-#undef __debug
-}
-
-void js_gc(struct js_vm *vm) {
-#define __mark_map(__arg_map) \
-    js_map_for_each((__arg_map).base, (__arg_map).length, (__arg_map).capacity, k, kl, v, { \
-        (void)k; \
-        (void)kl; \
-        js_mark(v); \
-    })
-#define __mark_list(__arg_map) \
-    js_list_for_each((__arg_map).base, (__arg_map).length, (__arg_map).capacity, i, v, { \
-        (void)i; \
-        js_mark(v); \
-    })
-    __mark_map(vm->globals);
-    _call_stack_for_each(vm, frame, {
-        __mark_map(frame->locals);
-        if (frame->type == sf_function) {
-            // some anonumous functions which are in use by callee
-            // c function's arguments must also be marked, for example, in an anonymous callback of c function, invoked gc(), this callback be sweeped, boom!
-            __mark_list(frame->arguments);
-            if (frame->function != NULL) {
-                __mark_map(frame->function->function.closure);
-            }
-        }
-    });
-    js_sweep(&(vm->heap));
-#undef __mark_list
-#undef __mark_map
-}
-
-struct js_result js_call(struct js_vm *vm, struct js_value fv, uint16_t argc, struct js_value *argv) {
-    if (fv.type == vt_function) {
-        // backup stack depth, in callee, may throw error, stack won't be cleaned up, if not cleaned here and return at upper vm's 'op_call', and '__do_try' will check stack and found leftover .egress=0 stack, and exit vm, this shouldn't happen
-        uint16_t stack_length_backup = vm->stack.length;
-        buffer_push(vm->stack.base, vm->stack.length, vm->stack.capacity,
-            ((struct js_stack_frame){.type = sf_value, .value = fv}));
-        struct js_stack_frame frame = (struct js_stack_frame){.type = sf_function, .function = fv.managed, .egress = 0}; // 0 indicates called by c function
-        // prepare arguments
-        for (uint16_t i = 0; i < argc; i++) {
-            // js_dump_value(argv + i);
-            // printf("\n");
-            // special treat for vt_undefined from such as array element passed to sort callback
-            struct js_value arg = argv[i];
-            if (arg.type == 0) {
-                arg = js_null();
-            }
-            buffer_push(frame.arguments.base, frame.arguments.length, frame.arguments.capacity, arg);
-        }
-        buffer_push(vm->stack.base, vm->stack.length, vm->stack.capacity, frame);
-        // backup program counter, jump to function ingress, wait for function completion
-        uint32_t pc_backup = vm->pc;
-        vm->pc = fv.managed->function.ingress;
-        struct js_result result = js_run(vm);
-        vm->pc = pc_backup;
-        // restore to backuped stack depth
-        if (vm->stack.length > stack_length_backup) {
-            _stack_pop(vm, vm->stack.length - stack_length_backup);
-        }
-        return result;
-    } else if (fv.type == vt_c_function) {
-        // TODO: still need stack?
-        buffer_push(vm->stack.base, vm->stack.length, vm->stack.capacity,
-            ((struct js_stack_frame){.type = sf_value, .value = fv}));
-        struct js_stack_frame frame = (struct js_stack_frame){.type = sf_function};
-        for (uint16_t i = 0; i < argc; i++) {
-            // is it necessart to special treat for vt_undefined like above? maybe not, c_function can handle it
-            buffer_push(frame.arguments.base, frame.arguments.length, frame.arguments.capacity, argv[i]);
-        }
-        buffer_push(vm->stack.base, vm->stack.length, vm->stack.capacity, frame);
-        struct js_result result = ((js_c_function_type)fv.c_function)(vm, _get_arguments_length(vm), _get_arguments_base(vm));
-        _stack_pop(vm, 2);
-        return result;
-    } else {
-        js_throw(js_scripture_sz("Not a function"));
-    }
-}
-
-struct js_result js_call_by_name(struct js_vm *vm, const char *name, uint16_t name_length, uint16_t argc, struct js_value *argv) {
-    struct js_result result = js_get_variable(vm, name, name_length);
-    if (!result.success) {
-        return result;
-    }
-    return js_call(vm, result.value, argc, argv);
-}
-
-struct js_value js_c_function(js_c_function_type c_function) {
-    return (struct js_value){.type = vt_c_function, .c_function = c_function};
-}
-
-void js_free_vm(struct js_vm *vm) {
-    buffer_free(vm->bytecode.base, vm->bytecode.length, vm->bytecode.capacity);
-    buffer_free(vm->cross_reference.base, vm->cross_reference.length, vm->cross_reference.capacity);
-    js_sweep(&(vm->heap));
-    js_sweep(&(vm->heap));
-    js_map_free(vm->globals.base, vm->globals.length, vm->globals.capacity);
-    _stack_pop(vm, vm->stack.length);
-}
-
-struct js_vm js_static_vm_internal(uint8_t *bc, uint32_t bc_len, uint32_t *xref, uint32_t xref_len) {
-    return (struct js_vm){
-        .bytecode = {
-            .base = bc,
-            .length = bc_len,
-            .capacity = bc_len,
-        },
-        .cross_reference = {
-            .base = xref,
-            .length = xref_len,
-            .capacity = xref_len,
-        },
-    };
-}
-
-void js_declare_argc_argv(struct js_vm *vm, int argc, char *argv[]) {
-    js_declare_variable_sz(vm, "argc", js_number(argc));
-    struct js_value arg_vector = js_array(&(vm->heap));
-    for (int i = 0; i < argc; i++) {
-        js_push_array_element(&arg_vector, js_scripture_sz(argv[i]));
-    }
-    js_declare_variable_sz(vm, "argv", arg_vector);
-}
-
-int js_default_routine(struct js_vm *vm) {
-    struct js_result result = js_run(vm);
-    if (result.success) {
-        switch (result.value.type) {
-        case vt_number:
-            return (int)result.value.number;
-        case vt_boolean:
-            return result.value.boolean ? EXIT_SUCCESS : EXIT_FAILURE;
-        default:
-            return EXIT_SUCCESS;
-        }
-    } else {
-        printf("Runtime Error: ");
-        js_dump_value(&(result.value));
-        printf("\n");
-        return EXIT_FAILURE;
-    }
-}
-
-#ifdef DEBUG
-
-void test_vm_structure_size() {
-    // log_expression("%zu", sizeof(struct js_call_stack_frame));
-    log_expression("%zu", sizeof(struct js_bytecode));
-    log_expression("%zu", sizeof(struct js_cross_reference));
-    log_expression("%zu", sizeof(struct js_stack_frame));
-    log_expression("%zu", sizeof(struct js_vm));
-    log_expression("%zu", sizeof(struct _operand));
-    log_expression("%zu", sizeof(struct _instruction));
-}
-
-void test_instruction_get_put() {
-    // {
-    //     uint8_t base[] = {
-    //         0b11000000, // nop, null, false, true
-    //         0b00010000,
-    //         0b00000001,
-    //         0b00000000,
-    //         0b00000001,
-    //         0b11000000, // nop, uint8, int32, uint32
-    //         0b01000010,
-    //         0b00000101,
-    //         0b00000000, // uint8
-    //         0b00000000, // int32
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000, // uint32
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         0b11000000, // nop, double, string, function
-    //         0b01110110,
-    //         0b00001000,
-    //         0b00000000, // double
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         0b10000000,
-    //         0b00000101, // string
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //         'h',
-    //         'e',
-    //         'l',
-    //         'l',
-    //         'o',
-    //         0b00000011, // function
-    //         0b00000000,
-    //         0b00000000,
-    //         0b00000000,
-    //     };
-    //     struct js_bytecode bytecode = {
-    //         .base = base,
-    //         .length = countof(base),
-    //         .capacity = countof(base),
-    //     };
-    //     buffer_dump(bytecode.base, bytecode.length, bytecode.capacity);
-    //     js_bytecode_dump(&bytecode);
-    // }
-    {
-        struct js_bytecode bytecode = {0};
-        uint32_t offset = 0;
-        js_put_instruction(&bytecode, &offset, op_nop, 0);
-        js_put_instruction(&bytecode, &offset, op_nop, 1, opd_null);
-        js_put_instruction(&bytecode, &offset, op_nop, 2, opd_boolean, opd_boolean, false, true);
-        js_put_instruction(&bytecode, &offset, op_nop, 3, opd_uint8, opd_uint16, opd_uint32, UINT8_MAX, UINT16_MAX, UINT32_MAX);
-        js_put_instruction(&bytecode, &offset, op_nop, 3, opd_double, opd_string, opd_function, -0.123456, 12, "Hello,World!", 666);
-        buffer_dump(bytecode.base, bytecode.length, bytecode.capacity);
-        js_bytecode_dump(&bytecode);
-    }
-}
-
-void test_vm_run() {
-    struct js_vm vm = {};
-    js_add_instruction(&(vm.bytecode), op_nop, 0);
-    js_add_instruction(&(vm.bytecode), op_stack_push, 2, opd_uint8, opd_boolean, sf_value, false);
-    js_add_instruction(&(vm.bytecode), op_variable_declare, 1, opd_string, 3, "foo");
-    js_add_instruction(&(vm.bytecode), op_stack_push, 2, opd_uint8, opd_double, sf_value, 1.23456);
-    js_add_instruction(&(vm.bytecode), op_variable_declare, 1, opd_string, 3, "bar");
-    js_add_instruction(&(vm.bytecode), op_stack_push, 2, opd_uint8, opd_string, sf_value, 5, "hello");
-    js_add_instruction(&(vm.bytecode), op_variable_declare, 1, opd_string, 3, "baz");
-    js_bytecode_dump(&(vm.bytecode));
-    js_run(&vm);
-    js_dump_vm(&vm);
-}
-
+/*
+Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include "js-vm.h"
+#ifdef JS_JIT
+    #include <sys/mman.h> // mmap mprotect
+    #include <unistd.h> // sysconf
+#endif
+
+#define X(name) #name,
+static const char *const _opcode_names[] = {js_opcode_list};
+static const char *const _value_type_names[] = {js_value_type_list};
+#undef X
+
+#pragma pack(push, 1)
+struct _operand {
+    uint8_t type;
+    union {
+        bool value_bool;
+        uint8_t value_uint8;
+        uint16_t value_uint16;
+        int32_t value_int32;
+        uint32_t value_uint32;
+        double value_double;
+        struct {
+            uint32_t offset;
+            uint32_t length;
+        } value_string;
+        struct {
+            uint32_t ingress;
+        } value_function;
+    };
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct _instruction {
+    uint8_t opcode : 6;
+    uint8_t num_operands : 2;
+    struct _operand operands[3];
+};
+#pragma pack(pop)
+
+static bool _get_instruction(struct js_bytecode *bytecode, uint32_t *offset /* in,out */, struct _instruction *instruction /* out */) {
+#define __safe_forward(__arg_num_bytes, __arg_statement) \
+    do { \
+        if ((bytecode->length - *offset) < __arg_num_bytes) { \
+            log_warning("__safe_forward failed"); \
+            return false; \
+        } \
+        __arg_statement; \
+        (*offset) += __arg_num_bytes; \
+    } while (0)
+#define __current_position (bytecode->base + *offset)
+    if ((bytecode->length - *offset) < 1) {
+        return false; // end of bytecode, skip warning
+    }
+    __safe_forward(1, *((uint8_t *)instruction) = *__current_position);
+    if (instruction->num_operands > 0) {
+        __safe_forward(1, {
+            instruction->operands[0].type = *__current_position & 0b00001111;
+            instruction->operands[1].type = *__current_position >> 4;
+        });
+    }
+    if (instruction->num_operands > 2) {
+        __safe_forward(1, instruction->operands[2].type = *__current_position & 0b00001111);
+    }
+    for (uint8_t i = 0; i < instruction->num_operands; i++) { // be careful: 0 means 1 operand
+        switch (instruction->operands[i].type) {
+        case opd_undefined:
+        case opd_null:
+        case opd_empty_array:
+        case opd_empty_object:
+            break;
+        case opd_boolean:
+            __safe_forward(1, instruction->operands[i].value_bool = *__current_position != 0);
+            break;
+        case opd_uint8:
+            __safe_forward(1, instruction->operands[i].value_uint8 = *__current_position);
+            break;
+        case opd_uint16:
+            __safe_forward(2, instruction->operands[i].value_uint16 = *((uint16_t *)__current_position));
+            break;
+        case opd_uint32:
+            __safe_forward(4, instruction->operands[i].value_uint32 = *((uint32_t *)__current_position));
+            break;
+        case opd_double:
+            __safe_forward(8, instruction->operands[i].value_double = *((double *)__current_position));
+            break;
+        case opd_string:
+            __safe_forward(4, instruction->operands[i].value_string.length = *((uint32_t *)__current_position));
+            instruction->operands[i].value_string.offset = *offset;
+            __safe_forward(instruction->operands[i].value_string.length, );
+            break;
+        case opd_function:
+            __safe_forward(4, instruction->operands[i].value_function.ingress = *((uint32_t *)__current_position));
+            break;
+        default:
+            printf("Unknown type %u\n", instruction->operands[i].type);
+            return false;
+        }
+    }
+    return true;
+#undef __current_position
+#undef __safe_forward
+}
+
+// args are: operand types, operands, and with string, are length and base address
+static void _put_instruction(struct js_bytecode *bytecode /* in,out */, uint32_t *offset /* in,out */, uint8_t opcode, uint8_t num_operands, va_list args) {
+#define __safe_forward(__arg_num_bytes, __arg_statement) \
+    do { \
+        buffer_alloc(bytecode->base, bytecode->length, bytecode->capacity, *offset + __arg_num_bytes); \
+        __arg_statement; \
+        (*offset) += __arg_num_bytes; \
+        if (bytecode->length < *offset) { \
+            bytecode->length = *offset; \
+        } \
+    } while (0)
+#define __current_position (bytecode->base + *offset)
+    enforce(opcode < 64);
+    enforce(num_operands < 4);
+    __safe_forward(1, *__current_position = opcode + (num_operands << 6));
+    uint8_t types[3] = {0};
+    for (uint8_t i = 0; i < num_operands; i++) {
+        types[i] = (uint8_t)va_arg(args, int);
+    }
+    if (num_operands > 0) {
+        __safe_forward(1, *__current_position = types[0] + (types[1] << 4));
+    }
+    if (num_operands > 2) {
+        __safe_forward(1, *__current_position = types[2]);
+    }
+    for (uint8_t i = 0; i < num_operands; i++) {
+        switch (types[i]) {
+        case opd_undefined:
+        case opd_null:
+        case opd_empty_array:
+        case opd_empty_object:
+            break;
+        case opd_boolean:
+            __safe_forward(1, *__current_position = (bool)va_arg(args, int) ? 1 : 0); // is promoted to 'int'
+            break;
+        case opd_uint8:
+            __safe_forward(1, *((uint8_t *)__current_position) = (uint8_t)va_arg(args, int)); // is promoted to 'int'
+            break;
+        case opd_uint16:
+            __safe_forward(2, *((uint16_t *)__current_position) = (uint16_t)va_arg(args, int)); // is promoted to 'int'
+            break;
+        case opd_uint32:
+            __safe_forward(4, *((uint32_t *)__current_position) = va_arg(args, uint32_t));
+            break;
+        case opd_double:
+            __safe_forward(8, *((double *)__current_position) = va_arg(args, double));
+            break;
+        case opd_string:
+            uint32_t slen = va_arg(args, uint32_t);
+            __safe_forward(4, *((uint32_t *)__current_position) = slen);
+            const char *s = va_arg(args, const char *);
+            __safe_forward(slen, memcpy(__current_position, s, slen));
+            break;
+        case opd_function:
+            __safe_forward(4, *((uint32_t *)__current_position) = (uint32_t)va_arg(args, int));
+            break;
+        default:
+            fatal("Unknown type %u", types[i]);
+        }
+    }
+#undef __current_position
+#undef __safe_forward
+}
+
+void js_put_instruction(struct js_bytecode *bytecode /* in,out */, uint32_t *offset /* in,out */, uint8_t opcode, uint8_t num_operands, ...) {
+    va_list args;
+    va_start(args, num_operands);
+    _put_instruction(bytecode, offset, opcode, num_operands, args);
+    va_end(args);
+}
+
+void js_add_instruction(struct js_bytecode *bytecode /* in,out */, uint8_t opcode, uint8_t num_operands, ...) {
+    uint32_t offset = bytecode->length;
+    va_list args;
+    va_start(args, num_operands);
+    _put_instruction(bytecode, &offset, opcode, num_operands, args);
+    va_end(args);
+}
+
+void js_add_cross_reference(struct js_cross_reference *cross_reference, uint32_t source_line, uint32_t bytecode_offset) {
+    buffer_put(cross_reference->base, cross_reference->length, cross_reference->capacity, source_line, bytecode_offset);
+}
+
+// #define X(name) #name,
+// static const char *const _call_stack_frame_type_names[] = {js_call_stack_frame_type_list};
+// #undef X
+
+#define X(name) #name,
+static const char *const _stack_frame_type_names[] = {js_stack_frame_type_list};
+#undef X
+
+static void _instruction_dump(uint8_t *base, struct _instruction *instruction) {
+    int n = 0;
+    printf("%-24s    ", _opcode_names[instruction->opcode]);
+    for (uint8_t i = 0; i < instruction->num_operands; i++) {
+        if (i > 0) {
+            n += printf("  ");
+        }
+        switch (instruction->operands[i].type) {
+        case opd_undefined:
+            n += printf("undefined");
+            break;
+        case opd_null:
+            n += printf("null");
+            break;
+        case opd_empty_array:
+            n += printf("[]");
+            break;
+        case opd_empty_object:
+            n += printf("{}");
+            break;
+        case opd_boolean:
+            n += printf("%s", instruction->operands[i].value_bool ? "true" : "false");
+            break;
+        case opd_uint8:
+            n += printf("<u8 %u>", instruction->operands[i].value_uint8);
+            break;
+        case opd_uint16:
+            n += printf("<u16 %u>", instruction->operands[i].value_uint16);
+            break;
+        case opd_uint32:
+            n += printf("<u32 %u>", instruction->operands[i].value_uint32);
+            break;
+        case opd_double:
+            n += printf("%g", instruction->operands[i].value_double);
+            break;
+        case opd_string:
+            n += printf("''%.*s''", instruction->operands[i].value_string.length, base + instruction->operands[i].value_string.offset);
+            break;
+        case opd_function:
+            n += printf("<function %u>", instruction->operands[i].value_function.ingress);
+            break;
+        default:
+            break;
+        }
+    }
+    printf("%*s", max(24 - n, 2), "");
+    // comment for special types
+    switch (instruction->opcode) {
+    case op_stack_push:
+        enforce(instruction->num_operands > 0);
+        enforce(instruction->operands[0].type == opd_uint8);
+        enforce(instruction->operands[0].value_uint8 < countof(_stack_frame_type_names));
+        if (instruction->operands[0].value_uint8 != sf_value) {
+            printf("; %s", _stack_frame_type_names[instruction->operands[0].value_uint8]);
+        }
+        break;
+    case op_member_update:
+        printf("; %s", _opcode_names[instruction->operands[0].value_uint8]);
+        break;
+    case op_slot_update:
+        printf("; %s", _opcode_names[instruction->operands[1].value_uint32 >> 16]);
+        break;
+    case op_compare_jump:
+        printf("; %s", _opcode_names[instruction->operands[1].value_uint8]);
+        break;
+    default:
+        break;
+    }
+}
+
+void js_bytecode_dump(struct js_bytecode *bytecode) {
+    struct _instruction instruction;
+    for (uint32_t offset = 0, next_offset = 0; _get_instruction(bytecode, &next_offset, &instruction); offset = next_offset) {
+        printf("%10u  ", offset);
+        _instruction_dump(bytecode->base, &instruction);
+        printf("\n");
+    };
+    printf("\n");
+}
+
+// unlike struct _operand, string is pointer and address is instruction index, no more calculation at run time
+struct _decoded_operand {
+    uint8_t type;
+    union {
+        bool value_bool;
+        uint8_t value_uint8;
+        uint16_t value_uint16;
+        uint32_t value_uint32; // if is address, resolved to instruction index
+        double value_double;
+        struct {
+            char *base;
+            uint32_t offset; // for rebase
+            uint32_t length;
+            struct js_atom *atom; // interned when decoded, NULL if too long, never moves
+        } value_string;
+        struct {
+            uint32_t ingress; // still bytecode offset, because it is saved into function value
+        } value_function;
+    };
+};
+
+// not packed, it is read on hot path
+struct js_instruction {
+    uint8_t opcode;
+    uint8_t num_operands;
+    uint32_t offset; // bytecode offset, for cross reference
+    struct _decoded_operand operands[3];
+    union { // filled at decode time or run time
+        struct {
+            struct js_kv_pair *node; // NULL means not resolved
+            uint32_t version; // compared with vm->globals_version
+        } global;
+        struct js_value literal; // string pushed by op_stack_push, undefined if too long to be interned
+        uint32_t member; // index of vm->decoded.member_caches, for member access instructions
+    } cache;
+};
+
+#define _member_cache_ways 4
+
+// monomorphic at first, up to _member_cache_ways layouts, then replaced round robin
+// shapes are immutable, so same shape means same slot
+// for dictionary mode objects, an entry hits when map has same capacity and the key is still at recorded slot, so map changes never need invalidation
+struct js_member_cache {
+    struct {
+        struct js_atom *atom; // selector, may vary if not constant
+        struct js_shape *shape; // NULL for dictionary mode
+        uint32_t capacity; // layout of dictionary
+        uint32_t slot;
+    } entries[_member_cache_ways];
+    uint8_t length;
+    uint8_t next; // to be replaced when full
+    uint32_t hits;
+    uint32_t misses; // including string selectors which are not atoms
+};
+
+// frame_type is op_stack_push's first operand
+static bool _is_address_operand(uint8_t opcode, uint8_t frame_type, uint8_t i, uint8_t type) {
+    switch (opcode) {
+    case op_jump:
+    case op_jump_if_false:
+    case op_jump_if_true:
+    case op_and:
+    case op_or:
+    case op_for_in_next:
+    case op_for_of_next:
+    case op_compare_jump:
+        return i == 0;
+    case op_catch:
+        return i == 1;
+    case op_stack_push: // sf_function and sf_try's egress, sf_loop's ingress and egress
+        return i > 0 && type == opd_uint32 && frame_type != sf_value;
+    default:
+        return false;
+    }
+}
+
+static uint32_t _index_of(struct js_vm *vm, uint32_t offset) {
+    if (offset >= vm->decoded.indices.length || vm->decoded.indices.base[offset] == UINT32_MAX) {
+        fatal("Offset %u is not instruction boundary", offset);
+    }
+    return vm->decoded.indices.base[offset];
+}
+
+static struct js_value _integer(int32_t integer) {
+    return (struct js_value){.type = vt_integer, .integer = integer};
+}
+
+// integral double literals within int32 become integers, except -0
+static struct js_value _number_literal(double number) {
+    if (number >= INT32_MIN && number <= INT32_MAX && number == (int32_t)number && !(number == 0 && signbit(number))) {
+        return _integer((int32_t)number);
+    }
+    return js_number(number);
+}
+
+// decode from where last time stopped to the end of bytecode, so repl appended bytecode will only be decoded once
+static void _decode(struct js_vm *vm) {
+    struct js_bytecode *bytecode = &(vm->bytecode);
+    struct _instruction raw;
+    uint32_t first = vm->decoded.length;
+    uint32_t offset = vm->decoded.indices.length > 0 ? vm->decoded.indices.length - 1 : 0; // decoded bytes
+    if (vm->decoded.bytecode_base != bytecode->base) {
+        buffer_for_each(vm->decoded.base, vm->decoded.length, vm->decoded.capacity, i, instruction, {
+            for (uint8_t j = 0; j < instruction->num_operands; j++) {
+                if (instruction->operands[j].type == opd_string) {
+                    instruction->operands[j].value_string.base = (char *)bytecode->base + instruction->operands[j].value_string.offset;
+                }
+            }
+        });
+        vm->decoded.bytecode_base = bytecode->base;
+    }
+    if (vm->decoded.indices.length > 0 && offset >= bytecode->length) {
+        return;
+    }
+    buffer_alloc(vm->decoded.indices.base, vm->decoded.indices.length, vm->decoded.indices.capacity, bytecode->length + 1);
+    for (uint32_t i = offset; i <= bytecode->length; i++) {
+        vm->decoded.indices.base[i] = UINT32_MAX;
+    }
+    for (;;) {
+        uint32_t next_offset = offset;
+        vm->decoded.indices.base[offset] = vm->decoded.length; // if stopped here, means end of stream
+        if (!_get_instruction(bytecode, &next_offset, &raw)) {
+            break;
+        }
+        if (raw.opcode >= countof(_opcode_names)) { // dispatch table has no such entry
+            fatal("Unknown opcode %u", raw.opcode);
+        }
+        struct js_instruction instruction = {.opcode = raw.opcode, .num_operands = raw.num_operands, .offset = offset};
+        for (uint8_t i = 0; i < raw.num_operands; i++) {
+            struct _decoded_operand *operand = instruction.operands + i;
+            operand->type = raw.operands[i].type;
+            switch (operand->type) {
+            case opd_boolean:
+                operand->value_bool = raw.operands[i].value_bool;
+                break;
+            case opd_uint8:
+                operand->value_uint8 = raw.operands[i].value_uint8;
+                break;
+            case opd_uint16:
+                operand->value_uint16 = raw.operands[i].value_uint16;
+                break;
+            case opd_uint32:
+                operand->value_uint32 = raw.operands[i].value_uint32;
+                break;
+            case opd_double:
+                operand->value_double = raw.operands[i].value_double;
+                break;
+            case opd_string:
+                operand->value_string.base = (char *)bytecode->base + raw.operands[i].value_string.offset;
+                operand->value_string.offset = raw.operands[i].value_string.offset;
+                operand->value_string.length = raw.operands[i].value_string.length;
+                operand->value_string.atom = operand->value_string.length <= UINT16_MAX ? js_atom(&(vm->heap), operand->value_string.base, (uint16_t)operand->value_string.length) : NULL;
+                break;
+            case opd_function:
+                operand->value_function.ingress = raw.operands[i].value_function.ingress;
+                break;
+            default:
+                break;
+            }
+        }
+        if (raw.opcode == op_stack_push && raw.num_operands == 2 && raw.operands[0].value_uint8 == sf_value && raw.operands[1].type == opd_string && instruction.operands[1].value_string.atom) {
+            instruction.cache.literal = js_scripture_atom(instruction.operands[1].value_string.atom);
+        } else if (raw.opcode == op_stack_push && raw.num_operands == 2 && raw.operands[0].value_uint8 == sf_value && raw.operands[1].type == opd_double) {
+            instruction.cache.literal = _number_literal(instruction.operands[1].value_double);
+        }
+        switch (raw.opcode) {
+        case op_member_get:
+        case op_member_get_const:
+        case op_member_put:
+        case op_member_update:
+        case op_object_optional:
+            instruction.cache.member = vm->decoded.member_caches.length;
+            buffer_push(vm->decoded.member_caches.base, vm->decoded.member_caches.length, vm->decoded.member_caches.capacity, (struct js_member_cache){0});
+            break;
+        default:
+            break;
+        }
+        buffer_push(vm->decoded.base, vm->decoded.length, vm->decoded.capacity, instruction);
+        offset = next_offset;
+    }
+    vm->decoded.indices.length = offset + 1;
+    // resolve addresses after whole range decoded, because most jumps are forward
+    for (uint32_t i = first; i < vm->decoded.length; i++) {
+        struct js_instruction *instruction = vm->decoded.base + i;
+        for (uint8_t j = 0; j < instruction->num_operands; j++) {
+            if (_is_address_operand(instruction->opcode, instruction->operands[0].value_uint8, j, instruction->operands[j].type)) {
+                instruction->operands[j].value_uint32 = _index_of(vm, instruction->operands[j].value_uint32);
+            }
+        }
+    }
+}
+
+static void _jit_flush(struct js_vm *);
+
+// used by repl to rollback failed statements, decoded instructions must be dropped too, or they will be wrongly reused
+void js_truncate_bytecode(struct js_vm *vm, uint32_t length) {
+    vm->bytecode.length = length;
+    if (vm->decoded.indices.length > length + 1) {
+        uint32_t index = _index_of(vm, length);
+        vm->decoded.length = index;
+        vm->decoded.indices.length = length + 1;
+        if (vm->decoded.type_feedback.length > index) { // zeroed, so that they are fresh when grown again
+            memset(vm->decoded.type_feedback.base + index, 0, (vm->decoded.type_feedback.length - index) * sizeof(struct js_type_feedback));
+            vm->decoded.type_feedback.length = index;
+        }
+        _jit_flush(vm);
+    }
+}
+
+// encode decoded instruction, string operands are copied from where their offsets point to in string_base
+static void _put_decoded_instruction(struct js_bytecode *bytecode /* in,out */, uint32_t *offset /* in,out */, struct _instruction *instruction, uint8_t *string_base) {
+#define __safe_forward(__arg_num_bytes, __arg_statement) \
+    do { \
+        buffer_alloc(bytecode->base, bytecode->length, bytecode->capacity, *offset + __arg_num_bytes); \
+        __arg_statement; \
+        (*offset) += __arg_num_bytes; \
+        if (bytecode->length < *offset) { \
+            bytecode->length = *offset; \
+        } \
+    } while (0)
+#define __current_position (bytecode->base + *offset)
+    __safe_forward(1, *__current_position = instruction->opcode + (instruction->num_operands << 6));
+    if (instruction->num_operands > 0) {
+        __safe_forward(1, *__current_position = instruction->operands[0].type + ((instruction->num_operands > 1 ? instruction->operands[1].type : 0) << 4));
+    }
+    if (instruction->num_operands > 2) {
+        __safe_forward(1, *__current_position = instruction->operands[2].type);
+    }
+    for (uint8_t i = 0; i < instruction->num_operands; i++) {
+        struct _operand *operand = instruction->operands + i;
+        switch (operand->type) {
+        case opd_undefined:
+        case opd_null:
+        case opd_empty_array:
+        case opd_empty_object:
+            break;
+        case opd_boolean:
+            __safe_forward(1, *__current_position = operand->value_bool ? 1 : 0);
+            break;
+        case opd_uint8:
+            __safe_forward(1, *__current_position = operand->value_uint8);
+            break;
+        case opd_uint16:
+            __safe_forward(2, *((uint16_t *)__current_position) = operand->value_uint16);
+            break;
+        case opd_uint32:
+            __safe_forward(4, *((uint32_t *)__current_position) = operand->value_uint32);
+            break;
+        case opd_double:
+            __safe_forward(8, *((double *)__current_position) = operand->value_double);
+            break;
+        case opd_string:
+            __safe_forward(4, *((uint32_t *)__current_position) = operand->value_string.length);
+            __safe_forward(operand->value_string.length, memcpy(__current_position, string_base + operand->value_string.offset, operand->value_string.length));
+            break;
+        case opd_function:
+            __safe_forward(4, *((uint32_t *)__current_position) = operand->value_function.ingress);
+            break;
+        default:
+            fatal("Unknown type %u", operand->type);
+        }
+    }
+#undef __current_position
+#undef __safe_forward
+}
+
+// peephole optimizer works on instructions of one compile unit, they are decoded into array, rewritten, then encoded back
+// addresses stay original bytecode offsets until encoding, address of removed instruction means next remaining one
+struct _peephole_instruction {
+    struct _instruction instruction;
+    uint32_t offset; // original bytecode offset
+    uint32_t new_offset; // relative to beginning of unit
+    bool is_target; // jumped to, function ingress or return address, can't be merged into previous instructions
+    bool is_removed;
+};
+
+// NULL if operand i is not address, function's ingress is address too
+static uint32_t *_peephole_address(struct _instruction *instruction, uint8_t i) {
+    if (instruction->operands[i].type == opd_function) {
+        return &(instruction->operands[i].value_function.ingress);
+    }
+    if (_is_address_operand(instruction->opcode, instruction->operands[0].value_uint8, i, instruction->operands[i].type)) {
+        return &(instruction->operands[i].value_uint32);
+    }
+    return NULL;
+}
+
+// first instruction whose original offset is not less than offset, length if none
+static uint32_t _peephole_find(struct _peephole_instruction *base, uint32_t length, uint32_t offset) {
+    uint32_t low = 0, high = length;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (base[middle].offset < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// first remaining at or after index, length if none
+static uint32_t _peephole_next(struct _peephole_instruction *base, uint32_t length, uint32_t index) {
+    for (; index < length && base[index].is_removed; index++) {
+    }
+    return index;
+}
+
+// last remaining before index, UINT32_MAX if none
+static uint32_t _peephole_prev(struct _peephole_instruction *base, uint32_t index) {
+    while (index > 0) {
+        if (!base[--index].is_removed) {
+            return index;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void _peephole_remove(struct _peephole_instruction *base, uint32_t length, uint32_t index) {
+    base[index].is_removed = true;
+    if (base[index].is_target) { // whoever jumps here now lands on next one
+        index = _peephole_next(base, length, index + 1);
+        if (index < length) {
+            base[index].is_target = true;
+        }
+    }
+}
+
+static bool _peephole_is_constant(struct _peephole_instruction *base, uint32_t index, uint8_t type) {
+    if (index == UINT32_MAX) {
+        return false;
+    }
+    struct _instruction *instruction = &(base[index].instruction);
+    return instruction->opcode == op_stack_push && instruction->num_operands == 2 && instruction->operands[0].value_uint8 == sf_value && instruction->operands[1].type == type;
+}
+
+// follow op_jump chain, and same logical opcode chain, because value is kept and decision is same, returns original offset of final remaining instruction
+static uint32_t _peephole_resolve(struct _peephole_instruction *base, uint32_t length, uint32_t begin, uint32_t end, uint32_t address, uint8_t opcode) {
+    for (uint8_t hops = 0; hops < 16 && address >= begin && address < end; hops++) { // limited, 'while (true) {}' is a cycle
+        uint32_t index = _peephole_next(base, length, _peephole_find(base, length, address));
+        if (index >= length) {
+            return end;
+        }
+        struct _instruction *instruction = &(base[index].instruction);
+        if (instruction->num_operands == 1 && (instruction->opcode == op_jump || instruction->opcode == opcode)) {
+            address = instruction->operands[0].value_uint32;
+        } else {
+            return base[index].offset;
+        }
+    }
+    return address;
+}
+
+// result is written into lhs, returns false if can't be decided at compile time
+static bool _peephole_fold(struct _operand *lhs, struct _operand *rhs, uint8_t opcode) {
+    bool yes;
+    if (lhs->type == opd_boolean && rhs->type == opd_boolean && (opcode == op_eq || opcode == op_ne)) {
+        lhs->value_bool = (lhs->value_bool == rhs->value_bool) == (opcode == op_eq);
+        return true;
+    }
+    if (lhs->type != opd_double || rhs->type != opd_double) {
+        return false;
+    }
+    switch (opcode) {
+    case op_add:
+        lhs->value_double = lhs->value_double + rhs->value_double;
+        return true;
+    case op_sub:
+        lhs->value_double = lhs->value_double - rhs->value_double;
+        return true;
+    case op_mul:
+        lhs->value_double = lhs->value_double * rhs->value_double;
+        return true;
+    case op_pow:
+        lhs->value_double = pow(lhs->value_double, rhs->value_double);
+        return true;
+    case op_div:
+        lhs->value_double = lhs->value_double / rhs->value_double;
+        return true;
+    case op_mod:
+        lhs->value_double = fmod(lhs->value_double, rhs->value_double);
+        return true;
+    case op_eq:
+    case op_ne: // same as op_eq at run time, identical memory is equal
+        yes = memcmp(&(lhs->value_double), &(rhs->value_double), sizeof(double)) == 0 || lhs->value_double == rhs->value_double;
+        yes = opcode == op_eq ? yes : !yes;
+        break;
+    case op_lt:
+        yes = lhs->value_double < rhs->value_double;
+        break;
+    case op_le:
+        yes = lhs->value_double <= rhs->value_double;
+        break;
+    case op_gt:
+        yes = lhs->value_double > rhs->value_double;
+        break;
+    case op_ge:
+        yes = lhs->value_double >= rhs->value_double;
+        break;
+    default:
+        return false;
+    }
+    lhs->type = opd_boolean;
+    lhs->value_bool = yes;
+    return true;
+}
+
+// targets referenced only by removed instructions are released, so that more code can be merged or found unreachable
+static void _peephole_mark_targets(struct _peephole_instruction *base, uint32_t length, uint32_t begin, uint32_t end) {
+    uint32_t *address, index;
+    for (uint32_t i = 0; i < length; i++) {
+        base[i].is_target = false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        if (!base[i].is_removed) {
+            for (uint8_t j = 0; j < base[i].instruction.num_operands; j++) {
+                if ((address = _peephole_address(&(base[i].instruction), j)) != NULL && *address >= begin && *address < end) {
+                    index = _peephole_next(base, length, _peephole_find(base, length, *address));
+                    if (index < length) {
+                        base[index].is_target = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static bool _peephole_pass(struct _peephole_instruction *base, uint32_t length, uint32_t begin, uint32_t end, uint8_t level) {
+    bool changed = false;
+    _peephole_mark_targets(base, length, begin, end);
+    for (uint32_t i = _peephole_next(base, length, 0); i < length; i = _peephole_next(base, length, i + 1)) {
+        struct _instruction *instruction = &(base[i].instruction);
+        uint32_t prev = _peephole_prev(base, i);
+        uint32_t prev2 = prev == UINT32_MAX ? UINT32_MAX : _peephole_prev(base, prev);
+        uint32_t next = _peephole_next(base, length, i + 1);
+        uint32_t address;
+        switch (instruction->opcode) {
+        case op_nop: // such as elided block
+            _peephole_remove(base, length, i);
+            changed = true;
+            continue;
+        case op_add:
+        case op_sub:
+        case op_mul:
+        case op_pow:
+        case op_div:
+        case op_mod:
+        case op_eq:
+        case op_ne:
+        case op_lt:
+        case op_le:
+        case op_gt:
+        case op_ge:
+            if (!base[i].is_target && prev != UINT32_MAX && !base[prev].is_target && (_peephole_is_constant(base, prev2, opd_double) || _peephole_is_constant(base, prev2, opd_boolean)) && (_peephole_is_constant(base, prev, opd_double) || _peephole_is_constant(base, prev, opd_boolean)) && _peephole_fold(base[prev2].instruction.operands + 1, base[prev].instruction.operands + 1, instruction->opcode)) {
+                _peephole_remove(base, length, prev);
+                _peephole_remove(base, length, i);
+                changed = true;
+                continue;
+            }
+            break;
+        case op_not:
+            if (!base[i].is_target && _peephole_is_constant(base, prev, opd_boolean)) {
+                base[prev].instruction.operands[1].value_bool = !base[prev].instruction.operands[1].value_bool;
+                _peephole_remove(base, length, i);
+                changed = true;
+                continue;
+            }
+            break;
+        case op_jump_if_false:
+        case op_jump_if_true:
+            if (!base[i].is_target && _peephole_is_constant(base, prev, opd_boolean)) { // condition is popped either way
+                if (base[prev].instruction.operands[1].value_bool == (instruction->opcode == op_jump_if_true)) {
+                    instruction->opcode = op_jump;
+                } else {
+                    _peephole_remove(base, length, i);
+                }
+                _peephole_remove(base, length, prev);
+                changed = true;
+                continue;
+            }
+            // if (c) jump over next unconditional jump, inverts to one jump
+            if (level >= 2 && next < length && !base[next].is_target && base[next].instruction.opcode == op_jump && _peephole_next(base, length, _peephole_find(base, length, _peephole_resolve(base, length, begin, end, instruction->operands[0].value_uint32, op_jump))) == _peephole_next(base, length, next + 1)) {
+                instruction->opcode = instruction->opcode == op_jump_if_false ? op_jump_if_true : op_jump_if_false;
+                instruction->operands[0].value_uint32 = base[next].instruction.operands[0].value_uint32;
+                _peephole_remove(base, length, next);
+                changed = true;
+                continue;
+            }
+            break;
+        case op_compare_jump:
+            if (!base[i].is_target && prev != UINT32_MAX && !base[prev].is_target && (_peephole_is_constant(base, prev2, opd_double) || _peephole_is_constant(base, prev2, opd_boolean)) && (_peephole_is_constant(base, prev, opd_double) || _peephole_is_constant(base, prev, opd_boolean))) {
+                struct _operand operand = base[prev2].instruction.operands[1];
+                if (_peephole_fold(&operand, base[prev].instruction.operands + 1, instruction->operands[1].value_uint8)) {
+                    if (operand.value_bool) {
+                        _peephole_remove(base, length, i);
+                    } else {
+                        instruction->opcode = op_jump;
+                        instruction->num_operands = 1;
+                    }
+                    _peephole_remove(base, length, prev2);
+                    _peephole_remove(base, length, prev);
+                    changed = true;
+                    continue;
+                }
+            }
+            break;
+        case op_and:
+        case op_or:
+            if (!base[i].is_target && _peephole_is_constant(base, prev, opd_boolean)) {
+                if (instruction->num_operands == 0) { // last operand, only checks type
+                    _peephole_remove(base, length, i);
+                } else if (base[prev].instruction.operands[1].value_bool == (instruction->opcode == op_or)) { // decided, constant is result
+                    instruction->opcode = op_jump;
+                } else {
+                    _peephole_remove(base, length, prev);
+                    _peephole_remove(base, length, i);
+                }
+                changed = true;
+                continue;
+            }
+            break;
+        case op_stack_pop:
+            if (level >= 2 && !base[i].is_target && prev != UINT32_MAX) {
+                if (base[prev].instruction.opcode == op_stack_pop && base[prev].instruction.operands[0].value_uint8 + instruction->operands[0].value_uint8 <= UINT8_MAX) {
+                    base[prev].instruction.operands[0].value_uint8 += instruction->operands[0].value_uint8;
+                    _peephole_remove(base, length, i);
+                    changed = true;
+                    continue;
+                }
+                if (base[prev].instruction.opcode == op_stack_push && base[prev].instruction.operands[0].value_uint8 == sf_value) { // unused value
+                    _peephole_remove(base, length, prev);
+                    if (--instruction->operands[0].value_uint8 == 0) {
+                        _peephole_remove(base, length, i);
+                    }
+                    changed = true;
+                    continue;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        // jump threading
+        if (instruction->opcode == op_compare_jump || (instruction->num_operands == 1 && (instruction->opcode == op_jump || instruction->opcode == op_jump_if_false || instruction->opcode == op_jump_if_true || instruction->opcode == op_and || instruction->opcode == op_or))) {
+            address = _peephole_resolve(base, length, begin, end, instruction->operands[0].value_uint32, instruction->opcode == op_and || instruction->opcode == op_or ? instruction->opcode : op_jump);
+            if (address != instruction->operands[0].value_uint32) {
+                instruction->operands[0].value_uint32 = address;
+                changed = true;
+            }
+            if (instruction->opcode == op_jump) {
+                uint32_t target = _peephole_next(base, length, _peephole_find(base, length, address));
+                if (target == next) { // to next instruction
+                    _peephole_remove(base, length, i);
+                    changed = true;
+                    continue;
+                }
+                if (target < length && base[target].instruction.opcode == op_return) {
+                    instruction->opcode = op_return;
+                    instruction->num_operands = 0;
+                    changed = true;
+                }
+            }
+        }
+        // unreachable until next jump target
+        if (level >= 2 && (instruction->opcode == op_jump || instruction->opcode == op_return || instruction->opcode == op_throw || instruction->opcode == op_break || instruction->opcode == op_continue)) {
+            for (; next < length && !base[next].is_target; next = _peephole_next(base, length, next + 1)) {
+                _peephole_remove(base, length, next);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+// rewrite bytecode from begin to end, which is newly compiled, level 1 folds constants, threads jumps and removes nops, level 2 also removes unreachable code and fuses sequences
+// cross reference is kept consistent, line whose instructions are all removed points to previous remaining one
+void js_optimize(struct js_bytecode *bytecode, struct js_cross_reference *xref, uint32_t begin, uint8_t level) {
+    struct {
+        struct _peephole_instruction *base;
+        uint32_t length;
+        uint32_t capacity;
+    } unit = {0};
+    struct js_bytecode optimized = {0};
+    uint32_t offset = begin, end = bytecode->length, new_offset = 0, index, *address;
+    if (level == 0 || begin >= end) {
+        return;
+    }
+    for (;;) {
+        struct _peephole_instruction entry = {.offset = offset};
+        if (!_get_instruction(bytecode, &offset, &(entry.instruction))) {
+            break;
+        }
+        buffer_push(unit.base, unit.length, unit.capacity, entry);
+    }
+    if (offset != end) { // broken, leave it to vm to report
+        buffer_free(unit.base, unit.length, unit.capacity);
+        return;
+    }
+    while (_peephole_pass(unit.base, unit.length, begin, end, level)) {
+    }
+    // encode, addresses are translated afterwards because forward ones are not known yet
+    buffer_for_each(unit.base, unit.length, unit.capacity, i, entry, {
+        if (!entry->is_removed) {
+            entry->new_offset = new_offset;
+            _put_decoded_instruction(&optimized, &new_offset, &(entry->instruction), bytecode->base);
+        }
+    });
+    buffer_for_each(unit.base, unit.length, unit.capacity, i, entry, {
+        if (!entry->is_removed) {
+            for (uint8_t j = 0; j < entry->instruction.num_operands; j++) {
+                if ((address = _peephole_address(&(entry->instruction), j)) != NULL && *address >= begin && *address <= end) {
+                    index = _peephole_next(unit.base, unit.length, _peephole_find(unit.base, unit.length, *address));
+                    *address = begin + (index < unit.length ? unit.base[index].new_offset : optimized.length);
+                }
+            }
+            offset = entry->new_offset;
+            _put_decoded_instruction(&optimized, &offset, &(entry->instruction), bytecode->base);
+        }
+    });
+    // line of removed instructions points to previous remaining one, or before unit, so it won't be matched by errors inside unit
+    buffer_for_each(xref->base, xref->length, xref->capacity, line, position, {
+        if (*position >= begin && *position < end) {
+            index = _peephole_find(unit.base, unit.length, *position);
+            if (index < unit.length && unit.base[index].is_removed) {
+                index = _peephole_prev(unit.base, index);
+            }
+            if (index < unit.length) {
+                *position = begin + unit.base[index].new_offset;
+            } else {
+                *position = begin > 0 ? begin - 1 : 0;
+            }
+        }
+    });
+    buffer_alloc(bytecode->base, bytecode->length, bytecode->capacity, begin + optimized.length);
+    if (optimized.length > 0) {
+        memcpy(bytecode->base + begin, optimized.base, optimized.length);
+    }
+    bytecode->length = begin + optimized.length;
+    buffer_free(optimized.base, optimized.length, optimized.capacity);
+    buffer_free(unit.base, unit.length, unit.capacity);
+}
+
+// hit rates of member access sites which have been executed, by bytecode offset
+void js_member_cache_dump(struct js_vm *vm) {
+    uint64_t hits = 0, misses = 0;
+    printf("%10s  %-20s %12s %12s %7s\n", "offset", "opcode", "hits", "misses", "rate");
+    buffer_for_each(vm->decoded.base, vm->decoded.length, vm->decoded.capacity, i, instruction, {
+        switch (instruction->opcode) {
+        case op_member_get:
+        case op_member_get_const:
+        case op_member_put:
+        case op_member_update:
+        case op_object_optional: {
+            struct js_member_cache *cache = vm->decoded.member_caches.base + instruction->cache.member;
+            if (cache->hits + cache->misses > 0) {
+                printf("%10u  %-20s %12u %12u %6.2f%%\n", instruction->offset, _opcode_names[instruction->opcode], cache->hits, cache->misses, 100.0 * cache->hits / ((double)cache->hits + cache->misses));
+                hits += cache->hits;
+                misses += cache->misses;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    });
+    if (hits + misses > 0) {
+        printf("%10s  %-20s %12llu %12llu %6.2f%%\n", "total", "", (unsigned long long)hits, (unsigned long long)misses, 100.0 * hits / ((double)hits + misses));
+    }
+}
+
+// NULL if offset is not instruction boundary, or instruction has not been profiled
+struct js_type_feedback *js_type_feedback_at(struct js_vm *vm, uint32_t offset) {
+    uint32_t index;
+    if (offset >= vm->decoded.indices.length || (index = vm->decoded.indices.base[offset]) == UINT32_MAX || index >= vm->decoded.type_feedback.length || vm->decoded.type_feedback.base[index].count == 0) {
+        return NULL;
+    }
+    return vm->decoded.type_feedback.base + index;
+}
+
+static void _type_mask_dump(const char *name, uint16_t mask) {
+    const char *separator = "";
+    if (mask == 0) {
+        return;
+    }
+    printf(" %s:", name);
+    for (uint8_t type = 0; type < countof(_value_type_names); type++) {
+        if (mask & (1 << type)) {
+            printf("%s%s", separator, _value_type_names[type] + 3); // without "vt_"
+            separator = "|";
+        }
+    }
+}
+
+// disassembly like js_bytecode_dump, profiled instructions are followed by what flowed through them
+void js_type_feedback_dump(struct js_vm *vm) {
+    struct _instruction instruction;
+    struct js_type_feedback *feedback;
+    const char *names[2];
+    for (uint32_t offset = 0, next_offset = 0; _get_instruction(&(vm->bytecode), &next_offset, &instruction); offset = next_offset) {
+        printf("%10u  ", offset);
+        _instruction_dump(vm->bytecode.base, &instruction);
+        printf("\n");
+        if ((feedback = js_type_feedback_at(vm, offset)) == NULL) {
+            continue;
+        }
+        switch (instruction.opcode) {
+        case op_member_get:
+        case op_member_get_const:
+        case op_member_put:
+        case op_member_update:
+        case op_object_optional:
+            names[0] = "container";
+            names[1] = "selector";
+            break;
+        case op_slot_update:
+        case op_slot_increment:
+        case op_slot_decrement:
+            names[0] = "slot";
+            names[1] = "value";
+            break;
+        default:
+            names[0] = "lhs";
+            names[1] = "rhs";
+            break;
+        }
+        printf("%10s  ; %u times", "", feedback->count);
+        _type_mask_dump(names[0], feedback->operands[0]);
+        _type_mask_dump(names[1], feedback->operands[1]);
+        for (uint8_t i = 0; i < js_type_feedback_targets && feedback->targets[i].type != 0; i++) {
+            if (feedback->targets[i].type == vt_function) {
+                printf(" function@%u", feedback->targets[i].ingress);
+            } else {
+                printf(" c_function@%p", feedback->targets[i].c_function);
+            }
+            printf(" x%u", feedback->targets[i].count);
+        }
+        if (feedback->megamorphic > 0) {
+            printf(" others x%u", feedback->megamorphic);
+        }
+        printf("\n");
+    };
+    printf("\n");
+}
+
+void js_dump_vm(struct js_vm *vm) {
+    struct print_stream out = {.type = file_stream, .fp = stdout};
+    printf("heap base=%p length=%zu capacity=%zu\n", vm->heap.base, vm->heap.length, vm->heap.capacity);
+    buffer_for_each(vm->heap.base, vm->heap.length, vm->heap.capacity, i, v, {
+        printf("    %zu. ", i);
+        js_serialize_managed_value(&out, todump_style, *v, 0);
+        printf("\n");
+    });
+    if (vm->heap.nursery) {
+        printf("nursery base=%p length=%zu capacity=%zu remembered=%zu\n", vm->heap.nursery->cells, vm->heap.nursery->length, vm->heap.nursery->capacity, vm->heap.nursery->remembered.length);
+        for (size_t i = 0; i < vm->heap.nursery->length; i++) {
+            printf("    %zu. ", i);
+            js_serialize_managed_value(&out, todump_style, vm->heap.nursery->cells + i, 0);
+            printf("\n");
+        }
+    }
+    // printf("globals base=%p length=%u capacity=%u\n", vm->globals.base, vm->globals.length, vm->globals.capacity);
+    // js_map_for_each(vm->globals.base, _, vm->globals.capacity, k, kl, v, {
+    //     printf("    %.*s = ", (int)kl, k);
+    //     js_serialize_value(&out, todump_style, v, 0);
+    //     printf("\n");
+    // });
+    printf("stack base=%p length=%u capacity=%u\n", vm->stack.base, vm->stack.length, vm->stack.capacity);
+    for (uint16_t depth = 0; depth < vm->stack.length; depth++) {
+        struct js_stack_frame *frame = vm->stack.base + depth;
+        printf("    %u: (%u)%s\n", depth, frame->type, _stack_frame_type_names[frame->type]);
+        printf("        eval_height: %u\n", frame->eval_height);
+        printf("        locals: base=%p length=%u capacity=%u\n", frame->locals.base, frame->locals.length, frame->locals.capacity);
+        js_map_for_each(frame->locals.base, _, frame->locals.capacity, k, kl, v, {
+            printf("            %.*s = ", (int)kl, k);
+            js_serialize_value(&out, todump_style, v, 0);
+            printf("\n");
+        });
+        printf("        eval_base: %u\n", frame->eval_base);
+        printf("        slots: base=%p length=%u\n", frame->slots.base, frame->slots.length);
+        buffer_for_each(frame->slots.base, frame->slots.length, _, i, slot, {
+            printf("            %u. %.*s = ", i, (int)slot->name_length, slot->name);
+            js_serialize_value(&out, todump_style, &(slot->value), 0);
+            printf("\n");
+        });
+        printf("        egress: %u\n", frame->egress);
+        if (frame->type == sf_function) {
+            printf("        function: %p ", frame->function);
+            if (frame->function != NULL) {
+                js_serialize_managed_value(&out, todump_style, frame->function, 0);
+            }
+            printf("\n");
+            printf("        arguments: base=%p length=%u index=%u\n", frame->arguments.base, frame->arguments.length, frame->arguments.index);
+            buffer_for_each(frame->arguments.base, frame->arguments.length, _, i, v, {
+                printf("            %u. ", i);
+                js_serialize_value(&out, todump_style, v, 0);
+                printf("\n");
+            });
+        } else {
+            printf("        ingress: %u\n", frame->ingress);
+        }
+    }
+    printf("eval_stack base=%p length=%u capacity=%u\n", vm->eval_stack.base, vm->eval_stack.length, vm->eval_stack.capacity);
+    buffer_for_each(vm->eval_stack.base, vm->eval_stack.length, vm->eval_stack.capacity, i, v, {
+        printf("    %u: ", i);
+        js_serialize_value(&out, todump_style, v, 0);
+        printf("\n");
+    });
+    printf("pc=%u\n", vm->pc);
+    printf("\n");
+}
+
+// reverse order, from top to down
+#define _call_stack_for_each(__arg_vm, __arg_frame, __arg_statement) \
+    do { \
+        /* DON'T use "for (uint16_t i = vm->stack.length - 1; i >= 0; i--)", \
+        because turn unsigned i into negative will result a huge positive value */ \
+        for (uint16_t i = 0; i < __arg_vm->stack.length; i++) { \
+            struct js_stack_frame *__arg_frame = __arg_vm->stack.base + __arg_vm->stack.length - 1 - i; \
+            __arg_statement; \
+        } \
+    } while (0)
+
+static struct js_stack_frame *_get_current_frame(struct js_vm *vm) { // NULL means globals
+    _call_stack_for_each(vm, frame, return frame);
+    return NULL;
+}
+
+// scope frame which compiler calls depth, count from top, values are skipped
+static struct js_stack_frame *_get_frame_at_depth(struct js_vm *vm, uint8_t depth) {
+    _call_stack_for_each(vm, frame, {
+        if (depth == 0) {
+            return frame;
+        }
+        depth--;
+    });
+    fatal("No scope frame at depth %u", depth);
+    return NULL;
+}
+
+// slots are only visible by name when declared, linear search is ok because there are not many in one scope
+static struct js_slot *_find_slot(struct js_stack_frame *frame, const char *name, uint16_t name_length) {
+    buffer_for_each(frame->slots.base, frame->slots.length, _, i, slot, {
+        if (slot->value.type != 0 && slot->name_length == name_length && memcmp(slot->name, name, name_length) == 0) {
+            return slot;
+        }
+    });
+    return NULL;
+}
+
+static struct js_result _declare_slot(struct js_vm *vm, uint16_t slot, const char *name, uint16_t name_length, struct js_value value) {
+    struct js_stack_frame *frame = _get_current_frame(vm);
+    enforce(frame != NULL);
+    if ((slot < frame->slots.length && frame->slots.base[slot].value.type != 0) || js_map_get(&(vm->heap), frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length).type != 0) {
+        js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" already exists", (int)name_length, name));
+    }
+    if (slot >= frame->slots.length) { // current frame is on top, so are its slots
+        uint32_t end = (uint32_t)(frame->slots.base - vm->slot_stack.base) + slot + 1;
+        enforce(end <= vm->slot_stack.capacity);
+        memset(frame->slots.base + frame->slots.length, 0, (slot + 1 - frame->slots.length) * sizeof(struct js_slot));
+        frame->slots.length = slot + 1;
+        vm->slot_stack.length = (uint16_t)end;
+    }
+    frame->slots.base[slot] = (struct js_slot){.value = value, .name = name, .name_length = name_length};
+    js_return(js_null());
+}
+
+// search variables visible to closure being created, innermost first until first function frame, then that function's closure
+static struct js_value _get_closure_candidate(struct js_vm *vm, const char *name, uint16_t name_length) {
+    struct js_slot *slot;
+    struct js_value ret;
+    _call_stack_for_each(vm, frame, {
+        if ((slot = _find_slot(frame, name, name_length)) != NULL) {
+            return slot->value;
+        }
+        if ((ret = js_map_get(&(vm->heap), frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length)).type != 0) {
+            return ret;
+        }
+        if (frame->type == sf_function) {
+            if (frame->function != NULL) {
+                return js_map_get(&(vm->heap), frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length);
+            }
+            break;
+        }
+    });
+    return (struct js_value){0};
+}
+
+// returns node only if alive, refreshes cache of global instructions
+static struct js_kv_pair *_get_global_node(struct js_vm *vm, struct js_instruction *instruction) {
+    if (instruction->cache.global.node == NULL || instruction->cache.global.version != vm->globals_version) {
+        struct js_kv_pair *node = js_map_get_atom_node(vm->globals.base, vm->globals.length, vm->globals.capacity, instruction->operands[0].value_string.atom);
+        instruction->cache.global.node = (node && node->value.type != 0) ? node : NULL;
+        instruction->cache.global.version = vm->globals_version;
+    }
+    return instruction->cache.global.node;
+}
+
+struct js_result js_declare_variable(struct js_vm *vm, const char *name, uint16_t name_length, struct js_value value) {
+    struct js_stack_frame *frame = _get_current_frame(vm);
+    struct js_variable_map *scope = frame ? &(frame->locals) : &(vm->globals);
+    if (js_map_get(&(vm->heap), scope->base, scope->length, scope->capacity, name, name_length).type != 0 || (frame && _find_slot(frame, name, name_length))) {
+        js_throw(js_string_f(&(vm->heap),
+            "Variable \"%.*s\" already exists", (int)name_length, name));
+    }
+    js_map_put_versioned(&(vm->heap), scope->base, scope->length, scope->capacity, name, name_length, value, frame ? NULL : &(vm->globals_version));
+    js_return(js_null());
+}
+
+struct js_result js_delete_variable(struct js_vm *vm, const char *name, uint16_t name_length) {
+    struct js_stack_frame *frame = _get_current_frame(vm);
+    struct js_variable_map *scope = frame ? &(frame->locals) : &(vm->globals);
+    struct js_slot *slot = frame ? _find_slot(frame, name, name_length) : NULL;
+    if (slot) {
+        slot->value = (struct js_value){0};
+        js_return(js_null());
+    }
+    if (js_map_get(&(vm->heap), scope->base, scope->length, scope->capacity, name, name_length).type == 0) {
+        js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" not found", (int)name_length, name));
+    }
+    js_map_put_versioned(&(vm->heap), scope->base, scope->length, scope->capacity, name, name_length, (struct js_value){0}, frame ? NULL : &(vm->globals_version));
+    js_return(js_null());
+}
+
+struct js_result js_put_variable(struct js_vm *vm, const char *name, uint16_t name_length, struct js_value value) {
+    // first, check current stack variables
+    // second, check current stack closure if is function
+    // there may be multiple nested functions, so each stack should check closure
+    struct js_slot *slot;
+    _call_stack_for_each(vm, frame, {
+        if ((slot = _find_slot(frame, name, name_length)) != NULL) {
+            slot->value = value;
+            js_return(js_null());
+        }
+        if (js_map_get(&(vm->heap), frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length).type != 0) {
+            js_map_put(&(vm->heap), frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length, value);
+            js_return(js_null());
+        }
+        if (frame->type == sf_function && frame->function != NULL) {
+            if (js_map_get(&(vm->heap), frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length).type != 0) {
+                js_write_barrier(&(vm->heap), frame->function, value);
+                js_map_put(&(vm->heap), frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length, value);
+                js_return(js_null());
+            }
+        }
+    });
+    // at last, check globals
+    if (js_map_get(&(vm->heap), vm->globals.base, vm->globals.length, vm->globals.capacity, name, name_length).type != 0) {
+        js_map_put_versioned(&(vm->heap), vm->globals.base, vm->globals.length, vm->globals.capacity, name, name_length, value, &(vm->globals_version));
+        js_return(js_null());
+    }
+    js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" not found", (int)name_length, name));
+}
+
+struct js_result js_get_variable(struct js_vm *vm, const char *name, uint16_t name_length) {
+    // first, check current stack variables
+    // second, check current stack closure if is function
+    // there may be multiple nested functions, so each stack should check closure
+    struct js_value ret;
+    struct js_slot *slot;
+    _call_stack_for_each(vm, frame, {
+        if ((slot = _find_slot(frame, name, name_length)) != NULL) {
+            js_return(js_normalize(slot->value));
+        }
+        ret = js_map_get(&(vm->heap), frame->locals.base, frame->locals.length, frame->locals.capacity, name, name_length);
+        if (ret.type != 0) {
+            js_return(ret);
+        }
+        if (frame->type == sf_function && frame->function != NULL) {
+            ret = js_map_get(&(vm->heap), frame->function->function.closure.base, frame->function->function.closure.length, frame->function->function.closure.capacity, name, name_length);
+            if (ret.type != 0) {
+                js_return(ret);
+            }
+        }
+    });
+    // at last, check globals
+    ret = js_map_get(&(vm->heap), vm->globals.base, vm->globals.length, vm->globals.capacity, name, name_length);
+    if (ret.type != 0) {
+        js_return(ret);
+    }
+    js_throw(js_string_f(&(vm->heap), "Variable \"%.*s\" not found", (int)name_length, name));
+}
+
+// maximum power of 2 which uint16_t capacity can reach, see buffer_alloc
+#define _max_stack_capacity 32768
+
+static void _stack_reserve(struct js_vm *vm) {
+    if (vm->eval_stack.base == NULL) {
+        vm->eval_stack.base = alloc(struct js_value, _max_stack_capacity);
+        enforce(vm->eval_stack.base != NULL);
+        vm->eval_stack.capacity = _max_stack_capacity;
+    }
+    if (vm->slot_stack.base == NULL) {
+        vm->slot_stack.base = alloc(struct js_slot, _max_stack_capacity);
+        enforce(vm->slot_stack.base != NULL);
+        vm->slot_stack.capacity = _max_stack_capacity;
+    }
+}
+
+static void _stack_push(struct js_vm *vm, struct js_stack_frame frame) {
+    // compound literal which contains comma can not be used inside macro
+    // https://stackoverflow.com/questions/5558159/compound-literals-and-function-like-macros-bug-in-gcc-or-the-c-standard
+    // finally it can, just surround with extra parentheses
+    // such as: ((struct foo){.a = 1, .b = 2, .c = 3})
+    frame.eval_height = vm->eval_stack.length;
+    frame.eval_base = vm->eval_stack.length;
+    frame.slots.base = vm->slot_stack.base + vm->slot_stack.length;
+    buffer_push(vm->stack.base, vm->stack.length, vm->stack.capacity, frame);
+}
+
+static struct js_stack_frame *_stack_peek(struct js_vm *vm, uint16_t depth) { // frame, depth from 0 (top) to length-1 (bottom)
+    // js_dump_vm(vm);
+    // js_bytecode_dump(&(vm->bytecode));
+    enforce(vm->stack.length > depth);
+    return vm->stack.base + vm->stack.length - 1 - depth;
+}
+
+// remove frames from index to top, and values pushed after frame at index
+static void _stack_cut(struct js_vm *vm, uint16_t index) {
+    if (index < vm->stack.length) {
+        vm->eval_stack.length = vm->stack.base[index].eval_height;
+        vm->slot_stack.length = (uint16_t)(vm->stack.base[index].slots.base - vm->slot_stack.base);
+        for (uint16_t i = index; i < vm->stack.length; i++) {
+            js_map_free(vm->stack.base[i].locals.base, vm->stack.base[i].locals.length, vm->stack.base[i].locals.capacity);
+        }
+        vm->stack.length = index;
+    }
+}
+
+// whether latest pushed thing is value rather than frame
+static bool _stack_is_value_on_top(struct js_vm *vm) {
+    return vm->eval_stack.length > (vm->stack.length > 0 ? vm->stack.base[vm->stack.length - 1].eval_base : 0);
+}
+
+// pop values and frames in reverse order of pushing, as if they are in one stack, count is generated by compiler
+static void _stack_pop(struct js_vm *vm, uint16_t count) {
+    for (; count > 0; count--) {
+        if (_stack_is_value_on_top(vm)) {
+            vm->eval_stack.length--;
+        } else {
+            enforce(vm->stack.length > 0);
+            _stack_cut(vm, vm->stack.length - 1);
+        }
+    }
+}
+
+// keep frame of type on top, remove everything above, or remove all if not found
+static void _stack_pop_to(struct js_vm *vm, enum js_stack_frame_type type) {
+    uint16_t index = vm->stack.length;
+    for (; index > 0 && vm->stack.base[index - 1].type != type; index--) {
+    }
+    _stack_cut(vm, index);
+    vm->eval_stack.length = index > 0 ? vm->stack.base[index - 1].eval_base : 0;
+}
+
+// values pushed above function frame become its arguments, callee is just below the frame
+static void _stack_bind_arguments(struct js_vm *vm, struct js_stack_frame *frame) {
+    frame->arguments.base = vm->eval_stack.base + frame->eval_height;
+    frame->arguments.length = vm->eval_stack.length - frame->eval_height;
+    frame->arguments.index = 0;
+    frame->eval_base = vm->eval_stack.length;
+}
+
+// for 'return f(...)', callee takes over caller's sf_function frame, so recursion in tail position uses constant stack
+// not possible if callee is c function, or there is no caller function (global 'return'), or sf_try between must catch callee's error
+static bool _stack_reuse_frame(struct js_vm *vm) {
+    struct js_stack_frame *callee_frame = _stack_peek(vm, 0), *caller_frame;
+    struct js_value callee;
+    uint16_t index, num_arguments;
+    enforce(callee_frame->type == sf_function && callee_frame->eval_height > 0);
+    callee = vm->eval_stack.base[callee_frame->eval_height - 1];
+    if (callee.type != vt_function) {
+        return false;
+    }
+    for (index = vm->stack.length - 1; index > 0 && vm->stack.base[index - 1].type != sf_function; index--) {
+        if (vm->stack.base[index - 1].type == sf_try || vm->stack.base[index - 1].slots.length > 0 || vm->stack.base[index - 1].locals.length > 0) {
+            return false;
+        }
+    }
+    if (index == 0) {
+        return false;
+    }
+    caller_frame = vm->stack.base + index - 1;
+    // callee may look names up in caller's frame, unless it is same function, whose parameters shadow caller's, compiler ensures there are no other locals
+    if (caller_frame->locals.length > 0) {
+        return false;
+    }
+    if (caller_frame->function != callee.managed && (caller_frame->slots.length > 0 || (caller_frame->function != NULL && caller_frame->function->function.closure.length > 0))) {
+        return false;
+    }
+    // move callee and arguments down to where caller's are
+    num_arguments = vm->eval_stack.length - callee_frame->eval_height;
+    vm->eval_stack.base[caller_frame->eval_height - 1] = callee;
+    memmove(vm->eval_stack.base + caller_frame->eval_height, vm->eval_stack.base + callee_frame->eval_height, num_arguments * sizeof(struct js_value));
+    _stack_cut(vm, index);
+    // then clear caller's own variables
+    js_map_free(caller_frame->locals.base, caller_frame->locals.length, caller_frame->locals.capacity);
+    vm->slot_stack.length = (uint16_t)(caller_frame->slots.base - vm->slot_stack.base);
+    caller_frame->slots.length = 0;
+    vm->eval_stack.length = caller_frame->eval_height + num_arguments;
+    caller_frame->function = callee.managed; // egress is kept, callee returns to where caller should
+    _stack_bind_arguments(vm, caller_frame);
+    return true;
+}
+
+static void _stack_push_value(struct js_vm *vm, struct js_value value) {
+    enforce(vm->eval_stack.length < vm->eval_stack.capacity);
+    vm->eval_stack.base[vm->eval_stack.length++] = value;
+}
+
+static struct js_value _stack_peek_value(struct js_vm *vm, uint16_t depth) { // depth from 0 (top) to length-1 (bottom)
+    enforce(vm->eval_stack.length > depth);
+    return vm->eval_stack.base[vm->eval_stack.length - 1 - depth];
+}
+
+static struct js_value _stack_pop_value(struct js_vm *vm) {
+    enforce(vm->eval_stack.length > 0);
+    return vm->eval_stack.base[--vm->eval_stack.length];
+}
+
+static void _stack_swap(struct js_vm *vm, uint16_t depth_1, uint16_t depth_2) {
+    enforce(vm->eval_stack.length > depth_1);
+    enforce(vm->eval_stack.length > depth_2);
+    struct js_value swap = vm->eval_stack.base[vm->eval_stack.length - 1 - depth_1];
+    vm->eval_stack.base[vm->eval_stack.length - 1 - depth_1] = vm->eval_stack.base[vm->eval_stack.length - 1 - depth_2];
+    vm->eval_stack.base[vm->eval_stack.length - 1 - depth_2] = swap;
+}
+
+// same results as before vt_integer was added, vt_integer is reported as number
+static const char *const _typeof_table[] = {
+    [vt_undefined] = "undefined",
+    [vt_null] = "null",
+    [vt_boolean] = "boolean",
+    [vt_number] = "number",
+    [vt_integer] = "number",
+    [vt_scripture] = "string",
+    [vt_string] = "string",
+    [vt_array] = "string",
+    [vt_object] = "array",
+    [vt_function] = "object",
+    [vt_c_function] = "function",
+    [vt_c_data] = "function",
+};
+
+static struct js_value _get_argument(struct js_vm *vm, uint16_t index) {
+    struct js_stack_frame *frame = _stack_peek(vm, 0);
+    enforce(frame->type == sf_function);
+    if (index < frame->arguments.length) {
+        return frame->arguments.base[index];
+    } else {
+        return js_null();
+    }
+}
+
+static struct js_value js_error(struct js_vm *vm, uint32_t curr_offset, struct js_value message) {
+    // see https://developer.mozilla.org/zh-CN/docs/Web/JavaScript/Reference/Global_Objects/Error
+    /*
+        A special case:
+
+        //...
+        //...
+        //...
+        throw greetings;
+
+        throws variable not found error at curr_offset=0, but there are many lines corresponding to offset 0, because these 0 are array holes during buffer_put, so line will wrongly break at first 0;
+    */
+    if (vm->cross_reference.base) {
+        struct js_value error = js_object(&(vm->heap));
+        js_put_object_value_sz(&(vm->heap), &error, "message", message);
+        // for (uint32_t line = 0; line < vm->cross_reference.length; line++) {
+        //     log_debug("line=%lu, offset=%lu, curr_offset=%lu", line, vm->cross_reference.base[line], curr_offset);
+        // }
+        for (uint32_t line = 0; line < vm->cross_reference.length; line++) {
+            uint32_t offset = vm->cross_reference.base[line];
+            if (curr_offset == 0 && offset == 0) {
+                continue;
+            }
+            if (curr_offset <= offset) {
+                // log_debug("line=%lu, break", line);
+                js_put_object_value_sz(&(vm->heap), &error, "line", js_number(line + 1));
+                break;
+            }
+        }
+        return error;
+    } else {
+        return message;
+    }
+}
+
+// returns false if result is not integral or overflows or is -0, then double arithmetic is used instead
+static bool _integer_arithmetic(uint8_t opcode, int64_t lhs, int64_t rhs, int32_t *result) {
+    int64_t n;
+    switch (opcode) {
+    case op_add:
+        n = lhs + rhs;
+        break;
+    case op_sub:
+        n = lhs - rhs;
+        break;
+    case op_mul:
+        n = lhs * rhs;
+        if (n == 0 && (lhs < 0 || rhs < 0)) {
+            return false;
+        }
+        break;
+    case op_div:
+        if (rhs == 0 || lhs % rhs != 0 || (lhs == 0 && rhs < 0)) {
+            return false;
+        }
+        n = lhs / rhs;
+        break;
+    case op_mod: // sign follows lhs same as fmod
+        if (rhs == 0) {
+            return false;
+        }
+        n = lhs % rhs;
+        if (n == 0 && lhs < 0) {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+    if (n < INT32_MIN || n > INT32_MAX) {
+        return false;
+    }
+    *result = (int32_t)n;
+    return true;
+}
+
+// shared by arithmetic opcodes and fused updates
+static struct js_result _arithmetic(struct js_heap *heap, uint8_t opcode, struct js_value *lhs, struct js_value *rhs) {
+    int32_t integer;
+    if (lhs->type == vt_integer && rhs->type == vt_integer && _integer_arithmetic(opcode, lhs->integer, rhs->integer, &integer)) {
+        js_return(_integer(integer));
+    }
+    if (opcode == op_add) {
+        return js_add(heap, lhs, rhs);
+    }
+    if (!js_is_number(lhs) || !js_is_number(rhs)) {
+        js_throw(js_scripture_sz(heap, "Arithmatic operand must be number"));
+    }
+    switch (opcode) {
+    case op_sub:
+        js_return(js_number(js_get_number(lhs) - js_get_number(rhs)));
+    case op_mul:
+        js_return(js_number(js_get_number(lhs) * js_get_number(rhs)));
+    case op_pow:
+        js_return(js_number(pow(js_get_number(lhs), js_get_number(rhs))));
+    case op_div:
+        js_return(js_number(js_get_number(lhs) / js_get_number(rhs)));
+    case op_mod:
+        js_return(js_number(fmod(js_get_number(lhs), js_get_number(rhs))));
+    default:
+        fatal("Not arithmetic opcode %u", opcode);
+        js_return(js_null());
+    }
+}
+
+// shared by equality and relational opcodes and op_compare_jump, result is boolean
+static struct js_result _compare(struct js_heap *heap, uint8_t opcode, struct js_value *lhs, struct js_value *rhs) {
+    bool yes;
+    int order;
+    if (opcode == op_eq || opcode == op_ne) {
+        if (js_is_identical(lhs, rhs)) {
+            yes = true;
+        } else if (js_is_number(lhs) && js_is_number(rhs)) {
+            yes = js_get_number(lhs) == js_get_number(rhs);
+        } else if (lhs->type == vt_scripture && rhs->type == vt_scripture) {
+            yes = false; // different atoms always have different content
+        } else if (js_is_string(lhs) && js_is_string(rhs)) {
+            yes = js_compare_string(lhs, rhs) == 0;
+        } else {
+            yes = false;
+        }
+        js_return(js_boolean(opcode == op_eq ? yes : !yes));
+    }
+    if (lhs->type == vt_integer && rhs->type == vt_integer) {
+        switch (opcode) {
+        case op_lt:
+            js_return(js_boolean(lhs->integer < rhs->integer));
+        case op_le:
+            js_return(js_boolean(lhs->integer <= rhs->integer));
+        case op_gt:
+            js_return(js_boolean(lhs->integer > rhs->integer));
+        case op_ge:
+            js_return(js_boolean(lhs->integer >= rhs->integer));
+        default:
+            break;
+        }
+    } else if (js_is_number(lhs) && js_is_number(rhs)) {
+        switch (opcode) {
+        case op_lt:
+            js_return(js_boolean(js_get_number(lhs) < js_get_number(rhs)));
+        case op_le:
+            js_return(js_boolean(js_get_number(lhs) <= js_get_number(rhs)));
+        case op_gt:
+            js_return(js_boolean(js_get_number(lhs) > js_get_number(rhs)));
+        case op_ge:
+            js_return(js_boolean(js_get_number(lhs) >= js_get_number(rhs)));
+        default:
+            break;
+        }
+    } else if (js_is_string(lhs) && js_is_string(rhs)) {
+        order = js_compare_string(lhs, rhs);
+        switch (opcode) {
+        case op_lt:
+            js_return(js_boolean(order < 0));
+        case op_le:
+            js_return(js_boolean(order <= 0));
+        case op_gt:
+            js_return(js_boolean(order > 0));
+        case op_ge:
+            js_return(js_boolean(order >= 0));
+        default:
+            break;
+        }
+    } else {
+        js_throw(js_scripture_sz(heap, "Relational operand must be number or string"));
+    }
+    fatal("Not relational opcode %u", opcode);
+    js_return(js_null());
+}
+
+static struct js_result _member_get(struct js_heap *heap, struct js_value *container, struct js_value *selector) {
+    size_t index;
+    if (container->type == vt_array && selector->type == vt_integer) { // no need to validate
+        js_return(selector->integer < 0 ? js_null() : js_get_array_element(container, (size_t)selector->integer));
+    } else if (container->type == vt_array && selector->type == vt_number) {
+        if (selector->number < 0) {
+            js_return(js_null());
+        }
+        index = (size_t)selector->number;
+        if (index != selector->number) {
+            // js_throw(js_scripture_sz("Invalid array index, must be positive integer"));
+            js_return(js_null());
+        }
+        js_return(js_get_array_element(container, index));
+    } else if (container->type == vt_object && selector->type == vt_scripture) {
+        js_return(js_get_object_atom(container, js_atom_of(selector->scripture.base)));
+    } else if (container->type == vt_object && js_is_string(selector)) {
+        js_return(js_get_object_value(heap, container, js_get_string_base(selector), (uint16_t)js_get_string_length(selector)));
+    } else {
+        js_throw(js_scripture_sz(heap, "Must be array[number] or object[string]"));
+    }
+}
+
+static struct js_result _member_put(struct js_heap *heap, struct js_value *container, struct js_value *selector, struct js_value value) {
+    size_t index;
+    if (container->type == vt_array && selector->type == vt_integer) {
+        if (selector->integer < 0) {
+            js_throw(js_scripture_sz(heap, "Invalid array index, must be positive integer"));
+        }
+        js_put_array_element(heap, container, (size_t)selector->integer, value);
+    } else if (container->type == vt_array && selector->type == vt_number) {
+        index = (size_t)selector->number;
+        if (index != selector->number) {
+            js_throw(js_scripture_sz(heap, "Invalid array index, must be positive integer"));
+        }
+        js_put_array_element(heap, container, index, value);
+    } else if (container->type == vt_object && selector->type == vt_scripture) {
+        js_put_object_atom(heap, container, js_atom_of(selector->scripture.base), value);
+    } else if (container->type == vt_object && js_is_string(selector)) {
+        js_put_object_value(heap, container, js_get_string_base(selector), (uint16_t)js_get_string_length(selector), value);
+    } else {
+        js_throw(js_scripture_sz(heap, "Must be array[number] or object[string]"));
+    }
+    js_return(js_null());
+}
+
+// returns value holding atom, or NULL if not exists, value may be empty if deleted from dictionary
+static struct js_value *_member_cache_lookup(struct js_member_cache *cache, struct js_managed_value *object, struct js_atom *atom) {
+    struct js_shape *shape = object->object.shape;
+    struct js_kv_pair *node;
+    uint32_t slot;
+    for (uint8_t i = 0; i < cache->length; i++) {
+        if (cache->entries[i].atom == atom && cache->entries[i].shape == shape) {
+            if (shape) {
+                cache->hits++;
+                return object->object.slots + cache->entries[i].slot;
+            } else if (cache->entries[i].capacity == object->object.capacity) {
+                node = object->object.base + cache->entries[i].slot;
+                if (node->key.base == atom->base) {
+                    cache->hits++;
+                    return &(node->value);
+                }
+            }
+        }
+    }
+    cache->misses++;
+    if (shape) {
+        int32_t index = js_shape_find(shape, atom);
+        if (index < 0) {
+            return NULL;
+        }
+        slot = (uint32_t)index;
+    } else {
+        node = js_map_get_atom_node(object->object.base, object->object.length, object->object.capacity, atom);
+        if (node == NULL) {
+            return NULL;
+        }
+        slot = (uint32_t)(node - object->object.base);
+    }
+    uint8_t i = cache->length < _member_cache_ways ? cache->length++ : (cache->next++) % _member_cache_ways;
+    cache->entries[i].atom = atom;
+    cache->entries[i].shape = shape;
+    cache->entries[i].capacity = (uint32_t)object->object.capacity;
+    cache->entries[i].slot = slot;
+    return shape ? object->object.slots + slot : &(node->value);
+}
+
+static struct js_value _member_cache_get(struct js_member_cache *cache, struct js_value *container, struct js_atom *atom) {
+    struct js_value *value = _member_cache_lookup(cache, container->managed, atom);
+    return value && value->type != 0 ? *value : js_null();
+}
+
+// only replacing live value is done in place, adding and deleting change layout so let object do it
+static void _member_cache_put(struct js_heap *heap, struct js_member_cache *cache, struct js_value *container, struct js_atom *atom, struct js_value value) {
+    struct js_value *old = _member_cache_lookup(cache, container->managed, atom);
+    if (old && old->type != 0 && value.type != vt_null && value.type != vt_undefined) {
+        js_write_barrier(heap, container->managed, value);
+        *old = js_normalize(value);
+    } else {
+        js_put_object_atom(heap, container, atom, value);
+    }
+}
+
+static struct js_result _member_get_cached(struct js_heap *heap, struct js_member_cache *cache, struct js_value *container, struct js_value *selector) {
+    if (container->type == vt_object && selector->type == vt_scripture) {
+        js_return(_member_cache_get(cache, container, js_atom_of(selector->scripture.base)));
+    }
+    if (container->type == vt_object) { // arrays are not cached, not counted
+        cache->misses++;
+    }
+    return _member_get(heap, container, selector);
+}
+
+static struct js_result _member_put_cached(struct js_heap *heap, struct js_member_cache *cache, struct js_value *container, struct js_value *selector, struct js_value value) {
+    if (container->type == vt_object && selector->type == vt_scripture) {
+        _member_cache_put(heap, cache, container, js_atom_of(selector->scripture.base), value);
+        js_return(js_null());
+    }
+    if (container->type == vt_object) {
+        cache->misses++;
+    }
+    return _member_put(heap, container, selector, value);
+}
+
+// op_for_in_next and op_for_of_next, loop number is on stack top and container below it
+// pushes next loop number, then key or value if found, result is whether found
+static struct js_result _for_next(struct js_vm *vm, uint8_t opcode) {
+    struct js_value value = _stack_pop_value(vm);
+    double number = js_get_number(&value); // loop number, negative if object started in shape mode
+    size_t index = number > 0 ? (size_t)number : 0;
+    struct js_value container = _stack_peek_value(vm, 0); // array/object to be looped
+    bool yes = false; // whether success
+    if (container.type == vt_array) {
+        for (; index < container.managed->array.length; index++) {
+            value = container.managed->array.base[index];
+            if (value.type != vt_undefined && value.type != vt_null) {
+                if (opcode == op_for_in_next) {
+                    value = index <= INT32_MAX ? _integer((int32_t)index) : js_number((double)index);
+                }
+                yes = true;
+                break;
+            }
+        }
+        number = (double)(index + 1);
+    } else if (container.type == vt_object && (container.managed->object.shape || number < 0)) {
+        // negative loop number tells shape id and next slot, so that order is kept after falling back to dictionary mode, where slot number means hash index
+        // shape mode object only adds keys, its following shape has same keys before
+        struct js_shape *shape = container.managed->object.shape;
+        if (number < 0) {
+            index = (size_t)(-number) - 1;
+            if (shape == NULL) {
+                shape = vm->heap.shapes.base[index / (js_shape_max_length + 1)];
+            }
+            index %= js_shape_max_length + 1;
+        }
+        for (; index < shape->length; index++) {
+            if (container.managed->object.shape) {
+                value = container.managed->object.slots[index];
+            } else if ((value = js_get_object_atom(&container, shape->keys[index])).type == vt_null) { // deleted
+                continue;
+            }
+            if (opcode == op_for_in_next) {
+                value = js_scripture_atom(shape->keys[index]);
+            }
+            yes = true;
+            break;
+        }
+        number = -(double)((size_t)shape->id * (js_shape_max_length + 1) + index + yes) - 1;
+    } else if (container.type == vt_object) {
+        // js_value_map_dump(value->value.object->p, value->value.object->len, value->value.object->cap);
+        for (; index < container.managed->object.capacity; index++) {
+            struct js_kv_pair *kv = container.managed->object.base + index;
+            if (kv->key.base != NULL && kv->value.type != vt_undefined && kv->value.type != vt_null) {
+                // printf("index = %llu\index", index);
+                if (opcode == op_for_in_next) {
+                    value = js_scripture_atom(js_atom_of(kv->key.base)); // key is atom, no allocation
+                } else {
+                    value = kv->value;
+                }
+                yes = true;
+                break;
+            }
+        }
+        number = (double)(index + 1);
+    } else {
+        js_throw(js_scripture_sz(&(vm->heap), "'for in/of' operand must be array or object"));
+    }
+    _stack_push_value(vm, js_number(number)); // write back loop number
+    if (yes) {
+        _stack_push_value(vm, value);
+    }
+    js_return(js_boolean(yes));
+}
+
+// for function looking up names at run time, copies every variable visible here like _get_closure_candidate searches, innermost first
+static void _closure_capture_all(struct js_vm *vm, struct js_managed_value *function) {
+#define __put_to_closure(__arg_name, __arg_name_length, __arg_value) \
+    do { \
+        if (((__arg_value).type != vt_function || (__arg_value).managed != function) && js_map_get(&(vm->heap), function->function.closure.base, function->function.closure.length, function->function.closure.capacity, __arg_name, __arg_name_length).type == 0) { \
+            js_write_barrier(&(vm->heap), function, __arg_value); \
+            js_map_put(&(vm->heap), function->function.closure.base, function->function.closure.length, function->function.closure.capacity, __arg_name, __arg_name_length, __arg_value); \
+        } \
+    } while (0)
+    _call_stack_for_each(vm, frame, {
+        buffer_for_each(frame->slots.base, frame->slots.length, _, i, slot, {
+            if (slot->value.type != 0) {
+                __put_to_closure(slot->name, slot->name_length, slot->value);
+            }
+        });
+        js_map_for_each(frame->locals.base, _, frame->locals.capacity, k, kl, v, __put_to_closure(k, kl, *v));
+        if (frame->type == sf_function) {
+            if (frame->function != NULL) {
+                js_map_for_each(frame->function->function.closure.base, _, frame->function->function.closure.capacity, k, kl, v, __put_to_closure(k, kl, *v));
+            }
+            break;
+        }
+    });
+#undef __put_to_closure
+}
+
+// no operand means function looks up names at run time, see _closure_capture_all
+static void _closure_capture(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_stack_frame *frame;
+    struct js_value container, value = {0};
+    struct _decoded_operand *name = instruction->operands + instruction->num_operands - 1;
+    if (instruction->num_operands == 0) {
+        container = _stack_peek_value(vm, 0);
+        enforce(container.type == vt_function);
+        _closure_capture_all(vm, container.managed);
+        return;
+    }
+    enforce(instruction->num_operands == 1 || instruction->num_operands == 3);
+    enforce(name->type == opd_string);
+    if (instruction->num_operands == 3) {
+        enforce(instruction->operands[0].type == opd_uint8);
+        enforce(instruction->operands[1].type == opd_uint16);
+        frame = _get_frame_at_depth(vm, instruction->operands[0].value_uint8);
+        if (instruction->operands[1].value_uint16 < frame->slots.length) {
+            value = frame->slots.base[instruction->operands[1].value_uint16].value;
+        }
+    }
+    if (value.type == 0) { // not declared yet or deleted, or declared by name
+        value = _get_closure_candidate(vm, name->value_string.base, (uint16_t)name->value_string.length);
+    }
+    if (value.type != 0) { // copy, same as before, modifications inside closure are stored in closure
+        container = _stack_peek_value(vm, 0);
+        enforce(container.type == vt_function);
+        js_write_barrier(&(vm->heap), container.managed, value);
+        js_map_put(&(vm->heap), container.managed->function.closure.base, container.managed->function.closure.length, container.managed->function.closure.capacity, name->value_string.base, name->value_string.length, value);
+    }
+}
+
+// types of values an instruction is about to consume, returns how many, shared by profiling and trace recording
+// binary operators: lhs, rhs. member access: container, selector, value. slot access: slot, value. conditional jumps: condition
+static uint8_t _operand_types(struct js_vm *vm, struct js_instruction *instruction, uint8_t types[3]) {
+    struct js_stack_frame *frame;
+    uint32_t slot;
+    switch (instruction->opcode) {
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_pow:
+    case op_div:
+    case op_mod:
+    case op_eq:
+    case op_ne:
+    case op_lt:
+    case op_le:
+    case op_gt:
+    case op_ge:
+    case op_compare_jump:
+    case op_member_get:
+    case op_object_optional:
+        types[0] = _stack_peek_value(vm, 1).type;
+        types[1] = _stack_peek_value(vm, 0).type;
+        return 2;
+    case op_member_get_const:
+    case op_jump_if_false:
+    case op_jump_if_true:
+        types[0] = _stack_peek_value(vm, 0).type;
+        return 1;
+    case op_member_put:
+    case op_member_update:
+        types[0] = _stack_peek_value(vm, 2).type;
+        types[1] = _stack_peek_value(vm, 1).type;
+        types[2] = _stack_peek_value(vm, 0).type;
+        return 3;
+    case op_slot_get:
+    case op_slot_put:
+    case op_slot_update:
+    case op_slot_increment:
+    case op_slot_decrement:
+        slot = instruction->opcode == op_slot_update ? instruction->operands[1].value_uint32 & UINT16_MAX : instruction->operands[1].value_uint16;
+        frame = _get_frame_at_depth(vm, instruction->operands[0].value_uint8);
+        types[0] = slot < frame->slots.length ? frame->slots.base[slot].value.type : vt_undefined; // undefined means not declared
+        if (instruction->opcode == op_slot_put || instruction->opcode == op_slot_update) {
+            types[1] = _stack_peek_value(vm, 0).type;
+            return 2;
+        }
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// records types of operands on eval stack and callee before instruction is executed, while profiling
+static void _profile(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_type_feedback *feedback;
+    struct js_stack_frame *frame;
+    struct js_value callee;
+    uint32_t index = (uint32_t)(instruction - vm->decoded.base);
+    uint8_t types[3], count, i;
+    switch (instruction->opcode) {
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_pow:
+    case op_div:
+    case op_mod:
+    case op_eq:
+    case op_ne:
+    case op_lt:
+    case op_le:
+    case op_gt:
+    case op_ge:
+    case op_compare_jump:
+    case op_member_get:
+    case op_member_get_const:
+    case op_member_put:
+    case op_member_update:
+    case op_object_optional:
+    case op_slot_update:
+    case op_slot_increment:
+    case op_slot_decrement:
+    case op_call:
+    case op_tail_call:
+        break;
+    default:
+        return;
+    }
+    if (index >= vm->decoded.type_feedback.length) { // entries beyond length are always zeroed
+        buffer_alloc(vm->decoded.type_feedback.base, vm->decoded.type_feedback.length, vm->decoded.type_feedback.capacity, vm->decoded.length);
+        vm->decoded.type_feedback.length = vm->decoded.length;
+    }
+    feedback = vm->decoded.type_feedback.base + index;
+    feedback->count++;
+    if (instruction->opcode == op_call || instruction->opcode == op_tail_call) {
+        frame = _stack_peek(vm, 0);
+        enforce(frame->type == sf_function && frame->eval_height > 0);
+        callee = vm->eval_stack.base[frame->eval_height - 1];
+        for (i = 0; i < js_type_feedback_targets; i++) {
+            if (feedback->targets[i].type == 0) {
+                feedback->targets[i].type = callee.type;
+                if (callee.type == vt_function) {
+                    feedback->targets[i].ingress = callee.managed->function.ingress;
+                } else {
+                    feedback->targets[i].c_function = callee.c_function;
+                }
+            }
+            if (feedback->targets[i].type == callee.type && (callee.type == vt_function ? feedback->targets[i].ingress == callee.managed->function.ingress : feedback->targets[i].c_function == callee.c_function)) {
+                feedback->targets[i].count++;
+                break;
+            }
+        }
+        if (i == js_type_feedback_targets) {
+            feedback->megamorphic++;
+        }
+        return;
+    }
+    count = _operand_types(vm, instruction, types);
+    for (i = 0; i < count && i < 2; i++) {
+        feedback->operands[i] |= (uint16_t)(1 << types[i]);
+    }
+}
+
+enum { _jit_on_call, _jit_on_loop, _jit_on_resume }; // where js_run asks for machine code
+
+static void _gc_slice(struct js_vm *);
+
+// loop back edges, calls and returns, where js_run and machine code leaving by back edge have every live value on vm stacks
+// collection requested by allocation is done here, see js_call for when it is suspended
+static void _safe_point(struct js_vm *vm) {
+    struct js_heap *heap = &(vm->heap);
+    if (heap->due) {
+        if (heap->nursery && heap->nursery->length >= heap->nursery->capacity) {
+            js_gc_young(vm);
+        }
+        if (heap->phase != gc_idle) {
+            _gc_slice(vm);
+        } else if (heap->threshold != 0 && heap->length + heap->runtime_atoms >= heap->threshold) { // old generation reaches threshold, with atoms of keys
+            if (heap->slice_objects != 0 || heap->slice_microseconds != 0) {
+                _gc_slice(vm);
+            } else {
+                js_gc(vm);
+            }
+        }
+        heap->due = false;
+    }
+}
+
+// handler bodies shared by js_run and _jit_step, which only differ in where they go next
+// a result which is not success is thrown by caller, jumping instructions tell whether jump is taken by last argument
+// successful result is a new undefined one, copying result of callee such as _arithmetic back to caller is slower than the handler itself
+
+static always_inline void _handle_stack_push(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_value value;
+    enforce(instruction->num_operands > 0);
+    enforce(instruction->operands[0].type == opd_uint8);
+    switch (instruction->operands[0].value_uint8) {
+    case sf_value:
+        enforce(instruction->num_operands == 2);
+        switch (instruction->operands[1].type) {
+        case opd_undefined:
+            value = (struct js_value){0};
+            break;
+        case opd_null:
+            value = js_null();
+            break;
+        case opd_empty_array:
+            value = js_array(&(vm->heap));
+            break;
+        case opd_empty_object:
+            value = js_object(&(vm->heap));
+            break;
+        case opd_boolean:
+            value = js_boolean(instruction->operands[1].value_bool);
+            break;
+        case opd_double: // may be integer
+            value = instruction->cache.literal;
+            break;
+        case opd_string: // immutable, so interned literal is shared instead of allocating each time
+            if (instruction->cache.literal.type != 0) {
+                value = instruction->cache.literal;
+            } else {
+                value = js_string(&(vm->heap), instruction->operands[1].value_string.base, instruction->operands[1].value_string.length);
+            }
+            break;
+        case opd_function:
+            // closure must be added just after function definition, not before return, for example, returning function is declared outside this function, shoun't carry this function's local variable as closure.
+            // compiler knows which variables are used, they are captured by following op_closure_capture
+            value = js_function(&(vm->heap), instruction->operands[1].value_function.ingress);
+            break;
+        default:
+            fatal("Invalid value type %u", instruction->operands[1].type);
+        }
+        _stack_push_value(vm, value);
+        break;
+    case sf_function:
+    case sf_try:
+        enforce(instruction->num_operands = 2);
+        enforce(instruction->operands[1].type == opd_uint32);
+        _stack_push(vm, (struct js_stack_frame){.type = instruction->operands[0].value_uint8, .egress = instruction->operands[1].value_uint32});
+        break;
+    case sf_block:
+        enforce(instruction->num_operands = 1);
+        _stack_push(vm, (struct js_stack_frame){.type = instruction->operands[0].value_uint8});
+        break;
+    case sf_loop:
+        enforce(instruction->num_operands = 3);
+        enforce(instruction->operands[1].type == opd_uint32);
+        enforce(instruction->operands[2].type == opd_uint32);
+        _stack_push(vm, (struct js_stack_frame){.type = instruction->operands[0].value_uint8, .ingress = instruction->operands[1].value_uint32, .egress = instruction->operands[2].value_uint32});
+        break;
+    default:
+        fatal("Invalid stack type %u", instruction->operands[0].value_uint8);
+        break;
+    }
+}
+
+static always_inline void _handle_argument_append(struct js_vm *vm) {
+    struct js_stack_frame *frame = _stack_peek(vm, 0);
+    enforce(frame->type == sf_function);
+    enforce(frame->eval_height > 1 && frame->eval_height == vm->eval_stack.length);
+    _stack_swap(vm, 0, 1);
+    frame->eval_height--;
+    frame->eval_base--;
+}
+
+static always_inline struct js_result _handle_argument_get_next(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_value value, element;
+    enforce(instruction->num_operands == 2);
+    enforce(instruction->operands[0].type == opd_string);
+    enforce(instruction->operands[1].type == opd_uint16);
+    element = _stack_is_value_on_top(vm) ? _stack_pop_value(vm) : js_null(); // default value
+    value = _get_argument(vm, _stack_peek(vm, 0)->arguments.index++);
+    return _declare_slot(vm, instruction->operands[1].value_uint16, instruction->operands[0].value_string.base, (uint16_t)instruction->operands[0].value_string.length, value.type != vt_null ? value : element);
+}
+
+static always_inline struct js_result _handle_argument_get_rest(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_stack_frame *frame;
+    struct js_value value;
+    enforce(instruction->num_operands == 2);
+    enforce(instruction->operands[0].type == opd_string);
+    enforce(instruction->operands[1].type == opd_uint16);
+    value = js_array(&(vm->heap));
+    frame = _stack_peek(vm, 0);
+    enforce(frame->type == sf_function);
+    while (frame->arguments.index < frame->arguments.length) {
+        js_push_array_element(&(vm->heap), &value, frame->arguments.base[frame->arguments.index++]);
+    }
+    return _declare_slot(vm, instruction->operands[1].value_uint16, instruction->operands[0].value_string.base, (uint16_t)instruction->operands[0].value_string.length, value);
+}
+
+static always_inline struct js_result _handle_argument_spread(struct js_vm *vm) {
+    struct js_value value = _stack_pop_value(vm);
+    if (value.type != vt_array) {
+        js_throw(js_scripture_sz(&(vm->heap), "Parameter to be spreaded must be array"));
+    }
+    buffer_for_each(value.managed->array.base, value.managed->array.length, _, i, v, {
+        // arguments will be used by 3rd-party c functions, so special treat js_undefined here
+        _stack_push_value(vm, v->type == 0 ? js_null() : *v);
+    });
+    js_return((struct js_value){0});
+}
+
+// taken if there is no exception
+static always_inline struct js_result _handle_catch(struct js_vm *vm, struct js_instruction *instruction, bool *taken) {
+    struct js_value value;
+    enforce(instruction->num_operands == 3);
+    enforce(instruction->operands[0].type == opd_string);
+    enforce(instruction->operands[1].type == opd_uint32);
+    enforce(instruction->operands[2].type == opd_uint16);
+    value = _stack_pop_value(vm);
+    if ((*taken = value.type == 0)) {
+        js_return(value);
+    }
+    _stack_push(vm, (struct js_stack_frame){.type = sf_block, .egress = instruction->operands[1].value_uint32});
+    return _declare_slot(vm, instruction->operands[2].value_uint16, instruction->operands[0].value_string.base, (uint16_t)instruction->operands[0].value_string.length, value);
+}
+
+static always_inline struct js_result _handle_member_put(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_value value = _stack_pop_value(vm);
+    struct js_value selector = _stack_pop_value(vm);
+    struct js_value container = _stack_peek_value(vm, 0);
+    return _member_put_cached(&(vm->heap), vm->decoded.member_caches.base + instruction->cache.member, &container, &selector, value);
+}
+
+static always_inline struct js_result _handle_member_get(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_value selector = _stack_pop_value(vm);
+    struct js_value container = _stack_pop_value(vm);
+    struct js_result result = _member_get_cached(&(vm->heap), vm->decoded.member_caches.base + instruction->cache.member, &container, &selector);
+    if (!result.success) {
+        return result;
+    }
+    _stack_push_value(vm, result.value);
+    js_return((struct js_value){0});
+}
+
+static always_inline struct js_result _handle_member_get_const(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_value container;
+    enforce(instruction->num_operands == 1);
+    enforce(instruction->operands[0].type == opd_string);
+    container = _stack_pop_value(vm);
+    if (container.type != vt_object) {
+        js_throw(js_scripture_sz(&(vm->heap), "Must be array[number] or object[string]"));
+    }
+    _stack_push_value(vm, _member_cache_get(vm->decoded.member_caches.base + instruction->cache.member, &container, instruction->operands[0].value_string.atom));
+    js_return((struct js_value){0});
+}
+
+static always_inline struct js_result _handle_member_update(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_member_cache *cache = vm->decoded.member_caches.base + instruction->cache.member;
+    struct js_value container, selector, value, element;
+    struct js_result result;
+    enforce(instruction->num_operands == 1);
+    enforce(instruction->operands[0].type == opd_uint8);
+    value = _stack_pop_value(vm);
+    selector = _stack_pop_value(vm);
+    container = _stack_peek_value(vm, 0);
+    if (!(result = _member_get_cached(&(vm->heap), cache, &container, &selector)).success) {
+        return result;
+    }
+    element = result.value;
+    if (!(result = _arithmetic(&(vm->heap), instruction->operands[0].value_uint8, &element, &value)).success) {
+        return result;
+    }
+    return _member_put_cached(&(vm->heap), cache, &container, &selector, result.value);
+}
+
+static always_inline void _handle_object_optional(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_member_cache *cache = vm->decoded.member_caches.base + instruction->cache.member;
+    struct js_value selector = _stack_pop_value(vm);
+    struct js_value container = _stack_pop_value(vm);
+    if (container.type == vt_object && selector.type == vt_scripture) {
+        _stack_push_value(vm, _member_cache_get(cache, &container, js_atom_of(selector.scripture.base)));
+    } else if (container.type == vt_object && js_is_string(&selector)) {
+        cache->misses++;
+        _stack_push_value(vm, js_get_object_value(&(vm->heap), &container, js_get_string_base(&selector), (uint16_t)js_get_string_length(&selector)));
+    } else {
+        _stack_push_value(vm, js_null());
+    }
+}
+
+static always_inline struct js_result _handle_array_append(struct js_vm *vm) {
+    struct js_value value = _stack_pop_value(vm);
+    struct js_value container = _stack_peek_value(vm, 0);
+    if (container.type != vt_array) {
+        js_throw(js_scripture_sz(&(vm->heap), "Must be array"));
+    }
+    js_push_array_element(&(vm->heap), &container, value);
+    js_return((struct js_value){0});
+}
+
+static always_inline struct js_result _handle_array_spread(struct js_vm *vm) {
+    struct js_value value = _stack_pop_value(vm);
+    struct js_value container = _stack_peek_value(vm, 0);
+    if (container.type != vt_array || value.type != vt_array) {
+        js_throw(js_scripture_sz(&(vm->heap), "Must be array[...array]"));
+    }
+    // no skip null
+    buffer_for_each(value.managed->array.base, value.managed->array.length, _, i, v, {
+        js_push_array_element(&(vm->heap), &container, *v);
+    });
+    js_return((struct js_value){0});
+}
+
+// op_add to op_mod with opcode of instruction, op_eq to op_ge and op_compare_jump with opcode given
+static always_inline struct js_result _handle_binary(struct js_vm *vm, uint8_t opcode, bool arithmetic) {
+    struct js_value rhs = _stack_pop_value(vm);
+    struct js_value lhs = _stack_pop_value(vm);
+    struct js_result result = arithmetic ? _arithmetic(&(vm->heap), opcode, &lhs, &rhs) : _compare(&(vm->heap), opcode, &lhs, &rhs);
+    if (!result.success) {
+        return result;
+    }
+    _stack_push_value(vm, result.value);
+    js_return((struct js_value){0});
+}
+
+// short circuit, rhs is not evaluated if lhs decides result, taken then
+static always_inline struct js_result _handle_logical(struct js_vm *vm, struct js_instruction *instruction, bool *taken) {
+    struct js_value value;
+    enforce(instruction->num_operands <= 1);
+    value = _stack_peek_value(vm, 0);
+    if (value.type != vt_boolean) {
+        js_throw(js_scripture_sz(&(vm->heap), "Logical operand must be boolean"));
+    }
+    *taken = false;
+    if (instruction->num_operands == 1) {
+        enforce(instruction->operands[0].type == opd_uint32);
+        if (!(*taken = value.boolean == (instruction->opcode == op_or))) {
+            vm->eval_stack.length--;
+        }
+    }
+    js_return((struct js_value){0});
+}
+
+static always_inline struct js_result _handle_not(struct js_vm *vm) {
+    struct js_value value = _stack_pop_value(vm);
+    if (value.type != vt_boolean) {
+        js_throw(js_scripture_sz(&(vm->heap), "Logical operand must be boolean"));
+    }
+    value.boolean = !value.boolean;
+    _stack_push_value(vm, value);
+    js_return((struct js_value){0});
+}
+
+static always_inline void _handle_typeof(struct js_vm *vm) {
+    struct js_value value = _stack_pop_value(vm);
+    enforce(value.type < countof(_typeof_table));
+    _stack_push_value(vm, js_scripture_sz(&(vm->heap), _typeof_table[value.type]));
+}
+
+static always_inline struct js_result _handle_conditional_jump(struct js_vm *vm, struct js_instruction *instruction, bool *taken) {
+    struct js_value value;
+    enforce(instruction->num_operands == 1);
+    enforce(instruction->operands[0].type == opd_uint32);
+    value = _stack_pop_value(vm); // DONT place multiple conditional jumps together, because condition is poped
+    if (value.type != vt_boolean) {
+        js_throw(js_scripture_sz(&(vm->heap), "Conditional jump needs boolean"));
+    }
+    *taken = instruction->opcode == op_jump_if_true ? value.boolean : !value.boolean;
+    js_return((struct js_value){0});
+}
+
+// push next value into stack top, taken when there is no more
+static always_inline struct js_result _handle_for_next(struct js_vm *vm, struct js_instruction *instruction, bool *taken) {
+    struct js_result result;
+    enforce(instruction->num_operands == 1);
+    enforce(instruction->operands[0].type == opd_uint32);
+    if (!(result = _for_next(vm, instruction->opcode)).success) {
+        return result;
+    }
+    *taken = !result.value.boolean;
+    js_return((struct js_value){0});
+}
+
+static always_inline struct js_result _handle_slot_get(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_stack_frame *frame;
+    struct js_result result;
+    enforce(instruction->num_operands == 3);
+    enforce(instruction->operands[0].type == opd_uint8);
+    enforce(instruction->operands[1].type == opd_uint16);
+    enforce(instruction->operands[2].type == opd_string);
+    frame = _get_frame_at_depth(vm, instruction->operands[0].value_uint8);
+    if (instruction->operands[1].value_uint16 < frame->slots.length && frame->slots.base[instruction->operands[1].value_uint16].value.type != 0) {
+        _stack_push_value(vm, frame->slots.base[instruction->operands[1].value_uint16].value);
+        js_return((struct js_value){0});
+    }
+    // not declared yet at runtime, such as "if (...) let a = 1;", or deleted
+    if (!(result = js_get_variable(vm, instruction->operands[2].value_string.base, (uint16_t)instruction->operands[2].value_string.length)).success) {
+        return result;
+    }
+    _stack_push_value(vm, result.value);
+    js_return((struct js_value){0});
+}
+
+static always_inline struct js_result _handle_slot_put(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_stack_frame *frame;
+    enforce(instruction->num_operands == 3);
+    enforce(instruction->operands[0].type == opd_uint8);
+    enforce(instruction->operands[1].type == opd_uint16);
+    enforce(instruction->operands[2].type == opd_string);
+    frame = _get_frame_at_depth(vm, instruction->operands[0].value_uint8);
+    if (instruction->operands[1].value_uint16 < frame->slots.length && frame->slots.base[instruction->operands[1].value_uint16].value.type != 0) {
+        frame->slots.base[instruction->operands[1].value_uint16].value = _stack_pop_value(vm);
+        js_return((struct js_value){0});
+    }
+    return js_put_variable(vm, instruction->operands[2].value_string.base, (uint16_t)instruction->operands[2].value_string.length, _stack_pop_value(vm));
+}
+
+// op_slot_update, op_slot_increment and op_slot_decrement
+static always_inline struct js_result _handle_slot_update(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_stack_frame *frame;
+    struct js_value value, element;
+    struct js_result result;
+    size_t index;
+    uint8_t opcode;
+    enforce(instruction->num_operands == 3);
+    enforce(instruction->operands[0].type == opd_uint8);
+    enforce(instruction->operands[2].type == opd_string);
+    if (instruction->opcode == op_slot_update) {
+        enforce(instruction->operands[1].type == opd_uint32);
+        index = instruction->operands[1].value_uint32 & UINT16_MAX;
+        opcode = (uint8_t)(instruction->operands[1].value_uint32 >> 16);
+        value = _stack_pop_value(vm);
+    } else {
+        enforce(instruction->operands[1].type == opd_uint16);
+        index = instruction->operands[1].value_uint16;
+        opcode = instruction->opcode == op_slot_increment ? op_add : op_sub;
+        value = _integer(1);
+    }
+    frame = _get_frame_at_depth(vm, instruction->operands[0].value_uint8);
+    if (index < frame->slots.length && frame->slots.base[index].value.type != 0) {
+        if (!(result = _arithmetic(&(vm->heap), opcode, &(frame->slots.base[index].value), &value)).success) {
+            return result;
+        }
+        frame->slots.base[index].value = result.value;
+        js_return((struct js_value){0});
+    }
+    // same fallback as op_slot_get and op_slot_put
+    const char *name = instruction->operands[2].value_string.base;
+    uint16_t name_length = (uint16_t)instruction->operands[2].value_string.length;
+    if (!(result = js_get_variable(vm, name, name_length)).success) {
+        return result;
+    }
+    element = result.value;
+    if (!(result = _arithmetic(&(vm->heap), opcode, &element, &value)).success) {
+        return result;
+    }
+    return js_put_variable(vm, name, name_length, result.value);
+}
+
+static always_inline struct js_result _handle_global_put(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_value value;
+    enforce(instruction->num_operands == 1);
+    enforce(instruction->operands[0].type == opd_string);
+    value = _stack_pop_value(vm);
+    if (value.type != 0 && _get_global_node(vm, instruction) != NULL) { // put undefined means delete, let map do it
+        instruction->cache.global.node->value = js_normalize(value);
+        js_return((struct js_value){0});
+    }
+    return js_put_variable(vm, instruction->operands[0].value_string.base, (uint16_t)instruction->operands[0].value_string.length, value);
+}
+
+static always_inline struct js_result _handle_global_get(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_result result;
+    enforce(instruction->num_operands == 1);
+    enforce(instruction->operands[0].type == opd_string);
+    if (_get_global_node(vm, instruction) != NULL) {
+        _stack_push_value(vm, instruction->cache.global.node->value);
+        js_return((struct js_value){0});
+    }
+    // may be declared by name at runtime, or not exist, let it report
+    if (!(result = js_get_variable(vm, instruction->operands[0].value_string.base, (uint16_t)instruction->operands[0].value_string.length)).success) {
+        return result;
+    }
+    _stack_push_value(vm, result.value);
+    js_return((struct js_value){0});
+}
+
+// taken when comparison is false
+static always_inline struct js_result _handle_compare_jump(struct js_vm *vm, struct js_instruction *instruction, bool *taken) {
+    struct js_value rhs, lhs;
+    struct js_result result;
+    enforce(instruction->num_operands == 2);
+    enforce(instruction->operands[0].type == opd_uint32);
+    enforce(instruction->operands[1].type == opd_uint8);
+    rhs = _stack_pop_value(vm);
+    lhs = _stack_pop_value(vm);
+    if (!(result = _compare(&(vm->heap), instruction->operands[1].value_uint8, &lhs, &rhs)).success) {
+        return result;
+    }
+    *taken = !result.value.boolean;
+    js_return((struct js_value){0});
+}
+
+#ifdef JS_JIT
+
+// baseline jit, hot bytecode is translated instruction by instruction into x86-64 machine code templates
+// vm state (eval stack, frames, slots, pc) is never kept in registers between instructions, so machine code can be entered at any translated instruction and left anywhere, then js_run simply continues from vm->pc
+// number-only fast paths are inlined, other instructions call _jit_step, calls, returns and throws always leave to js_run
+
+    #define _jit_call_threshold 32 // calls before function ingress is compiled
+    #define _jit_loop_threshold 64 // backward jumps before loop head is compiled
+    #define _jit_max_region 2048 // instructions translated from one entry
+    #define _jit_arena_size (16 << 20) // bytes reserved once for machine code, compiling stops when full
+    #define _jit_max_trace 512 // instructions recorded from one loop iteration
+    #define _jit_trace_misses 16 // entries rejected by slot type guards before unstable trace is replaced by baseline code
+
+enum { _jit_thrown, _jit_next, _jit_taken }; // results of _jit_step
+enum { _jit_left_thrown, _jit_left, _jit_left_back }; // results of machine code
+
+// specialized machine code of one loop iteration, entered only at loop head
+struct _jit_trace {
+    uint32_t misses; // counted by machine code
+};
+
+struct _jit_site {
+    uint8_t *entry; // machine code of this instruction, NULL if not compiled
+    uint16_t calls;
+    uint16_t loops; // both UINT16_MAX if compiling failed, never retried
+    struct _jit_trace *trace; // if entry is a trace of loop starting here
+    bool traced; // recording has been tried, not retried
+};
+
+struct js_jit {
+    struct {
+        uint8_t *base; // mmapped, trampoline in first page, finished regions are read and execute only
+        size_t length; // page aligned
+        size_t capacity;
+    } code;
+    uint8_t *recorder; // in first page, records one loop iteration instead of running machine code, see _jit_trace_record
+    struct {
+        struct _jit_site *base; // indexed same as vm->decoded
+        uint32_t length;
+        uint32_t capacity;
+    } sites;
+    struct js_instruction *decoded_base; // machine code embeds instruction addresses, everything is dropped if decoded stream moves
+    struct js_value error; // thrown by _jit_step, rethrown by js_run
+};
+
+// executes one instruction for machine code, same handlers as js_run
+static uint8_t _jit_step(struct js_vm *vm, struct js_instruction *instruction) {
+    struct js_stack_frame *frame;
+    struct js_result result;
+    bool yes = false;
+    #define __operand_offset(__arg_i) (instruction->operands[__arg_i].value_string.base)
+    #define __operand_length(__arg_i) (instruction->operands[__arg_i].value_string.length)
+    #define __do_try(__arg_expr) \
+        do { \
+            result = (__arg_expr); \
+            if (!result.success) { \
+                vm->jit->error = result.value; \
+                return _jit_thrown; \
+            } \
+        } while (0)
+    switch (instruction->opcode) {
+    case op_nop:
+        break;
+    case op_stack_push:
+        _handle_stack_push(vm, instruction);
+        break;
+    case op_stack_pop:
+        _stack_pop(vm, instruction->operands[0].value_uint8);
+        break;
+    case op_variable_declare:
+        __do_try(js_declare_variable(vm, __operand_offset(0), __operand_length(0), _stack_pop_value(vm)));
+        break;
+    case op_variable_delete:
+        __do_try(js_delete_variable(vm, __operand_offset(0), __operand_length(0)));
+        break;
+    case op_variable_put:
+        __do_try(js_put_variable(vm, __operand_offset(0), __operand_length(0), _stack_pop_value(vm)));
+        break;
+    case op_variable_get:
+        __do_try(js_get_variable(vm, __operand_offset(0), __operand_length(0)));
+        _stack_push_value(vm, result.value);
+        break;
+    case op_argument_append:
+        _handle_argument_append(vm);
+        break;
+    case op_argument_first:
+        frame = _stack_peek(vm, 0);
+        enforce(frame->type == sf_function);
+        frame->arguments.index = 0;
+        break;
+    case op_argument_get_next:
+        __do_try(_handle_argument_get_next(vm, instruction));
+        break;
+    case op_argument_get_rest:
+        __do_try(_handle_argument_get_rest(vm, instruction));
+        break;
+    case op_argument_spread:
+        __do_try(_handle_argument_spread(vm));
+        break;
+    case op_member_put:
+        __do_try(_handle_member_put(vm, instruction));
+        break;
+    case op_member_get:
+        __do_try(_handle_member_get(vm, instruction));
+        break;
+    case op_member_get_const:
+        __do_try(_handle_member_get_const(vm, instruction));
+        break;
+    case op_member_update:
+        __do_try(_handle_member_update(vm, instruction));
+        break;
+    case op_object_optional:
+        _handle_object_optional(vm, instruction);
+        break;
+    case op_array_append:
+        __do_try(_handle_array_append(vm));
+        break;
+    case op_array_spread:
+        __do_try(_handle_array_spread(vm));
+        break;
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_pow:
+    case op_div:
+    case op_mod:
+        __do_try(_handle_binary(vm, instruction->opcode, true));
+        break;
+    case op_eq:
+    case op_ne:
+    case op_lt:
+    case op_le:
+    case op_gt:
+    case op_ge:
+        __do_try(_handle_binary(vm, instruction->opcode, false));
+        break;
+    case op_not:
+        __do_try(_handle_not(vm));
+        break;
+    case op_typeof:
+        _handle_typeof(vm);
+        break;
+    case op_stack_dupe:
+        _stack_push_value(vm, _stack_peek_value(vm, instruction->operands[0].value_uint8));
+        break;
+    case op_stack_swap:
+        _stack_swap(vm, instruction->operands[0].value_uint8, instruction->operands[1].value_uint8);
+        break;
+    case op_slot_declare:
+        __do_try(_declare_slot(vm, instruction->operands[0].value_uint16, __operand_offset(1), __operand_length(1), _stack_pop_value(vm)));
+        break;
+    case op_slot_get:
+        __do_try(_handle_slot_get(vm, instruction));
+        break;
+    case op_slot_put:
+        __do_try(_handle_slot_put(vm, instruction));
+        break;
+    case op_slot_update:
+    case op_slot_increment:
+    case op_slot_decrement:
+        __do_try(_handle_slot_update(vm, instruction));
+        break;
+    case op_closure_capture:
+        _closure_capture(vm, instruction);
+        break;
+    case op_global_put:
+        __do_try(_handle_global_put(vm, instruction));
+        break;
+    case op_global_get:
+        __do_try(_handle_global_get(vm, instruction));
+        break;
+    // jumping instructions, result tells whether taken
+    case op_catch:
+        __do_try(_handle_catch(vm, instruction, &yes));
+        return yes ? _jit_taken : _jit_next;
+    case op_and:
+    case op_or:
+        __do_try(_handle_logical(vm, instruction, &yes));
+        return yes ? _jit_taken : _jit_next;
+    case op_jump_if_false:
+    case op_jump_if_true:
+        __do_try(_handle_conditional_jump(vm, instruction, &yes));
+        return yes ? _jit_taken : _jit_next;
+    case op_for_in_next:
+    case op_for_of_next:
+        __do_try(_handle_for_next(vm, instruction, &yes));
+        return yes ? _jit_taken : _jit_next;
+    case op_compare_jump:
+        __do_try(_handle_compare_jump(vm, instruction, &yes));
+        return yes ? _jit_taken : _jit_next;
+    default:
+        fatal("Opcode %s is not translated", _opcode_names[instruction->opcode]);
+        break;
+    }
+    return _jit_next;
+    #undef __do_try
+    #undef __operand_length
+    #undef __operand_offset
+}
+
+enum _jit_register { jr_rax, jr_rcx, jr_rdx, jr_rbx, jr_rsp, jr_rbp, jr_rsi, jr_rdi, jr_r8, jr_r9, jr_r10, jr_r11, jr_r12, jr_r13, jr_r14, jr_r15 };
+
+// condition codes of jcc and setcc, flipping lowest bit negates
+enum _jit_condition { jc_o, jc_no, jc_b, jc_ae, jc_e, jc_ne, jc_be, jc_a, jc_s, jc_ns, jc_p, jc_np, jc_l, jc_ge, jc_le, jc_g, jc_always };
+
+// rel32 whose destination is known only after whole region is emitted
+enum _jit_fixup_kind { jf_label, jf_slow, jf_exit, jf_back, jf_error, jf_epilogue, jf_side_exit };
+
+struct _jit_fixup {
+    uint32_t position; // of rel32
+    uint8_t kind;
+    uint32_t target; // instruction index, or pc to leave with
+};
+
+// exit and error stubs are shared by all jumps to same target
+struct _jit_stub {
+    uint8_t kind;
+    uint32_t target;
+    uint32_t position;
+};
+
+struct _jit_assembler {
+    struct js_vm *vm;
+    uint32_t begin; // region of instructions
+    uint32_t end;
+    uint32_t current; // instruction being translated
+    struct {
+        uint8_t *base;
+        uint32_t length;
+        uint32_t capacity;
+    } code;
+    struct {
+        uint32_t *base; // code position of each instruction
+        uint32_t length;
+        uint32_t capacity;
+    } labels;
+    struct {
+        uint32_t *base; // code position of each instruction's slow path, 0 if not needed, 1 if needed but not emitted yet
+        uint32_t length;
+        uint32_t capacity;
+    } slows;
+    struct {
+        struct _jit_fixup *base;
+        uint32_t length;
+        uint32_t capacity;
+    } fixups;
+    struct {
+        struct _jit_stub *base;
+        uint32_t length;
+        uint32_t capacity;
+    } stubs;
+};
+
+    #define _jit_value_size ((int32_t)sizeof(struct js_value))
+    #define _jit_type ((int32_t)offsetof(struct js_value, type))
+    #define _jit_payload ((int32_t)offsetof(struct js_value, number))
+
+static void _jit_byte(struct _jit_assembler *a, uint8_t byte) {
+    buffer_push(a->code.base, a->code.length, a->code.capacity, byte);
+}
+
+static void _jit_imm32(struct _jit_assembler *a, uint32_t imm) {
+    for (int i = 0; i < 32; i += 8) {
+        _jit_byte(a, (uint8_t)(imm >> i));
+    }
+}
+
+static void _jit_imm64(struct _jit_assembler *a, uint64_t imm) {
+    for (int i = 0; i < 64; i += 8) {
+        _jit_byte(a, (uint8_t)(imm >> i));
+    }
+}
+
+// mandatory prefix (0 if none), rex, then opcode of 1 byte or 2 bytes beginning with 0x0f
+static void _jit_opcode(struct _jit_assembler *a, uint8_t prefix, bool wide, uint16_t opcode, uint8_t reg, uint8_t rm) {
+    uint8_t rex = (uint8_t)(0x40 | (wide << 3) | ((reg & 8) >> 1) | ((rm & 8) >> 3));
+    if (prefix) {
+        _jit_byte(a, prefix);
+    }
+    if (rex != 0x40) {
+        _jit_byte(a, rex);
+    }
+    if (opcode > 0xff) {
+        _jit_byte(a, (uint8_t)(opcode >> 8));
+    }
+    _jit_byte(a, (uint8_t)opcode);
+}
+
+// reg is register or opcode extension, operand is [base + disp32]
+static void _jit_mem(struct _jit_assembler *a, uint8_t prefix, bool wide, uint16_t opcode, uint8_t reg, uint8_t base, int32_t disp) {
+    _jit_opcode(a, prefix, wide, opcode, reg, base);
+    _jit_byte(a, (uint8_t)(0x80 | ((reg & 7) << 3) | (base & 7)));
+    if ((base & 7) == jr_rsp) { // rsp and r12 need sib
+        _jit_byte(a, 0x24);
+    }
+    _jit_imm32(a, (uint32_t)disp);
+}
+
+// reg is register or opcode extension, operand is register rm
+static void _jit_reg(struct _jit_assembler *a, uint8_t prefix, bool wide, uint16_t opcode, uint8_t reg, uint8_t rm) {
+    _jit_opcode(a, prefix, wide, opcode, reg, rm);
+    _jit_byte(a, (uint8_t)(0xc0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+static void _jit_mov_imm64(struct _jit_assembler *a, uint8_t reg, uint64_t imm) {
+    _jit_byte(a, (uint8_t)(0x48 | (reg >> 3)));
+    _jit_byte(a, (uint8_t)(0xb8 | (reg & 7)));
+    _jit_imm64(a, imm);
+}
+
+// jmp or jcc with rel32 fixed later
+static void _jit_jump(struct _jit_assembler *a, uint8_t condition, uint8_t kind, uint32_t target) {
+    if (condition == jc_always) {
+        _jit_byte(a, 0xe9);
+    } else {
+        _jit_byte(a, 0x0f);
+        _jit_byte(a, (uint8_t)(0x80 | condition));
+    }
+    buffer_push(a->fixups.base, a->fixups.length, a->fixups.capacity, ((struct _jit_fixup){.position = a->code.length, .kind = kind, .target = target}));
+    _jit_imm32(a, 0);
+    if (kind == jf_slow) {
+        a->slows.base[target - a->begin] = 1;
+    }
+}
+
+// followed by jne leaving by back edge, so that collection requested by allocation is done at safe point
+static void _jit_test_due(struct _jit_assembler *a) {
+    _jit_mem(a, 0, false, 0x80, 7, jr_rbx, (int32_t)offsetof(struct js_vm, heap.due)); // cmp byte, 0
+    _jit_byte(a, 0);
+}
+
+// jump to instruction, directly if it is inside region, otherwise leave to js_run, backward ones may enter another region at once
+// loop heads having traces, or not yet tried to be traced, are left too, so that traces run instead of generic code
+static void _jit_branch(struct _jit_assembler *a, uint8_t condition, uint32_t target) {
+    struct _jit_site *site = a->vm->jit->sites.base + target;
+    bool traced = target <= a->current && (site->trace != NULL || !site->traced);
+    uint8_t kind = target >= a->begin && target < a->end && !traced ? jf_label : target <= a->current ? jf_back : jf_exit;
+    if (kind == jf_label && target <= a->current && condition == jc_always) { // loops are closed by op_jump
+        _jit_test_due(a);
+        _jit_jump(a, jc_ne, jf_back, target);
+    }
+    _jit_jump(a, condition, kind, target);
+}
+
+// forward jump inside one template, returns position of rel32 to be patched by _jit_here
+static uint32_t _jit_local(struct _jit_assembler *a, uint8_t condition) {
+    if (condition == jc_always) {
+        _jit_byte(a, 0xe9);
+    } else {
+        _jit_byte(a, 0x0f);
+        _jit_byte(a, (uint8_t)(0x80 | condition));
+    }
+    _jit_imm32(a, 0);
+    return a->code.length - 4;
+}
+
+static void _jit_here(struct _jit_assembler *a, uint32_t position) {
+    uint32_t rel = a->code.length - (position + 4);
+    memcpy(a->code.base + position, &rel, 4);
+}
+
+// rcx = end of eval stack, at least count values on it, or room for one more value
+static void _jit_eval_end(struct _jit_assembler *a, uint32_t index, uint8_t count, bool room) {
+    _jit_mem(a, 0, false, 0x0fb7, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.length)); // movzx eax, word
+    if (count > 0) {
+        _jit_reg(a, 0, false, 0x81, 7, jr_rax); // cmp eax, imm32
+        _jit_imm32(a, count);
+        _jit_jump(a, jc_b, jf_slow, index);
+    }
+    if (room) {
+        _jit_reg(a, 0, false, 0x81, 7, jr_rax);
+        _jit_imm32(a, a->vm->eval_stack.capacity); // allocated once, never changes
+        _jit_jump(a, jc_ae, jf_slow, index);
+    }
+    _jit_reg(a, 0, true, 0x69, jr_rcx, jr_rax); // imul rcx, rax, imm32
+    _jit_imm32(a, (uint32_t)_jit_value_size);
+    _jit_reg(a, 0, true, 0x01, jr_r12, jr_rcx); // add rcx, r12
+}
+
+// after value is written at rcx, eax is still old length
+static void _jit_eval_grow(struct _jit_assembler *a) {
+    _jit_reg(a, 0, false, 0x81, 0, jr_rax); // add eax, 1
+    _jit_imm32(a, 1);
+    _jit_mem(a, 0x66, false, 0x89, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.length)); // mov word, ax
+}
+
+static void _jit_eval_shrink(struct _jit_assembler *a, uint8_t count) {
+    _jit_mem(a, 0x66, false, 0x83, 5, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.length)); // sub word, imm8
+    _jit_byte(a, count);
+}
+
+// rdx = slots base of frame at depth, returns displacement of slot's value, slow path if not declared
+static int32_t _jit_slot(struct _jit_assembler *a, uint32_t index, uint8_t depth, uint16_t slot) {
+    int32_t disp = (int32_t)(slot * sizeof(struct js_slot) + offsetof(struct js_slot, value));
+    _jit_mem(a, 0, false, 0x0fb7, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, stack.length)); // movzx eax, word
+    _jit_reg(a, 0, false, 0x81, 5, jr_rax); // sub eax, depth + 1
+    _jit_imm32(a, (uint32_t)depth + 1);
+    _jit_jump(a, jc_b, jf_slow, index);
+    _jit_reg(a, 0, true, 0x69, jr_rax, jr_rax); // imul rax, rax, imm32
+    _jit_imm32(a, sizeof(struct js_stack_frame));
+    _jit_mem(a, 0, true, 0x03, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, stack.base)); // add rax, [stack.base]
+    _jit_mem(a, 0, false, 0x0fb7, jr_rcx, jr_rax, (int32_t)offsetof(struct js_stack_frame, slots.length)); // movzx ecx, word
+    _jit_reg(a, 0, false, 0x81, 7, jr_rcx); // cmp ecx, slot
+    _jit_imm32(a, slot);
+    _jit_jump(a, jc_be, jf_slow, index);
+    _jit_mem(a, 0, true, 0x8b, jr_rdx, jr_rax, (int32_t)offsetof(struct js_stack_frame, slots.base)); // mov rdx, [slots.base]
+    _jit_mem(a, 0, false, 0x80, 7, jr_rdx, disp + _jit_type); // cmp byte, 0
+    _jit_byte(a, 0);
+    _jit_jump(a, jc_e, jf_slow, index);
+    return disp;
+}
+
+// copy value from [from + from_disp] to [to + to_disp] through r8 and r9
+static void _jit_copy_value(struct _jit_assembler *a, uint8_t to, int32_t to_disp, uint8_t from, int32_t from_disp) {
+    _jit_mem(a, 0, false, 0x0fb6, jr_r8, from, from_disp + _jit_type); // movzx r8d, byte
+    _jit_mem(a, 0, true, 0x8b, jr_r9, from, from_disp + _jit_payload); // mov r9, qword
+    _jit_mem(a, 0, false, 0x88, jr_r8, to, to_disp + _jit_type); // mov byte, r8b
+    _jit_mem(a, 0, true, 0x89, jr_r9, to, to_disp + _jit_payload); // mov qword, r9
+}
+
+static void _jit_check_type(struct _jit_assembler *a, int32_t disp, uint8_t type, uint8_t kind, uint32_t target) {
+    _jit_mem(a, 0, false, 0x80, 7, jr_rcx, disp + _jit_type); // cmp byte, imm8
+    _jit_byte(a, type);
+    _jit_jump(a, jc_ne, kind, target);
+}
+
+// calls _jit_step, then follows its result
+static void _jit_call_step(struct _jit_assembler *a, uint32_t index) {
+    struct js_instruction *instruction = a->vm->decoded.base + index;
+    _jit_reg(a, 0, true, 0x89, jr_rbx, jr_rdi); // mov rdi, rbx
+    _jit_mov_imm64(a, jr_rsi, (uint64_t)(uintptr_t)instruction);
+    _jit_mov_imm64(a, jr_rax, (uint64_t)(uintptr_t)_jit_step);
+    _jit_reg(a, 0, false, 0xff, 2, jr_rax); // call rax
+    _jit_reg(a, 0, false, 0x84, jr_rax, jr_rax); // test al, al
+    _jit_jump(a, jc_e, jf_error, index);
+    switch (instruction->opcode) {
+    case op_compare_jump:
+    case op_jump_if_false:
+    case op_jump_if_true:
+    case op_and:
+    case op_or:
+    case op_for_in_next:
+    case op_for_of_next:
+    case op_catch:
+        _jit_byte(a, 0x3c); // cmp al, imm8
+        _jit_byte(a, _jit_taken);
+        _jit_branch(a, jc_e, instruction->operands[instruction->opcode == op_catch ? 1 : 0].value_uint32);
+        break;
+    default:
+        break;
+    }
+}
+
+// integer and double add, sub, mul
+static void _jit_arithmetic(struct _jit_assembler *a, uint32_t index, uint8_t opcode) {
+    int32_t lhs = -2 * _jit_value_size, rhs = -_jit_value_size;
+    uint32_t to_double, to_store, to_done;
+    _jit_eval_end(a, index, 2, false);
+    _jit_mem(a, 0, false, 0x80, 7, jr_rcx, lhs + _jit_type);
+    _jit_byte(a, vt_integer);
+    to_double = _jit_local(a, jc_ne);
+    _jit_check_type(a, rhs, vt_integer, jf_slow, index);
+    _jit_mem(a, 0, false, 0x8b, jr_rdx, jr_rcx, lhs + _jit_payload); // mov edx, lhs
+    _jit_mem(a, 0, false, opcode == op_add ? 0x03 : opcode == op_sub ? 0x2b : 0x0faf, jr_rdx, jr_rcx, rhs + _jit_payload); // add, sub, imul edx, rhs
+    _jit_jump(a, jc_o, jf_slow, index);
+    if (opcode == op_mul) { // -0 is double
+        _jit_reg(a, 0, false, 0x85, jr_rdx, jr_rdx); // test edx, edx
+        to_store = _jit_local(a, jc_ne);
+        _jit_mem(a, 0, false, 0x8b, jr_r8, jr_rcx, lhs + _jit_payload);
+        _jit_mem(a, 0, false, 0x0b, jr_r8, jr_rcx, rhs + _jit_payload); // or r8d, rhs
+        _jit_jump(a, jc_s, jf_slow, index);
+        _jit_here(a, to_store);
+    }
+    _jit_mem(a, 0, false, 0x89, jr_rdx, jr_rcx, lhs + _jit_payload);
+    to_done = _jit_local(a, jc_always);
+    _jit_here(a, to_double);
+    _jit_check_type(a, lhs, vt_number, jf_slow, index);
+    _jit_check_type(a, rhs, vt_number, jf_slow, index);
+    _jit_mem(a, 0xf2, false, 0x0f10, 0, jr_rcx, lhs + _jit_payload); // movsd xmm0, lhs
+    _jit_mem(a, 0xf2, false, opcode == op_add ? 0x0f58 : opcode == op_sub ? 0x0f5c : 0x0f59, 0, jr_rcx, rhs + _jit_payload); // addsd, subsd, mulsd
+    _jit_mem(a, 0xf2, false, 0x0f11, 0, jr_rcx, lhs + _jit_payload); // movsd lhs, xmm0
+    _jit_here(a, to_done);
+    _jit_eval_shrink(a, 1);
+}
+
+// non negative integer modulo, others are rare enough to go slow path
+static void _jit_modulo(struct _jit_assembler *a, uint32_t index) {
+    int32_t lhs = -2 * _jit_value_size, rhs = -_jit_value_size;
+    _jit_eval_end(a, index, 2, false);
+    _jit_check_type(a, lhs, vt_integer, jf_slow, index);
+    _jit_check_type(a, rhs, vt_integer, jf_slow, index);
+    _jit_mem(a, 0, false, 0x8b, jr_rax, jr_rcx, lhs + _jit_payload);
+    _jit_reg(a, 0, false, 0x85, jr_rax, jr_rax);
+    _jit_jump(a, jc_s, jf_slow, index);
+    _jit_mem(a, 0, false, 0x8b, jr_r8, jr_rcx, rhs + _jit_payload);
+    _jit_reg(a, 0, false, 0x85, jr_r8, jr_r8);
+    _jit_jump(a, jc_le, jf_slow, index);
+    _jit_byte(a, 0x99); // cdq
+    _jit_reg(a, 0, false, 0xf7, 7, jr_r8); // idiv r8d
+    _jit_mem(a, 0, false, 0x89, jr_rdx, jr_rcx, lhs + _jit_payload);
+    _jit_eval_shrink(a, 1);
+}
+
+// relational and equality operators, pushes boolean, or pops both and jumps to target if false
+static void _jit_compare(struct _jit_assembler *a, uint32_t index, uint8_t opcode, uint32_t target, bool jump) {
+    static const uint8_t integer_conditions[] = {[op_eq] = jc_e, [op_ne] = jc_ne, [op_lt] = jc_l, [op_le] = jc_le, [op_gt] = jc_g, [op_ge] = jc_ge};
+    int32_t lhs = -2 * _jit_value_size, rhs = -_jit_value_size;
+    uint32_t to_double = 0, to_done = 0;
+    uint8_t condition = integer_conditions[opcode];
+    bool has_double = opcode != op_eq && opcode != op_ne; // identity of doubles is bitwise, see js_is_identical
+    for (int pass = 0; pass < (has_double ? 2 : 1); pass++) {
+        if (pass == 0) {
+            _jit_eval_end(a, index, 2, false);
+            _jit_mem(a, 0, false, 0x80, 7, jr_rcx, lhs + _jit_type);
+            _jit_byte(a, vt_integer);
+            if (has_double) {
+                to_double = _jit_local(a, jc_ne);
+            } else {
+                _jit_jump(a, jc_ne, jf_slow, index);
+            }
+            _jit_check_type(a, rhs, vt_integer, jf_slow, index);
+        } else {
+            _jit_here(a, to_double);
+            _jit_check_type(a, lhs, vt_number, jf_slow, index);
+            _jit_check_type(a, rhs, vt_number, jf_slow, index);
+            // ucomisd sets flags like unsigned compare, and unordered always fails 'a' and 'ae'
+            condition = opcode == op_lt || opcode == op_gt ? jc_a : jc_ae;
+        }
+        if (jump) {
+            _jit_eval_shrink(a, 2); // values are still readable
+        }
+        if (pass == 0) {
+            _jit_mem(a, 0, false, 0x8b, jr_rdx, jr_rcx, lhs + _jit_payload);
+            _jit_mem(a, 0, false, 0x3b, jr_rdx, jr_rcx, rhs + _jit_payload); // cmp edx, rhs
+        } else {
+            bool swap = opcode == op_lt || opcode == op_le;
+            _jit_mem(a, 0xf2, false, 0x0f10, 0, jr_rcx, (swap ? rhs : lhs) + _jit_payload); // movsd xmm0
+            _jit_mem(a, 0x66, false, 0x0f2e, 0, jr_rcx, (swap ? lhs : rhs) + _jit_payload); // ucomisd xmm0
+        }
+        if (jump) {
+            _jit_branch(a, condition ^ 1, target);
+        } else {
+            _jit_reg(a, 0, false, 0x0f90 | condition, 0, jr_rax); // setcc al
+            _jit_reg(a, 0, false, 0x0fb6, jr_rax, jr_rax); // movzx eax, al
+            _jit_mem(a, 0, false, 0xc6, 0, jr_rcx, lhs + _jit_type); // mov byte, imm8
+            _jit_byte(a, vt_boolean);
+            _jit_mem(a, 0, true, 0x89, jr_rax, jr_rcx, lhs + _jit_payload);
+        }
+        if (pass == 0 && has_double) {
+            to_done = _jit_local(a, jc_always);
+        }
+    }
+    if (has_double) {
+        _jit_here(a, to_done);
+    }
+    if (!jump) {
+        _jit_eval_shrink(a, 1);
+    }
+}
+
+static bool _jit_is_exit(uint8_t opcode) {
+    switch (opcode) {
+    case op_call:
+    case op_tail_call:
+    case op_return:
+    case op_throw:
+    case op_break:
+    case op_continue:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void _jit_translate(struct _jit_assembler *a, uint32_t index) {
+    struct js_instruction *instruction = a->vm->decoded.base + index;
+    struct _decoded_operand *operands = instruction->operands;
+    struct js_value literal;
+    uint64_t payload;
+    int32_t disp;
+    if (_jit_is_exit(instruction->opcode)) {
+        _jit_jump(a, jc_always, jf_exit, index);
+        return;
+    }
+    switch (instruction->opcode) {
+    case op_nop:
+        break;
+    case op_jump:
+        _jit_branch(a, jc_always, operands[0].value_uint32);
+        break;
+    case op_stack_push:
+        if (operands[0].value_uint8 != sf_value || !(operands[1].type == opd_null || operands[1].type == opd_boolean || operands[1].type == opd_double || (operands[1].type == opd_string && instruction->cache.literal.type != 0))) {
+            _jit_call_step(a, index);
+            break;
+        }
+        literal = operands[1].type == opd_null ? js_null() : operands[1].type == opd_boolean ? js_boolean(operands[1].value_bool) : instruction->cache.literal;
+        memcpy(&payload, (uint8_t *)&literal + _jit_payload, sizeof(payload));
+        _jit_eval_end(a, index, 0, true);
+        _jit_mem(a, 0, false, 0xc6, 0, jr_rcx, _jit_type); // mov byte, imm8
+        _jit_byte(a, literal.type);
+        _jit_mov_imm64(a, jr_rdx, payload);
+        _jit_mem(a, 0, true, 0x89, jr_rdx, jr_rcx, _jit_payload);
+        _jit_eval_grow(a);
+        break;
+    case op_slot_get:
+        disp = _jit_slot(a, index, operands[0].value_uint8, operands[1].value_uint16);
+        _jit_eval_end(a, index, 0, true);
+        _jit_copy_value(a, jr_rcx, 0, jr_rdx, disp);
+        _jit_eval_grow(a);
+        break;
+    case op_slot_put:
+        disp = _jit_slot(a, index, operands[0].value_uint8, operands[1].value_uint16);
+        _jit_eval_end(a, index, 1, false);
+        _jit_copy_value(a, jr_rdx, disp, jr_rcx, -_jit_value_size);
+        _jit_eval_shrink(a, 1);
+        break;
+    case op_slot_increment:
+    case op_slot_decrement:
+        disp = _jit_slot(a, index, operands[0].value_uint8, operands[1].value_uint16);
+        _jit_mem(a, 0, false, 0x80, 7, jr_rdx, disp + _jit_type);
+        _jit_byte(a, vt_integer);
+        _jit_jump(a, jc_ne, jf_slow, index);
+        _jit_mem(a, 0, false, 0x8b, jr_rax, jr_rdx, disp + _jit_payload);
+        _jit_reg(a, 0, false, 0x81, instruction->opcode == op_slot_increment ? 0 : 5, jr_rax); // add or sub eax, 1
+        _jit_imm32(a, 1);
+        _jit_jump(a, jc_o, jf_slow, index);
+        _jit_mem(a, 0, false, 0x89, jr_rax, jr_rdx, disp + _jit_payload);
+        break;
+    case op_add:
+    case op_sub:
+    case op_mul:
+        _jit_arithmetic(a, index, instruction->opcode);
+        break;
+    case op_mod:
+        _jit_modulo(a, index);
+        break;
+    case op_eq:
+    case op_ne:
+    case op_lt:
+    case op_le:
+    case op_gt:
+    case op_ge:
+        _jit_compare(a, index, instruction->opcode, 0, false);
+        break;
+    case op_compare_jump:
+        if (operands[1].value_uint8 >= op_eq && operands[1].value_uint8 <= op_ge) {
+            _jit_compare(a, index, operands[1].value_uint8, operands[0].value_uint32, true);
+        } else {
+            _jit_call_step(a, index);
+        }
+        break;
+    case op_jump_if_false:
+    case op_jump_if_true:
+        _jit_eval_end(a, index, 1, false);
+        _jit_check_type(a, -_jit_value_size, vt_boolean, jf_slow, index);
+        _jit_eval_shrink(a, 1);
+        _jit_mem(a, 0, false, 0x80, 7, jr_rcx, -_jit_value_size + _jit_payload); // cmp byte, 0
+        _jit_byte(a, 0);
+        _jit_branch(a, instruction->opcode == op_jump_if_true ? jc_ne : jc_e, operands[0].value_uint32);
+        break;
+    default:
+        _jit_call_step(a, index);
+        break;
+    }
+}
+
+static uint8_t _jit_trace_record(struct js_vm *);
+
+// maps arena once, first page has trampoline: save registers, rbx = vm, r12 = eval stack, jump to entry
+// and recorder, which is entered like machine code but calls _jit_trace_record
+static bool _jit_reserve(struct js_vm *vm) {
+    struct js_jit *jit = vm->jit;
+    struct _jit_assembler a = {.vm = vm};
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uint32_t recorder;
+    if (jit->code.base != NULL) {
+        return true;
+    }
+    jit->code.base = mmap(NULL, _jit_arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code.base == MAP_FAILED) {
+        jit->code.base = NULL;
+        return false;
+    }
+    jit->code.capacity = _jit_arena_size;
+    _jit_byte(&a, 0x53); // push rbx
+    _jit_byte(&a, 0x41); // push r12
+    _jit_byte(&a, 0x54);
+    _jit_reg(&a, 0, true, 0x83, 5, jr_rsp); // sub rsp, 8, keeps stack aligned for calls
+    _jit_byte(&a, 8);
+    _jit_reg(&a, 0, true, 0x89, jr_rdi, jr_rbx); // mov rbx, rdi
+    _jit_mem(&a, 0, true, 0x8b, jr_r12, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.base)); // never moves
+    _jit_reg(&a, 0, false, 0xff, 4, jr_rsi); // jmp rsi
+    recorder = a.code.length;
+    _jit_reg(&a, 0, true, 0x89, jr_rbx, jr_rdi); // mov rdi, rbx
+    _jit_mov_imm64(&a, jr_rax, (uint64_t)(uintptr_t)_jit_trace_record);
+    _jit_reg(&a, 0, false, 0xff, 2, jr_rax); // call rax
+    _jit_reg(&a, 0, true, 0x83, 0, jr_rsp); // add rsp, 8
+    _jit_byte(&a, 8);
+    _jit_byte(&a, 0x41); // pop r12
+    _jit_byte(&a, 0x5c);
+    _jit_byte(&a, 0x5b); // pop rbx
+    _jit_byte(&a, 0xc3); // ret
+    memcpy(jit->code.base, a.code.base, a.code.length);
+    buffer_free(a.code.base, a.code.length, a.code.capacity);
+    if (mprotect(jit->code.base, page, PROT_READ | PROT_EXEC) != 0) { // such as denied by security policy, then nothing is compiled
+        munmap(jit->code.base, _jit_arena_size);
+        jit->code.base = NULL;
+        jit->code.capacity = 0;
+        return false;
+    }
+    jit->code.length = page;
+    jit->recorder = jit->code.base + recorder;
+    return true;
+}
+
+// copies assembled code into arena as read and execute only, returns its address, NULL if arena is full or pages can not be made executable
+static uint8_t *_jit_install(struct js_vm *vm, struct _jit_assembler *a) {
+    struct js_jit *jit = vm->jit;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), size = (a->code.length + page - 1) / page * page;
+    uint8_t *base;
+    if (jit->code.length + size > jit->code.capacity) {
+        return NULL;
+    }
+    base = jit->code.base + jit->code.length;
+    memcpy(base, a->code.base, a->code.length);
+    if (mprotect(base, size, PROT_READ | PROT_EXEC) != 0) { // pages stay writable and are reused by next install
+        return NULL;
+    }
+    jit->code.length += size;
+    return base;
+}
+
+// translates from begin until an unconditional transfer that no forward branch jumps over, returns machine code of begin
+static uint8_t *_jit_compile(struct js_vm *vm, uint32_t begin) {
+    struct js_jit *jit = vm->jit;
+    struct _jit_assembler a = {.vm = vm, .begin = begin, .end = begin};
+    uint32_t reach = begin, epilogue, destination, rel;
+    uint8_t *base;
+    if (_jit_is_exit(vm->decoded.base[begin].opcode) || !_jit_reserve(vm)) {
+        return NULL;
+    }
+    while (a.end < vm->decoded.length && a.end - begin < _jit_max_region) {
+        struct js_instruction *instruction = vm->decoded.base + a.end++;
+        for (uint8_t j = 0; j < instruction->num_operands; j++) {
+            if (_is_address_operand(instruction->opcode, instruction->operands[0].value_uint8, j, instruction->operands[j].type) && instruction->operands[j].value_uint32 > reach) {
+                reach = instruction->operands[j].value_uint32;
+            }
+        }
+        bool terminator = instruction->opcode == op_jump || instruction->opcode == op_return || instruction->opcode == op_throw || instruction->opcode == op_break || instruction->opcode == op_continue;
+        if (terminator && reach < a.end) {
+            break;
+        }
+    }
+    buffer_alloc(a.labels.base, a.labels.length, a.labels.capacity, a.end - begin);
+    buffer_alloc(a.slows.base, a.slows.length, a.slows.capacity, a.end - begin);
+    for (uint32_t i = begin; i < a.end; i++) {
+        a.labels.base[i - begin] = a.code.length;
+        a.current = i;
+        _jit_translate(&a, i);
+    }
+    _jit_jump(&a, jc_always, jf_exit, a.end);
+    // slow paths, full instruction by _jit_step, then back to next instruction
+    for (uint32_t i = begin; i < a.end; i++) {
+        if (a.slows.base[i - begin]) {
+            a.slows.base[i - begin] = a.code.length;
+            a.current = i;
+            _jit_call_step(&a, i);
+            _jit_branch(&a, jc_always, i + 1);
+        }
+    }
+    // leave with vm->pc set, or with pc after throwing instruction like js_run does, these only add epilogue fixups
+    for (uint32_t i = 0; i < a.fixups.length; i++) {
+        struct _jit_fixup *fixup = a.fixups.base + i;
+        uint32_t j;
+        if (fixup->kind != jf_exit && fixup->kind != jf_back && fixup->kind != jf_error) {
+            continue;
+        }
+        for (j = 0; j < a.stubs.length && (a.stubs.base[j].kind != fixup->kind || a.stubs.base[j].target != fixup->target); j++) {
+        }
+        if (j < a.stubs.length) {
+            continue;
+        }
+        buffer_push(a.stubs.base, a.stubs.length, a.stubs.capacity, ((struct _jit_stub){.kind = fixup->kind, .target = fixup->target, .position = a.code.length}));
+        _jit_mem(&a, 0, false, 0xc7, 0, jr_rbx, (int32_t)offsetof(struct js_vm, pc)); // mov dword, imm32
+        _jit_imm32(&a, fixup->kind == jf_error ? fixup->target + 1 : fixup->target);
+        _jit_byte(&a, 0xb8); // mov eax, imm32
+        _jit_imm32(&a, fixup->kind == jf_error ? _jit_left_thrown : fixup->kind == jf_back ? _jit_left_back : _jit_left);
+        _jit_jump(&a, jc_always, jf_epilogue, 0);
+    }
+    epilogue = a.code.length;
+    _jit_reg(&a, 0, true, 0x83, 0, jr_rsp); // add rsp, 8
+    _jit_byte(&a, 8);
+    _jit_byte(&a, 0x41); // pop r12
+    _jit_byte(&a, 0x5c);
+    _jit_byte(&a, 0x5b); // pop rbx
+    _jit_byte(&a, 0xc3); // ret
+    buffer_for_each(a.fixups.base, a.fixups.length, a.fixups.capacity, i, fixup, {
+        switch (fixup->kind) {
+        case jf_label:
+            destination = a.labels.base[fixup->target - begin];
+            break;
+        case jf_slow:
+            destination = a.slows.base[fixup->target - begin];
+            break;
+        case jf_epilogue:
+            destination = epilogue;
+            break;
+        default:
+            destination = 0;
+            buffer_for_each(a.stubs.base, a.stubs.length, a.stubs.capacity, j, stub, {
+                if (stub->kind == fixup->kind && stub->target == fixup->target) {
+                    destination = stub->position;
+                }
+            });
+            break;
+        }
+        rel = destination - (fixup->position + 4);
+        memcpy(a.code.base + fixup->position, &rel, 4);
+    });
+    if ((base = _jit_install(vm, &a)) != NULL) {
+        for (uint32_t i = begin; i < a.end; i++) {
+            if (!_jit_is_exit(vm->decoded.base[i].opcode) && jit->sites.base[i].entry == NULL) {
+                jit->sites.base[i].entry = base + a.labels.base[i - begin];
+            }
+        }
+        base += a.labels.base[0];
+    }
+    buffer_free(a.code.base, a.code.length, a.code.capacity);
+    buffer_free(a.labels.base, a.labels.length, a.labels.capacity);
+    buffer_free(a.slows.base, a.slows.length, a.slows.capacity);
+    buffer_free(a.fixups.base, a.fixups.length, a.fixups.capacity);
+    buffer_free(a.stubs.base, a.stubs.length, a.stubs.capacity);
+    return base;
+}
+
+// trace jit, a loop iteration which gets hot is recorded by executing it with _jit_step, observing operand types
+// recorded instructions are then compiled in a straight line, specialized for those types
+// eval stack offsets are known statically, slots' frames are resolved once at entry, slot types are guarded at loop head only
+// frames pushed inside iteration, such as blocks declaring variables, are handled by _jit_step, their slots are looked up when accessed
+// guards and branches going other way than recorded leave to js_run with exact vm state, like baseline code does
+
+// one executed instruction of recorded iteration
+struct _jit_trace_step {
+    uint32_t index;
+    int32_t before; // eval stack length relative to loop head
+    int32_t after;
+    uint16_t frames; // pushed since loop head, before instruction
+    bool framing; // instruction pushes or pops frames
+    uint8_t types[3]; // see _operand_types
+    bool taken;
+};
+
+// slot accessed by trace
+struct _jit_trace_slot {
+    uint8_t depth; // at loop head
+    uint16_t slot;
+    uint8_t frame; // where its frame's slots base is saved on machine stack, in 8 bytes
+    uint8_t assumed; // guarded at loop head, 0 if trace writes it before reading
+    uint8_t known; // type at instruction being translated, 0 if unknown
+};
+
+// leaving trace, shared by all jumps with same state
+struct _jit_trace_exit {
+    uint32_t pc;
+    int32_t eval; // eval stack length relative to loop head, or _jit_trace_kept if already set by _jit_step
+    uint8_t status;
+    bool miss; // rejected at loop head, counted into trace's misses
+    uint32_t position;
+};
+
+    #define _jit_trace_kept INT32_MIN
+
+struct _jit_tracer {
+    struct _jit_assembler a;
+    struct _jit_trace *trace;
+    int32_t low; // eval stack range used, relative to loop head
+    int32_t high;
+    uint8_t *known; // types of eval stack values indexed by offset - low, 0 if unknown
+    struct {
+        struct _jit_trace_slot *base;
+        uint32_t length;
+        uint32_t capacity;
+    } slots;
+    struct {
+        uint16_t *base; // largest slot index used at each depth, indexed by frame
+        uint32_t length;
+        uint32_t capacity;
+    } frames;
+    uint8_t depths[256]; // frame + 1 of each depth, 0 if not used
+    struct {
+        struct _jit_trace_exit *base;
+        uint32_t length;
+        uint32_t capacity;
+    } exits;
+};
+
+static uint8_t *_jit_trace_compile(struct js_vm *, struct _jit_trace *, struct _jit_trace_step *, uint32_t);
+
+// called by recorder at loop head, executes one iteration by _jit_step while recording it, returns like machine code
+// if iteration comes back to head with same frames and eval stack, its trace becomes entry of head, and js_run enters it at once
+static uint8_t _jit_trace_record(struct js_vm *vm) {
+    struct {
+        struct _jit_trace_step *base;
+        uint32_t length;
+        uint32_t capacity;
+    } steps = {0};
+    struct _jit_trace_step step;
+    struct js_instruction *instruction;
+    struct _jit_trace *trace;
+    uint32_t head = vm->pc;
+    uint16_t frames = vm->stack.length, eval = vm->eval_stack.length;
+    uint8_t status = _jit_left;
+    for (;;) {
+        instruction = vm->decoded.base + vm->pc;
+        if (_jit_is_exit(instruction->opcode) || steps.length == _jit_max_trace) {
+            break; // js_run continues from here
+        }
+        step = (struct _jit_trace_step){.index = vm->pc, .before = (int32_t)vm->eval_stack.length - eval, .frames = (uint16_t)(vm->stack.length - frames)};
+        _operand_types(vm, instruction, step.types);
+        vm->pc++;
+        if (instruction->opcode == op_jump) {
+            step.taken = true;
+            vm->pc = instruction->operands[0].value_uint32;
+        } else {
+            switch (_jit_step(vm, instruction)) {
+            case _jit_thrown:
+                status = _jit_left_thrown;
+                goto end_of_recording;
+            case _jit_taken:
+                step.taken = true;
+                vm->pc = instruction->operands[instruction->opcode == op_catch ? 1 : 0].value_uint32;
+                break;
+            default:
+                break;
+            }
+        }
+        step.after = (int32_t)vm->eval_stack.length - eval;
+        step.framing = vm->stack.length != frames + step.frames;
+        buffer_push(steps.base, steps.length, steps.capacity, step);
+        if (vm->stack.length < frames || vm->pc >= vm->decoded.length) { // frames at loop head are part of what trace is specialized for
+            break;
+        }
+        if (vm->pc == head) {
+            if (vm->eval_stack.length == eval && vm->stack.length == frames) {
+                trace = alloc(struct _jit_trace, 1);
+                enforce(trace != NULL);
+                if ((vm->jit->sites.base[head].entry = _jit_trace_compile(vm, trace, steps.base, steps.length)) != NULL) {
+                    vm->jit->sites.base[head].trace = trace;
+                } else {
+                    free(trace);
+                }
+            }
+            status = _jit_left_back; // looked up again, enters trace, or compiles baseline code
+            break;
+        }
+    }
+end_of_recording:
+    buffer_free(steps.base, steps.length, steps.capacity);
+    return status;
+}
+
+static void _jit_trace_exit(struct _jit_tracer *t, uint8_t condition, uint32_t pc, int32_t eval, uint8_t status, bool miss) {
+    uint32_t i;
+    for (i = 0; i < t->exits.length; i++) {
+        struct _jit_trace_exit *exit = t->exits.base + i;
+        if (exit->pc == pc && exit->eval == eval && exit->status == status && exit->miss == miss) {
+            break;
+        }
+    }
+    if (i == t->exits.length) {
+        buffer_push(t->exits.base, t->exits.length, t->exits.capacity, ((struct _jit_trace_exit){.pc = pc, .eval = eval, .status = status, .miss = miss}));
+    }
+    _jit_jump(&t->a, condition, jf_side_exit, i);
+}
+
+// displacement from r13 of eval stack value at offset relative to loop head
+static int32_t _jit_trace_eval(int32_t offset) {
+    return offset * _jit_value_size;
+}
+
+static uint8_t *_jit_trace_known(struct _jit_tracer *t, int32_t offset) {
+    return t->known + (offset - t->low);
+}
+
+static uint16_t _jit_trace_slot_index(struct js_instruction *instruction) {
+    return instruction->opcode == op_slot_update ? (uint16_t)(instruction->operands[1].value_uint32 & UINT16_MAX) : instruction->operands[1].value_uint16;
+}
+
+// slot of frame existing at loop head, NULL if its frame is pushed inside iteration
+static struct _jit_trace_slot *_jit_trace_slot(struct _jit_tracer *t, struct _jit_trace_step *step) {
+    struct js_instruction *instruction = t->a.vm->decoded.base + step->index;
+    uint16_t slot = _jit_trace_slot_index(instruction);
+    uint8_t depth;
+    if (instruction->operands[0].value_uint8 < step->frames) {
+        return NULL;
+    }
+    depth = (uint8_t)(instruction->operands[0].value_uint8 - step->frames);
+    buffer_for_each(t->slots.base, t->slots.length, t->slots.capacity, i, record, {
+        if (record->depth == depth && record->slot == slot) {
+            return record;
+        }
+    });
+    if (t->depths[depth] == 0) {
+        buffer_push(t->frames.base, t->frames.length, t->frames.capacity, 0);
+        t->depths[depth] = (uint8_t)t->frames.length;
+    }
+    if (t->frames.base[t->depths[depth] - 1] < slot) {
+        t->frames.base[t->depths[depth] - 1] = slot;
+    }
+    buffer_push(t->slots.base, t->slots.length, t->slots.capacity, ((struct _jit_trace_slot){.depth = depth, .slot = slot, .frame = (uint8_t)(t->depths[depth] - 1)}));
+    return t->slots.base + t->slots.length - 1;
+}
+
+// r10 = slots base of frame pushed inside iteration, returns displacement of slot's value, leaves if slot is not declared
+static int32_t _jit_trace_inner_slot(struct _jit_tracer *t, struct _jit_trace_step *step) {
+    struct _jit_assembler *a = &t->a;
+    struct js_instruction *instruction = a->vm->decoded.base + step->index;
+    uint16_t slot = _jit_trace_slot_index(instruction);
+    int32_t disp = (int32_t)(slot * sizeof(struct js_slot) + offsetof(struct js_slot, value));
+    _jit_mem(a, 0, false, 0x0fb7, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, stack.length)); // movzx eax, word, frames are as recorded
+    _jit_reg(a, 0, false, 0x81, 5, jr_rax); // sub eax, depth + 1
+    _jit_imm32(a, (uint32_t)instruction->operands[0].value_uint8 + 1);
+    _jit_reg(a, 0, true, 0x69, jr_rax, jr_rax);
+    _jit_imm32(a, sizeof(struct js_stack_frame));
+    _jit_mem(a, 0, true, 0x03, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, stack.base));
+    _jit_mem(a, 0, false, 0x0fb7, jr_rcx, jr_rax, (int32_t)offsetof(struct js_stack_frame, slots.length));
+    _jit_reg(a, 0, false, 0x81, 7, jr_rcx); // cmp ecx, slot
+    _jit_imm32(a, slot);
+    _jit_trace_exit(t, jc_be, step->index, step->before, _jit_left, false);
+    _jit_mem(a, 0, true, 0x8b, jr_r10, jr_rax, (int32_t)offsetof(struct js_stack_frame, slots.base));
+    _jit_mem(a, 0, false, 0x80, 7, jr_r10, disp + _jit_type); // cmp byte, 0
+    _jit_byte(a, 0);
+    _jit_trace_exit(t, jc_e, step->index, step->before, _jit_left, false);
+    return disp;
+}
+
+// r10 = slots base of slot's frame, returns displacement of slot's value
+static int32_t _jit_trace_slot_base(struct _jit_tracer *t, struct _jit_trace_slot *record) {
+    _jit_mem(&t->a, 0, true, 0x8b, jr_r10, jr_rsp, record->frame * 8); // mov r10, [rsp + frame * 8]
+    return (int32_t)(record->slot * sizeof(struct js_slot) + offsetof(struct js_slot, value));
+}
+
+// makes type of value known, guarded against what was recorded, false if recorded type is not wanted
+static bool _jit_trace_expect(struct _jit_tracer *t, struct _jit_trace_step *step, uint8_t *known, uint8_t base, int32_t disp, uint8_t recorded, uint8_t wanted) {
+    if (recorded != wanted && wanted != 0) {
+        return false;
+    }
+    if (*known == recorded) {
+        return true;
+    }
+    if (*known != 0 || recorded == 0) {
+        return false;
+    }
+    _jit_mem(&t->a, 0, false, 0x80, 7, base, disp + _jit_type); // cmp byte, imm8
+    _jit_byte(&t->a, recorded);
+    _jit_trace_exit(t, jc_ne, step->index, step->before, _jit_left, false);
+    *known = recorded;
+    return true;
+}
+
+static bool _jit_trace_is_numeric(uint8_t type) {
+    return type == vt_integer || type == vt_number;
+}
+
+// xmm = value of known numeric type
+static void _jit_trace_load_double(struct _jit_tracer *t, uint8_t xmm, uint8_t type, uint8_t base, int32_t disp) {
+    _jit_mem(&t->a, 0xf2, false, type == vt_integer ? 0x0f2a : 0x0f10, xmm, base, disp + _jit_payload); // cvtsi2sd or movsd
+}
+
+// whole instruction by _jit_step, eval stack length is stored first, everything it may change is forgotten
+static void _jit_trace_call_step(struct _jit_tracer *t, struct _jit_trace_step *step) {
+    struct js_instruction *instruction = t->a.vm->decoded.base + step->index;
+    struct _jit_assembler *a = &t->a;
+    int32_t offset;
+    _jit_mem(a, 0, false, 0x8d, jr_rax, jr_r14, step->before); // lea eax, [r14 + before]
+    _jit_mem(a, 0x66, false, 0x89, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.length)); // mov word, ax
+    _jit_reg(a, 0, true, 0x89, jr_rbx, jr_rdi); // mov rdi, rbx
+    _jit_mov_imm64(a, jr_rsi, (uint64_t)(uintptr_t)instruction);
+    _jit_mov_imm64(a, jr_rax, (uint64_t)(uintptr_t)_jit_step);
+    _jit_reg(a, 0, false, 0xff, 2, jr_rax); // call rax
+    _jit_reg(a, 0, false, 0x84, jr_rax, jr_rax); // test al, al
+    _jit_trace_exit(t, jc_e, step->index + 1, _jit_trace_kept, _jit_left_thrown, false);
+    switch (instruction->opcode) {
+    case op_compare_jump:
+    case op_jump_if_false:
+    case op_jump_if_true:
+    case op_and:
+    case op_or:
+    case op_for_in_next:
+    case op_for_of_next:
+    case op_catch:
+        _jit_byte(a, 0x3c); // cmp al, imm8
+        _jit_byte(a, _jit_taken);
+        _jit_trace_exit(t, step->taken ? jc_ne : jc_e, step->taken ? step->index + 1 : instruction->operands[instruction->opcode == op_catch ? 1 : 0].value_uint32, _jit_trace_kept, _jit_left, false);
+        break;
+    default:
+        break;
+    }
+    for (offset = max(min(step->before, step->after) - 3, t->low); offset <= t->high; offset++) {
+        *_jit_trace_known(t, offset) = 0;
+    }
+    switch (instruction->opcode) {
+    case op_slot_declare: // into frame on top
+        if (step->frames > 0) {
+            break;
+        }
+        // fallthrough
+    case op_variable_declare:
+    case op_variable_delete:
+    case op_variable_put:
+    case op_slot_put: // looks up by name if slot is not declared
+    case op_slot_update:
+    case op_slot_increment:
+    case op_slot_decrement:
+        buffer_for_each(t->slots.base, t->slots.length, t->slots.capacity, i, record, record->known = 0);
+        break;
+    default:
+        break;
+    }
+}
+
+// add, sub, mul and div of numbers, result is stored into lhs, false if not specialized
+// integer overflow becomes double in place, as _arithmetic does, so result type is known only if no overflow is possible
+static bool _jit_trace_arithmetic(struct _jit_tracer *t, struct _jit_trace_step *step, uint8_t opcode, uint8_t lhs_base, int32_t lhs, uint8_t lhs_type, uint8_t rhs_base, int32_t rhs, uint8_t rhs_type, uint8_t *type) {
+    struct _jit_assembler *a = &t->a;
+    uint16_t instruction = opcode == op_add ? 0x0f58 : opcode == op_sub ? 0x0f5c : opcode == op_mul ? 0x0f59 : 0x0f5e; // addsd, subsd, mulsd, divsd
+    uint32_t to_overflow, to_store, to_done;
+    if (lhs_type == vt_integer && rhs_type == vt_integer) {
+        if (opcode == op_div) { // may stay integer, decided by _integer_arithmetic
+            return false;
+        }
+        _jit_mem(a, 0, false, 0x8b, jr_rax, lhs_base, lhs + _jit_payload); // mov eax, lhs
+        _jit_mem(a, 0, false, opcode == op_add ? 0x03 : opcode == op_sub ? 0x2b : 0x0faf, jr_rax, rhs_base, rhs + _jit_payload); // add, sub, imul eax, rhs
+        to_overflow = _jit_local(a, jc_o);
+        if (opcode == op_mul) { // -0 is double
+            _jit_reg(a, 0, false, 0x85, jr_rax, jr_rax); // test eax, eax
+            to_store = _jit_local(a, jc_ne);
+            _jit_mem(a, 0, false, 0x8b, jr_rcx, lhs_base, lhs + _jit_payload);
+            _jit_mem(a, 0, false, 0x0b, jr_rcx, rhs_base, rhs + _jit_payload); // or ecx, rhs
+            _jit_trace_exit(t, jc_s, step->index, step->before, _jit_left, false);
+            _jit_here(a, to_store);
+        }
+        _jit_mem(a, 0, false, 0x89, jr_rax, lhs_base, lhs + _jit_payload);
+        to_done = _jit_local(a, jc_always);
+        _jit_here(a, to_overflow);
+        _jit_trace_load_double(t, 0, vt_integer, lhs_base, lhs);
+        _jit_trace_load_double(t, 1, vt_integer, rhs_base, rhs);
+        _jit_reg(a, 0xf2, false, instruction, 0, 1);
+        _jit_mem(a, 0xf2, false, 0x0f11, 0, lhs_base, lhs + _jit_payload); // movsd lhs, xmm0
+        _jit_mem(a, 0, false, 0xc6, 0, lhs_base, lhs + _jit_type);
+        _jit_byte(a, vt_number);
+        _jit_here(a, to_done);
+        *type = 0;
+        return true;
+    }
+    _jit_trace_load_double(t, 0, lhs_type, lhs_base, lhs);
+    _jit_trace_load_double(t, 1, rhs_type, rhs_base, rhs);
+    _jit_reg(a, 0xf2, false, instruction, 0, 1); // xmm0 op= xmm1
+    _jit_mem(a, 0xf2, false, 0x0f11, 0, lhs_base, lhs + _jit_payload);
+    if (lhs_type != vt_number) {
+        _jit_mem(a, 0, false, 0xc6, 0, lhs_base, lhs + _jit_type); // mov byte, imm8
+        _jit_byte(a, vt_number);
+    }
+    *type = vt_number;
+    return true;
+}
+
+// compares lhs and rhs on eval stack, returns condition which means true, jc_always if not specialized
+static uint8_t _jit_trace_compare(struct _jit_tracer *t, struct _jit_trace_step *step, uint8_t opcode, int32_t offset) {
+    static const uint8_t integer_conditions[] = {[op_eq] = jc_e, [op_ne] = jc_ne, [op_lt] = jc_l, [op_le] = jc_le, [op_gt] = jc_g, [op_ge] = jc_ge};
+    struct _jit_assembler *a = &t->a;
+    int32_t lhs = _jit_trace_eval(offset - 2), rhs = _jit_trace_eval(offset - 1);
+    uint8_t *lhs_known = _jit_trace_known(t, offset - 2), *rhs_known = _jit_trace_known(t, offset - 1);
+    bool swap;
+    if (step->types[0] == vt_integer && step->types[1] == vt_integer) {
+        if (!_jit_trace_expect(t, step, lhs_known, jr_r13, lhs, step->types[0], vt_integer) || !_jit_trace_expect(t, step, rhs_known, jr_r13, rhs, step->types[1], vt_integer)) {
+            return jc_always;
+        }
+        _jit_mem(a, 0, false, 0x8b, jr_rax, jr_r13, lhs + _jit_payload);
+        _jit_mem(a, 0, false, 0x3b, jr_rax, jr_r13, rhs + _jit_payload); // cmp eax, rhs
+        return integer_conditions[opcode];
+    }
+    // identity of doubles is bitwise, see js_is_identical
+    if (opcode == op_eq || opcode == op_ne || !_jit_trace_is_numeric(step->types[0]) || !_jit_trace_is_numeric(step->types[1])) {
+        return jc_always;
+    }
+    if (!_jit_trace_expect(t, step, lhs_known, jr_r13, lhs, step->types[0], 0) || !_jit_trace_expect(t, step, rhs_known, jr_r13, rhs, step->types[1], 0)) {
+        return jc_always;
+    }
+    // ucomisd sets flags like unsigned compare, and unordered always fails 'a' and 'ae'
+    swap = opcode == op_lt || opcode == op_le;
+    _jit_trace_load_double(t, 0, swap ? *rhs_known : *lhs_known, jr_r13, swap ? rhs : lhs);
+    _jit_trace_load_double(t, 1, swap ? *lhs_known : *rhs_known, jr_r13, swap ? lhs : rhs);
+    _jit_reg(a, 0x66, false, 0x0f2e, 0, 1); // ucomisd xmm0, xmm1
+    return opcode == op_lt || opcode == op_gt ? jc_a : jc_ae;
+}
+
+// remembered bit of managed value's first byte, its position is up to compiler
+static uint8_t _jit_remembered_mask(void) {
+    struct js_managed_value managed = {0};
+    managed.remembered = 1;
+    return *(uint8_t *)&managed;
+}
+
+// same for in_use bit
+static uint8_t _jit_in_use_mask(void) {
+    struct js_managed_value managed = {0};
+    managed.in_use = 1;
+    return *(uint8_t *)&managed;
+}
+
+// array[integer] = value, appending only if there is capacity, otherwise _jit_step does it, so does young value into old array for write barrier unless it is remembered below index
+// and old value or scripture into marked array, which may need shading or marking its atom while collecting incrementally
+static bool _jit_trace_array_put(struct _jit_tracer *t, struct _jit_trace_step *step, int32_t offset) {
+    struct _jit_assembler *a = &t->a;
+    int32_t container = _jit_trace_eval(offset - 3), selector = _jit_trace_eval(offset - 2), value = _jit_trace_eval(offset - 1);
+    uint8_t known = *_jit_trace_known(t, offset - 1);
+    uint32_t to_null = 0, to_slow, to_overflow, to_full, to_store, to_copy = 0, to_done, to_old_value, to_young_array, to_remember = 0, to_lower = 0, to_checked, to_marked = 0;
+    if (step->types[2] == vt_null || step->types[2] == vt_undefined || known == vt_null) { // null deletes element
+        return false;
+    }
+    if (!_jit_trace_expect(t, step, _jit_trace_known(t, offset - 3), jr_r13, container, step->types[0], vt_array) || !_jit_trace_expect(t, step, _jit_trace_known(t, offset - 2), jr_r13, selector, step->types[1], vt_integer)) {
+        return false;
+    }
+    if (known == 0) { // such as arithmetic result which may have overflowed
+        _jit_mem(a, 0, false, 0x80, 7, jr_r13, value + _jit_type); // cmp byte, imm8
+        _jit_byte(a, vt_null);
+        to_null = _jit_local(a, jc_be);
+    }
+    _jit_mem(a, 0, true, 0x8b, jr_rax, jr_r13, container + _jit_payload); // mov rax, managed
+    _jit_mem(a, 0, true, 0x63, jr_rcx, jr_r13, selector + _jit_payload); // movsxd rcx, index
+    if (known == 0 || js_is_managed(known) || known == vt_scripture) { // young if in nursery's aligned block, payload of other types may look so too but only goes slower, scripture into marked array needs its atom marked
+        _jit_mem(a, 0, true, 0x8b, jr_rdx, jr_r13, value + _jit_payload);
+        _jit_reg(a, 0, true, 0x81, 4, jr_rdx); // and rdx, imm32
+        _jit_imm32(a, (uint32_t)~(js_nursery_size - 1));
+        _jit_mem(a, 0, true, 0x3b, jr_rdx, jr_rbx, (int32_t)offsetof(struct js_vm, heap.nursery)); // cmp rdx, nursery
+        to_old_value = _jit_local(a, jc_ne);
+        _jit_reg(a, 0, true, 0x8b, jr_rdx, jr_rax); // mov rdx, rax
+        _jit_reg(a, 0, true, 0x81, 4, jr_rdx);
+        _jit_imm32(a, (uint32_t)~(js_nursery_size - 1));
+        _jit_mem(a, 0, true, 0x3b, jr_rdx, jr_rbx, (int32_t)offsetof(struct js_vm, heap.nursery));
+        to_young_array = _jit_local(a, jc_e);
+        _jit_mem(a, 0, false, 0xf6, 0, jr_rax, 0); // test byte [rax], imm8
+        _jit_byte(a, _jit_remembered_mask());
+        to_remember = _jit_local(a, jc_e);
+        _jit_mem(a, 0, true, 0x3b, jr_rcx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.remembered_from)); // negative goes slow later
+        to_lower = _jit_local(a, jc_b);
+        to_checked = _jit_local(a, jc_always);
+        _jit_here(a, to_old_value);
+        _jit_mem(a, 0, false, 0xf6, 0, jr_rax, 0); // test byte [rax], imm8
+        _jit_byte(a, _jit_in_use_mask());
+        to_marked = _jit_local(a, jc_ne);
+        _jit_here(a, to_young_array);
+        _jit_here(a, to_checked);
+    }
+    _jit_reg(a, 0, true, 0x85, jr_rcx, jr_rcx); // test rcx, rcx
+    to_slow = _jit_local(a, jc_s);
+    _jit_mem(a, 0, true, 0x3b, jr_rcx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.length)); // cmp rcx, length
+    to_store = _jit_local(a, jc_b);
+    to_overflow = _jit_local(a, jc_a);
+    _jit_mem(a, 0, true, 0x3b, jr_rcx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.capacity)); // append, cmp rcx, capacity
+    to_full = _jit_local(a, jc_ae);
+    _jit_mem(a, 0, true, 0x8d, jr_rdx, jr_rcx, 1); // lea rdx, [rcx + 1]
+    _jit_mem(a, 0, true, 0x89, jr_rdx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.length));
+    _jit_here(a, to_store);
+    _jit_reg(a, 0, true, 0x69, jr_rcx, jr_rcx); // imul rcx, rcx, imm32
+    _jit_imm32(a, (uint32_t)_jit_value_size);
+    _jit_mem(a, 0, true, 0x03, jr_rcx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.base)); // add rcx, base
+    if (known == 0) {
+        _jit_mem(a, 0, false, 0x80, 7, jr_r13, value + _jit_type);
+        _jit_byte(a, vt_integer);
+        to_copy = _jit_local(a, jc_ne);
+    }
+    if (known == 0 || known == vt_integer) { // elements are normalized
+        _jit_trace_load_double(t, 0, vt_integer, jr_r13, value);
+        _jit_mem(a, 0xf2, false, 0x0f11, 0, jr_rcx, _jit_payload);
+        _jit_mem(a, 0, false, 0xc6, 0, jr_rcx, _jit_type);
+        _jit_byte(a, vt_number);
+    }
+    if (known == 0) {
+        to_done = _jit_local(a, jc_always);
+        _jit_here(a, to_copy);
+        _jit_copy_value(a, jr_rcx, 0, jr_r13, value);
+        _jit_here(a, to_done);
+    } else if (known != vt_integer) {
+        _jit_copy_value(a, jr_rcx, 0, jr_r13, value);
+    }
+    to_done = _jit_local(a, jc_always);
+    if (known == 0) {
+        _jit_here(a, to_null);
+    }
+    _jit_here(a, to_slow);
+    _jit_here(a, to_overflow);
+    _jit_here(a, to_full);
+    if (to_remember) {
+        _jit_here(a, to_remember);
+        _jit_here(a, to_lower);
+        _jit_here(a, to_marked);
+    }
+    _jit_trace_call_step(t, step);
+    _jit_here(a, to_done);
+    *_jit_trace_known(t, offset - 3) = vt_array;
+    return true;
+}
+
+// array[integer] within length, others leave
+static bool _jit_trace_array_get(struct _jit_tracer *t, struct _jit_trace_step *step, int32_t offset) {
+    struct _jit_assembler *a = &t->a;
+    int32_t container = _jit_trace_eval(offset - 2), selector = _jit_trace_eval(offset - 1);
+    uint32_t to_done;
+    if (!_jit_trace_expect(t, step, _jit_trace_known(t, offset - 2), jr_r13, container, step->types[0], vt_array) || !_jit_trace_expect(t, step, _jit_trace_known(t, offset - 1), jr_r13, selector, step->types[1], vt_integer)) {
+        return false;
+    }
+    _jit_mem(a, 0, true, 0x8b, jr_rax, jr_r13, container + _jit_payload);
+    _jit_mem(a, 0, true, 0x63, jr_rcx, jr_r13, selector + _jit_payload);
+    _jit_mem(a, 0, true, 0x3b, jr_rcx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.length)); // unsigned, so negative is above too
+    _jit_trace_exit(t, jc_ae, step->index, step->before, _jit_left, false);
+    _jit_reg(a, 0, true, 0x69, jr_rcx, jr_rcx);
+    _jit_imm32(a, (uint32_t)_jit_value_size);
+    _jit_mem(a, 0, true, 0x03, jr_rcx, jr_rax, (int32_t)offsetof(struct js_managed_value, array.base));
+    _jit_copy_value(a, jr_r13, container, jr_rcx, 0);
+    _jit_reg(a, 0, false, 0x84, jr_r8, jr_r8); // test r8b, r8b, hole reads as null
+    to_done = _jit_local(a, jc_ne);
+    _jit_mem(a, 0, false, 0xc6, 0, jr_r13, container + _jit_type);
+    _jit_byte(a, vt_null);
+    _jit_here(a, to_done);
+    *_jit_trace_known(t, offset - 2) = 0;
+    return true;
+}
+
+static void _jit_trace_translate(struct _jit_tracer *t, struct _jit_trace_step *step) {
+    struct js_instruction *instruction = t->a.vm->decoded.base + step->index;
+    struct _decoded_operand *operands = instruction->operands;
+    struct _jit_assembler *a = &t->a;
+    struct _jit_trace_slot *record;
+    struct js_value literal;
+    uint64_t payload;
+    int32_t offset = step->before, disp;
+    uint8_t opcode, type, condition;
+    if (step->framing) {
+        _jit_trace_call_step(t, step);
+        return;
+    }
+    switch (instruction->opcode) {
+    case op_nop:
+    case op_jump:
+        return;
+    case op_stack_push:
+        if (operands[0].value_uint8 != sf_value || !(operands[1].type == opd_null || operands[1].type == opd_boolean || operands[1].type == opd_double || (operands[1].type == opd_string && instruction->cache.literal.type != 0))) {
+            break;
+        }
+        literal = operands[1].type == opd_null ? js_null() : operands[1].type == opd_boolean ? js_boolean(operands[1].value_bool) : instruction->cache.literal;
+        memcpy(&payload, (uint8_t *)&literal + _jit_payload, sizeof(payload));
+        _jit_mem(a, 0, false, 0xc6, 0, jr_r13, _jit_trace_eval(offset) + _jit_type);
+        _jit_byte(a, literal.type);
+        _jit_mov_imm64(a, jr_rax, payload);
+        _jit_mem(a, 0, true, 0x89, jr_rax, jr_r13, _jit_trace_eval(offset) + _jit_payload);
+        *_jit_trace_known(t, offset) = literal.type;
+        return;
+    case op_stack_pop: // only values, as no frame is popped
+        return;
+    case op_stack_dupe:
+        _jit_copy_value(a, jr_r13, _jit_trace_eval(offset), jr_r13, _jit_trace_eval(offset - 1 - operands[0].value_uint8));
+        *_jit_trace_known(t, offset) = *_jit_trace_known(t, offset - 1 - operands[0].value_uint8);
+        return;
+    case op_slot_get:
+        if ((record = _jit_trace_slot(t, step)) == NULL) {
+            disp = _jit_trace_inner_slot(t, step);
+            _jit_copy_value(a, jr_r13, _jit_trace_eval(offset), jr_r10, disp);
+            *_jit_trace_known(t, offset) = 0;
+            return;
+        }
+        disp = _jit_trace_slot_base(t, record);
+        if (!_jit_trace_expect(t, step, &record->known, jr_r10, disp, step->types[0], 0)) {
+            break;
+        }
+        _jit_copy_value(a, jr_r13, _jit_trace_eval(offset), jr_r10, disp);
+        *_jit_trace_known(t, offset) = record->known;
+        return;
+    case op_slot_put:
+        if ((record = _jit_trace_slot(t, step)) == NULL) {
+            disp = _jit_trace_inner_slot(t, step);
+            _jit_copy_value(a, jr_r10, disp, jr_r13, _jit_trace_eval(offset - 1));
+            return;
+        }
+        disp = _jit_trace_slot_base(t, record);
+        if (record->known == 0) { // not declared, or deleted, _jit_step looks it up by name
+            if (step->types[0] == vt_undefined) {
+                break;
+            }
+            _jit_mem(a, 0, false, 0x80, 7, jr_r10, disp + _jit_type);
+            _jit_byte(a, vt_undefined);
+            _jit_trace_exit(t, jc_e, step->index, step->before, _jit_left, false);
+        }
+        _jit_copy_value(a, jr_r10, disp, jr_r13, _jit_trace_eval(offset - 1));
+        record->known = *_jit_trace_known(t, offset - 1);
+        return;
+    case op_slot_increment:
+    case op_slot_decrement:
+        if ((record = _jit_trace_slot(t, step)) == NULL) {
+            break;
+        }
+        disp = _jit_trace_slot_base(t, record);
+        if (!_jit_trace_expect(t, step, &record->known, jr_r10, disp, step->types[0], vt_integer)) {
+            break;
+        }
+        _jit_mem(a, 0, false, 0x8b, jr_rax, jr_r10, disp + _jit_payload);
+        _jit_reg(a, 0, false, 0x81, instruction->opcode == op_slot_increment ? 0 : 5, jr_rax); // add or sub eax, 1
+        _jit_imm32(a, 1);
+        _jit_trace_exit(t, jc_o, step->index, step->before, _jit_left, false);
+        _jit_mem(a, 0, false, 0x89, jr_rax, jr_r10, disp + _jit_payload);
+        return;
+    case op_slot_update:
+        opcode = (uint8_t)(operands[1].value_uint32 >> 16);
+        if ((record = _jit_trace_slot(t, step)) == NULL) {
+            break;
+        }
+        disp = _jit_trace_slot_base(t, record);
+        if ((opcode != op_add && opcode != op_sub && opcode != op_mul && opcode != op_div) || !_jit_trace_is_numeric(step->types[0]) || !_jit_trace_is_numeric(step->types[1])) {
+            break;
+        }
+        if (!_jit_trace_expect(t, step, &record->known, jr_r10, disp, step->types[0], 0) || !_jit_trace_expect(t, step, _jit_trace_known(t, offset - 1), jr_r13, _jit_trace_eval(offset - 1), step->types[1], 0)) {
+            break;
+        }
+        if (!_jit_trace_arithmetic(t, step, opcode, jr_r10, disp, record->known, jr_r13, _jit_trace_eval(offset - 1), step->types[1], &type)) {
+            break;
+        }
+        record->known = type;
+        return;
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_div:
+        if (!_jit_trace_is_numeric(step->types[0]) || !_jit_trace_is_numeric(step->types[1])) {
+            break;
+        }
+        if (!_jit_trace_expect(t, step, _jit_trace_known(t, offset - 2), jr_r13, _jit_trace_eval(offset - 2), step->types[0], 0) || !_jit_trace_expect(t, step, _jit_trace_known(t, offset - 1), jr_r13, _jit_trace_eval(offset - 1), step->types[1], 0)) {
+            break;
+        }
+        if (!_jit_trace_arithmetic(t, step, instruction->opcode, jr_r13, _jit_trace_eval(offset - 2), step->types[0], jr_r13, _jit_trace_eval(offset - 1), step->types[1], &type)) {
+            break;
+        }
+        *_jit_trace_known(t, offset - 2) = type;
+        return;
+    case op_mod: // non negative integers
+        if (!_jit_trace_expect(t, step, _jit_trace_known(t, offset - 2), jr_r13, _jit_trace_eval(offset - 2), step->types[0], vt_integer) || !_jit_trace_expect(t, step, _jit_trace_known(t, offset - 1), jr_r13, _jit_trace_eval(offset - 1), step->types[1], vt_integer)) {
+            break;
+        }
+        _jit_mem(a, 0, false, 0x8b, jr_rax, jr_r13, _jit_trace_eval(offset - 2) + _jit_payload);
+        _jit_reg(a, 0, false, 0x85, jr_rax, jr_rax);
+        _jit_trace_exit(t, jc_s, step->index, step->before, _jit_left, false);
+        _jit_mem(a, 0, false, 0x8b, jr_rcx, jr_r13, _jit_trace_eval(offset - 1) + _jit_payload);
+        _jit_reg(a, 0, false, 0x85, jr_rcx, jr_rcx);
+        _jit_trace_exit(t, jc_le, step->index, step->before, _jit_left, false);
+        _jit_byte(a, 0x99); // cdq
+        _jit_reg(a, 0, false, 0xf7, 7, jr_rcx); // idiv ecx
+        _jit_mem(a, 0, false, 0x89, jr_rdx, jr_r13, _jit_trace_eval(offset - 2) + _jit_payload);
+        return;
+    case op_eq:
+    case op_ne:
+    case op_lt:
+    case op_le:
+    case op_gt:
+    case op_ge:
+        if ((condition = _jit_trace_compare(t, step, instruction->opcode, offset)) == jc_always) {
+            break;
+        }
+        _jit_reg(a, 0, false, 0x0f90 | condition, 0, jr_rax); // setcc al
+        _jit_reg(a, 0, false, 0x0fb6, jr_rax, jr_rax); // movzx eax, al
+        _jit_mem(a, 0, false, 0xc6, 0, jr_r13, _jit_trace_eval(offset - 2) + _jit_type);
+        _jit_byte(a, vt_boolean);
+        _jit_mem(a, 0, true, 0x89, jr_rax, jr_r13, _jit_trace_eval(offset - 2) + _jit_payload);
+        *_jit_trace_known(t, offset - 2) = vt_boolean;
+        return;
+    case op_compare_jump: // jumps if false
+        if (operands[1].value_uint8 < op_eq || operands[1].value_uint8 > op_ge || (condition = _jit_trace_compare(t, step, operands[1].value_uint8, offset)) == jc_always) {
+            break;
+        }
+        if (step->taken) {
+            _jit_trace_exit(t, condition, step->index + 1, step->after, _jit_left, false);
+        } else {
+            _jit_trace_exit(t, condition ^ 1, operands[0].value_uint32, step->after, _jit_left, false);
+        }
+        return;
+    case op_jump_if_false:
+    case op_jump_if_true:
+        if (!_jit_trace_expect(t, step, _jit_trace_known(t, offset - 1), jr_r13, _jit_trace_eval(offset - 1), step->types[0], vt_boolean)) {
+            break;
+        }
+        _jit_mem(a, 0, false, 0x80, 7, jr_r13, _jit_trace_eval(offset - 1) + _jit_payload); // cmp byte, 0
+        _jit_byte(a, 0);
+        // jumps if zero for op_jump_if_false, leaves if that is not what was recorded
+        condition = (instruction->opcode == op_jump_if_false) == step->taken ? jc_ne : jc_e;
+        _jit_trace_exit(t, condition, step->taken ? step->index + 1 : operands[0].value_uint32, step->after, _jit_left, false);
+        return;
+    case op_member_get:
+        if (step->types[0] == vt_array && _jit_trace_array_get(t, step, offset)) {
+            return;
+        }
+        break;
+    case op_member_put:
+        if (step->types[0] == vt_array && _jit_trace_array_put(t, step, offset)) {
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    _jit_trace_call_step(t, step);
+}
+
+// returns machine code entered at loop head, or NULL if arena is full
+static uint8_t *_jit_trace_compile(struct js_vm *vm, struct _jit_trace *trace, struct _jit_trace_step *steps, uint32_t length) {
+    struct _jit_tracer t = {.a = {.vm = vm}, .trace = trace};
+    struct _jit_assembler *a = &t.a;
+    struct js_instruction *instruction;
+    uint32_t frame_size, guards, body, epilogue, destination, rel;
+    uint8_t *base;
+    bool stable = true;
+    for (uint32_t i = 0; i < length; i++) {
+        t.low = min(t.low, min(steps[i].before, steps[i].after));
+        t.high = max(t.high, max(steps[i].before, steps[i].after));
+        instruction = vm->decoded.base + steps[i].index;
+        switch (instruction->opcode) {
+        case op_slot_get:
+        case op_slot_put:
+        case op_slot_update:
+        case op_slot_increment:
+        case op_slot_decrement: {
+            uint32_t slots = t.slots.length;
+            struct _jit_trace_slot *record = _jit_trace_slot(&t, steps + i);
+            if (t.slots.length > slots && instruction->opcode != op_slot_put) { // read before written
+                record->assumed = steps[i].types[0];
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    t.known = alloc(uint8_t, (size_t)(t.high - t.low + 1));
+    enforce(t.known != NULL);
+    frame_size = (t.frames.length + 1) / 2 * 16; // keeps stack aligned for calls
+    // entry, r13 = eval stack at loop head, r14d = its length, slots bases are saved on machine stack
+    _jit_byte(a, 0x55); // push rbp
+    _jit_byte(a, 0x41); // push r13
+    _jit_byte(a, 0x55);
+    _jit_byte(a, 0x41); // push r14
+    _jit_byte(a, 0x56);
+    _jit_byte(a, 0x41); // push r15
+    _jit_byte(a, 0x57);
+    _jit_reg(a, 0, true, 0x81, 5, jr_rsp); // sub rsp, imm32
+    _jit_imm32(a, frame_size);
+    _jit_mem(a, 0, false, 0x0fb7, jr_r14, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.length)); // movzx r14d, word
+    _jit_reg(a, 0, false, 0x81, 7, jr_r14); // cmp r14d, imm32
+    _jit_imm32(a, (uint32_t)(vm->eval_stack.capacity - t.high));
+    _jit_trace_exit(&t, jc_a, steps[0].index, 0, _jit_left, true);
+    _jit_reg(a, 0, false, 0x81, 7, jr_r14);
+    _jit_imm32(a, (uint32_t)-t.low);
+    _jit_trace_exit(&t, jc_b, steps[0].index, 0, _jit_left, true);
+    _jit_reg(a, 0, true, 0x69, jr_r13, jr_r14); // imul r13, r14, imm32
+    _jit_imm32(a, (uint32_t)_jit_value_size);
+    _jit_reg(a, 0, true, 0x01, jr_r12, jr_r13); // add r13, r12
+    for (uint32_t depth = 0; depth < countof(t.depths); depth++) {
+        if (t.depths[depth] == 0) {
+            continue;
+        }
+        _jit_mem(a, 0, false, 0x0fb7, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, stack.length)); // movzx eax, word
+        _jit_reg(a, 0, false, 0x81, 5, jr_rax); // sub eax, depth + 1
+        _jit_imm32(a, depth + 1);
+        _jit_trace_exit(&t, jc_b, steps[0].index, 0, _jit_left, true);
+        _jit_reg(a, 0, true, 0x69, jr_rax, jr_rax);
+        _jit_imm32(a, sizeof(struct js_stack_frame));
+        _jit_mem(a, 0, true, 0x03, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, stack.base));
+        _jit_mem(a, 0, false, 0x0fb7, jr_rcx, jr_rax, (int32_t)offsetof(struct js_stack_frame, slots.length));
+        _jit_reg(a, 0, false, 0x81, 7, jr_rcx); // cmp ecx, largest slot
+        _jit_imm32(a, t.frames.base[t.depths[depth] - 1]);
+        _jit_trace_exit(&t, jc_be, steps[0].index, 0, _jit_left, true);
+        _jit_mem(a, 0, true, 0x8b, jr_rdx, jr_rax, (int32_t)offsetof(struct js_stack_frame, slots.base));
+        _jit_mem(a, 0, true, 0x89, jr_rdx, jr_rsp, (t.depths[depth] - 1) * 8);
+    }
+    // types of slots which loop carries, also checked when coming back from loop end if they are not proven
+    guards = a->code.length;
+    buffer_for_each(t.slots.base, t.slots.length, t.slots.capacity, i, record, {
+        if (record->assumed != 0) {
+            int32_t disp = _jit_trace_slot_base(&t, record);
+            _jit_mem(a, 0, false, 0x80, 7, jr_r10, disp + _jit_type);
+            _jit_byte(a, record->assumed);
+            _jit_trace_exit(&t, jc_ne, steps[0].index, 0, _jit_left, true);
+        }
+    });
+    body = a->code.length;
+    buffer_for_each(t.slots.base, t.slots.length, t.slots.capacity, i, record, record->known = record->assumed);
+    for (uint32_t i = 0; i < length; i++) {
+        _jit_trace_translate(&t, steps + i);
+    }
+    buffer_for_each(t.slots.base, t.slots.length, t.slots.capacity, i, record, {
+        if (record->assumed != 0 && record->known != record->assumed) {
+            stable = false;
+        }
+    });
+    _jit_test_due(a);
+    _jit_trace_exit(&t, jc_ne, steps[0].index, 0, _jit_left_back, false);
+    _jit_byte(a, 0xe9); // jmp rel32 back to body, or to guards if loop carried slot types are not proven
+    _jit_imm32(a, (stable ? body : guards) - (a->code.length + 4));
+    for (uint32_t i = 0; i < t.exits.length; i++) {
+        struct _jit_trace_exit *exit = t.exits.base + i;
+        exit->position = a->code.length;
+        if (exit->eval != _jit_trace_kept) {
+            _jit_mem(a, 0, false, 0x8d, jr_rax, jr_r14, exit->eval); // lea eax, [r14 + eval]
+            _jit_mem(a, 0x66, false, 0x89, jr_rax, jr_rbx, (int32_t)offsetof(struct js_vm, eval_stack.length));
+        }
+        if (exit->miss) {
+            _jit_mov_imm64(a, jr_rax, (uint64_t)(uintptr_t)&(trace->misses));
+            _jit_mem(a, 0, false, 0x83, 0, jr_rax, 0); // add dword, 1
+            _jit_byte(a, 1);
+        }
+        _jit_mem(a, 0, false, 0xc7, 0, jr_rbx, (int32_t)offsetof(struct js_vm, pc)); // mov dword, imm32
+        _jit_imm32(a, exit->pc);
+        _jit_byte(a, 0xb8); // mov eax, imm32
+        _jit_imm32(a, exit->status);
+        _jit_jump(a, jc_always, jf_epilogue, 0);
+    }
+    epilogue = a->code.length;
+    _jit_reg(a, 0, true, 0x81, 0, jr_rsp); // add rsp, imm32
+    _jit_imm32(a, frame_size);
+    _jit_byte(a, 0x41); // pop r15
+    _jit_byte(a, 0x5f);
+    _jit_byte(a, 0x41); // pop r14
+    _jit_byte(a, 0x5e);
+    _jit_byte(a, 0x41); // pop r13
+    _jit_byte(a, 0x5d);
+    _jit_byte(a, 0x5d); // pop rbp
+    _jit_reg(a, 0, true, 0x83, 0, jr_rsp); // add rsp, 8, then same as trampoline's
+    _jit_byte(a, 8);
+    _jit_byte(a, 0x41); // pop r12
+    _jit_byte(a, 0x5c);
+    _jit_byte(a, 0x5b); // pop rbx
+    _jit_byte(a, 0xc3); // ret
+    buffer_for_each(a->fixups.base, a->fixups.length, a->fixups.capacity, i, fixup, {
+        destination = fixup->kind == jf_epilogue ? epilogue : t.exits.base[fixup->target].position;
+        rel = destination - (fixup->position + 4);
+        memcpy(a->code.base + fixup->position, &rel, 4);
+    });
+    base = _jit_install(vm, a);
+    buffer_free(a->code.base, a->code.length, a->code.capacity);
+    buffer_free(a->fixups.base, a->fixups.length, a->fixups.capacity);
+    buffer_free(t.slots.base, t.slots.length, t.slots.capacity);
+    buffer_free(t.frames.base, t.frames.length, t.frames.capacity);
+    buffer_free(t.exits.base, t.exits.length, t.exits.capacity);
+    free(t.known);
+    return base;
+}
+
+// machine code embeds instruction addresses, so it is dropped when decoded stream moves or is truncated
+static void _jit_flush(struct js_vm *vm) {
+    struct js_jit *jit = vm->jit;
+    if (jit == NULL) {
+        return;
+    }
+    if (jit->code.base) {
+        munmap(jit->code.base, jit->code.capacity);
+    }
+    jit->code.base = NULL;
+    jit->code.length = 0;
+    jit->code.capacity = 0;
+    jit->recorder = NULL;
+    buffer_for_each(jit->sites.base, jit->sites.length, jit->sites.capacity, i, site, free(site->trace));
+    buffer_free(jit->sites.base, jit->sites.length, jit->sites.capacity);
+    jit->decoded_base = vm->decoded.base;
+}
+
+// counts calls and backward jumps at vm->pc, returns machine code to enter, or NULL to keep interpreting
+static uint8_t *_jit_lookup(struct js_vm *vm, uint8_t reason) {
+    struct js_jit *jit = vm->jit;
+    struct _jit_site *site;
+    if (vm->jit_disabled || vm->profiling || vm->pc >= vm->decoded.length) {
+        return NULL;
+    }
+    if (jit == NULL) {
+        jit = vm->jit = alloc(struct js_jit, 1);
+        enforce(jit != NULL);
+        jit->decoded_base = vm->decoded.base;
+    }
+    if (jit->decoded_base != vm->decoded.base) {
+        _jit_flush(vm);
+    }
+    if (jit->sites.length < vm->decoded.length) {
+        buffer_alloc(jit->sites.base, jit->sites.length, jit->sites.capacity, vm->decoded.length);
+        jit->sites.length = vm->decoded.length;
+    }
+    site = jit->sites.base + vm->pc;
+    if (site->trace != NULL && site->trace->misses > _jit_trace_misses) { // types keep changing at loop head, generic code fits better
+        free(site->trace);
+        site->trace = NULL;
+        site->entry = NULL;
+    }
+    if (site->entry || reason == _jit_on_resume || site->calls == UINT16_MAX) {
+        return site->entry;
+    }
+    if (reason == _jit_on_call ? ++site->calls < _jit_call_threshold : ++site->loops < _jit_loop_threshold) {
+        return NULL;
+    }
+    if (reason == _jit_on_loop && !site->traced) { // one iteration is recorded first, baseline code is compiled only if it can not be traced
+        site->traced = true;
+        if (_jit_reserve(vm)) {
+            return jit->recorder;
+        }
+    }
+    if ((site->entry = _jit_compile(vm, vm->pc)) == NULL) {
+        site->calls = site->loops = UINT16_MAX;
+    }
+    return site->entry;
+}
+
+// runs until machine code leaves, vm->pc is where js_run continues
+// leaving by a backward jump counts as loop back edge, so a loop whose head is before its entry region is compiled as a whole
+static struct js_result _jit_execute(struct js_vm *vm, uint8_t *entry) {
+    uint8_t left;
+    while ((left = ((uint8_t (*)(struct js_vm *, uint8_t *))vm->jit->code.base)(vm, entry)) == _jit_left_back) {
+        _safe_point(vm);
+        if ((entry = _jit_lookup(vm, _jit_on_loop)) == NULL) {
+            break;
+        }
+    }
+    if (left == _jit_left_thrown) {
+        js_throw(vm->jit->error);
+    }
+    js_return(js_null());
+}
+
+static void _jit_free(struct js_vm *vm) {
+    _jit_flush(vm);
+    free(vm->jit);
+    vm->jit = NULL;
+}
+
+#else
+
+static uint8_t *_jit_lookup(struct js_vm *vm, uint8_t reason) {
+    (void)vm;
+    (void)reason;
+    return NULL;
+}
+
+static struct js_result _jit_execute(struct js_vm *vm, uint8_t *entry) {
+    (void)vm;
+    (void)entry;
+    js_return(js_null());
+}
+
+static void _jit_flush(struct js_vm *vm) {
+    (void)vm;
+}
+
+static void _jit_free(struct js_vm *vm) {
+    (void)vm;
+}
+
+#endif
+
+struct js_result js_run(struct js_vm *vm) {
+    struct js_instruction *instruction;
+    struct js_stack_frame *frame;
+    struct js_value value;
+    struct js_result result;
+    bool yes = false;
+    uint32_t curr_offset;
+    uint8_t *entry;
+#define __debug() \
+    do { \
+        printf("%-24s\n", _opcode_names[instruction->opcode]); \
+        js_dump_vm(vm); \
+    } while (0)
+#define __operand_offset(__arg_i) (instruction->operands[__arg_i].value_string.base)
+#define __operand_length(__arg_i) (instruction->operands[__arg_i].value_string.length)
+#define __throw(__arg_message) \
+    do { \
+        /* side effect: if __arg_message is _stack_pop_value, it will disappear after _stack_pop_to */ \
+        typeof(__arg_message) __error = js_error(vm, curr_offset, __arg_message); \
+        /* if is in c_function, must exit loop, for example, a 'try' 'c function' function' chain, \
+        function 'throw's, stack will be emptied to 'try' and vm_run will return to c function, \
+        and stack is corrupted now */ \
+        for (; vm->stack.length > 0; _stack_cut(vm, vm->stack.length - 1)) { \
+            frame = _stack_peek(vm, 0); \
+            if (frame->type == sf_try) { \
+                vm->pc = frame->egress; \
+                _stack_cut(vm, vm->stack.length - 1); \
+                _stack_push_value(vm, __error); \
+                goto end_of_while_loop; /* DON'T use 'break' because it may be in another loop */ \
+                /* function != NULL but egress == 0 means called by c function, see js_call() */ \
+            } else if (frame->type == sf_function && frame->egress == 0) { \
+                vm->eval_stack.length = frame->eval_base; \
+                js_throw(__error); \
+            } \
+        } \
+        if (vm->stack.length == 0) { \
+            vm->eval_stack.length = 0; \
+            js_throw(__error); \
+        } \
+    } while (0)
+#define __do_try(__arg_expr) /* if using __try, clang_format will add new line after it */ \
+    do { \
+        result = (__arg_expr); \
+        if (!result.success) { \
+            __throw(result.value); \
+        } \
+    } while (0);
+// safe point, then enter machine code at vm->pc if there is, or if it gets hot now, then continue from where it leaves
+#define __jit(__arg_reason) \
+    do { \
+        _safe_point(vm); \
+        if ((entry = _jit_lookup(vm, __arg_reason)) != NULL) { \
+            result = _jit_execute(vm, entry); \
+            if (!result.success) { \
+                curr_offset = vm->decoded.base[vm->pc - 1].offset; \
+                __throw(result.value); \
+            } \
+        } \
+    } while (0)
+#define __fetch() \
+    do { \
+        instruction = vm->decoded.base + vm->pc++; \
+        curr_offset = instruction->offset; \
+    } while (0)
+#if defined(COMPUTED_GOTO) && defined(__GNUC__)
+    // one indirect jump at the end of each handler instead of shared one, so branch predictor can learn opcode sequences
+    #define X(name) &&handler_##name,
+    static void *const dispatch_table[] = {js_opcode_list};
+    #undef X
+    // while profiling, every opcode goes through handler_profile first, so normal dispatch pays nothing
+    #define X(name) &&handler_profile,
+    static void *const profile_table[] = {js_opcode_list};
+    #undef X
+    void *const *dispatch = vm->profiling ? profile_table : dispatch_table;
+    #define __case(__arg_opcode) handler_##__arg_opcode:
+    #define __next() \
+        do { \
+            if (vm->pc >= vm->decoded.length) { \
+                goto end_of_while_loop; \
+            } \
+            __fetch(); \
+            goto *dispatch[instruction->opcode]; \
+        } while (0)
+    #define __dispatch_begin() __next()
+    #define __dispatch_end() \
+    handler_profile: \
+        _profile(vm, instruction); \
+        goto *dispatch_table[instruction->opcode]; \
+    end_of_while_loop: \
+        if (vm->pc < vm->decoded.length) { \
+            __next(); \
+        }
+#else
+    #define __case(__arg_opcode) case __arg_opcode:
+    #define __next() break
+    #define __dispatch_begin() \
+        while (vm->pc < vm->decoded.length) { \
+            __fetch(); \
+            if (vm->profiling) { \
+                _profile(vm, instruction); \
+            } \
+            switch (instruction->opcode) { \
+            default: \
+                fatal("Unknown opcode %u", instruction->opcode); \
+                break;
+    #define __dispatch_end() \
+        } \
+    end_of_while_loop: \
+        (void)0; \
+        }
+#endif
+    _decode(vm);
+    _stack_reserve(vm);
+    if (vm->heap.threshold == 0) {
+        js_gc_configure(vm, js_gc_default_minimum, js_gc_default_growth);
+    }
+    __dispatch_begin();
+        __case(op_nop)
+            __next();
+        __case(op_stack_push)
+            _handle_stack_push(vm, instruction);
+            __next();
+        __case(op_stack_pop)
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_uint8);
+            _stack_pop(vm, instruction->operands[0].value_uint8);
+            __next();
+        __case(op_variable_declare)
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_string);
+            __do_try(js_declare_variable(vm, __operand_offset(0), __operand_length(0), _stack_pop_value(vm)));
+            __next();
+        __case(op_variable_delete)
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_string);
+            __do_try(js_delete_variable(vm, __operand_offset(0), __operand_length(0)));
+            __next();
+        __case(op_variable_put)
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_string);
+            __do_try(js_put_variable(vm, __operand_offset(0), __operand_length(0), _stack_pop_value(vm)));
+            __next();
+        __case(op_variable_get)
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_string);
+            __do_try(js_get_variable(vm, __operand_offset(0), __operand_length(0)));
+            _stack_push_value(vm, result.value);
+            __next();
+        __case(op_jump)
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_uint32);
+            vm->pc = instruction->operands[0].value_uint32;
+            if (vm->pc < vm->decoded.length && vm->pc <= (uint32_t)(instruction - vm->decoded.base)) { // loop back edge
+                __jit(_jit_on_loop);
+            }
+            __next();
+        __case(op_argument_append) // value::callee(), swap them, then value is above frame
+            _handle_argument_append(vm);
+            __next();
+        __case(op_tail_call)
+            if (_stack_reuse_frame(vm)) {
+                vm->pc = _index_of(vm, _stack_peek(vm, 0)->function->function.ingress);
+                __jit(_jit_on_call);
+                __next();
+            }
+            // otherwise same as op_call, and following op_return does the rest
+        __case(op_call)
+            frame = _stack_peek(vm, 0);
+            enforce(frame->type == sf_function);
+            enforce(frame->eval_height > 0);
+            value = vm->eval_stack.base[frame->eval_height - 1];
+            _stack_bind_arguments(vm, frame);
+            switch (value.type) {
+            case vt_function:
+                frame->function = value.managed; // complete sf_function
+                vm->pc = _index_of(vm, value.managed->function.ingress);
+                __jit(_jit_on_call);
+                // __debug();
+                break;
+            case vt_c_function:
+                for (uint16_t i = 0; i < frame->arguments.length; i++) {
+                    frame->arguments.base[i] = js_normalize(frame->arguments.base[i]);
+                }
+                // result = ((js_c_function_type)value.c_function)(vm, frame->arguments.length, frame->arguments.base);
+                // if (result.success) {
+                //     _stack_pop(vm, 2);
+                //     _stack_push_value(vm, result.value);
+                // } else {
+                //     // exception handling
+                //     __throw(result.value);
+                // }
+                __do_try(((js_c_function_type)value.c_function)(vm, frame->arguments.length, frame->arguments.base));
+                _stack_cut(vm, vm->stack.length - 1); // with values it pinned
+                _stack_pop(vm, 1);
+                _stack_push_value(vm, result.value);
+                // __debug();
+                break;
+            default:
+                fatal("Value type %u is not function", value.type);
+                break;
+            }
+            __next();
+        __case(op_return)
+            if (_stack_is_value_on_top(vm)) {
+                value = _stack_pop_value(vm); // return value
+            } else {
+                value = js_null(); // if there are no return value, return NULL
+            }
+            // DON'T add closure here, for example, returning function is defined outside this function
+            // 'return' may be in deep call stack level, all cleanup
+            _stack_pop_to(vm, sf_function);
+            if (vm->stack.length == 0) {
+                // if there are no stacks, which means 'return' outside function, exit loop
+                js_return(value);
+            } else if (_stack_peek(vm, 0)->egress == 0) {
+                // is called by c function, exit loop
+                _stack_pop(vm, 2); // cleanup
+                js_return(value);
+            } else {
+                // else jump to function egress
+                vm->pc = _stack_peek(vm, 0)->egress;
+                _stack_pop(vm, 2); // cleanup
+                _stack_push_value(vm, value); // push return value
+                __jit(_jit_on_resume); // caller may be machine code
+            }
+            // __debug();
+            __next();
+        __case(op_argument_first)
+            frame = _stack_peek(vm, 0);
+            enforce(frame->type == sf_function);
+            frame->arguments.index = 0;
+            __next();
+        __case(op_argument_get_next)
+            __do_try(_handle_argument_get_next(vm, instruction));
+            __next();
+        __case(op_catch)
+            __do_try(_handle_catch(vm, instruction, &yes));
+            if (yes) { // no exception
+                vm->pc = instruction->operands[1].value_uint32;
+            }
+            __next();
+        __case(op_throw)
+            enforce(instruction->num_operands == 0);
+            __throw(_stack_pop_value(vm));
+            __next();
+        __case(op_member_put)
+            __do_try(_handle_member_put(vm, instruction));
+            __next();
+        __case(op_member_get)
+            __do_try(_handle_member_get(vm, instruction));
+            __next();
+        __case(op_array_append)
+            __do_try(_handle_array_append(vm));
+            __next();
+        __case(op_array_spread)
+            __do_try(_handle_array_spread(vm));
+            __next();
+        __case(op_object_optional)
+            _handle_object_optional(vm, instruction);
+            __next();
+        __case(op_argument_spread)
+            __do_try(_handle_argument_spread(vm));
+            __next();
+        __case(op_argument_get_rest)
+            __do_try(_handle_argument_get_rest(vm, instruction));
+            __next();
+        __case(op_add)
+        __case(op_sub)
+        __case(op_mul)
+        __case(op_pow)
+        __case(op_div)
+        __case(op_mod)
+            __do_try(_handle_binary(vm, instruction->opcode, true));
+            __next();
+        __case(op_eq)
+        __case(op_ne)
+        __case(op_lt)
+        __case(op_le)
+        __case(op_gt)
+        __case(op_ge)
+            __do_try(_handle_binary(vm, instruction->opcode, false));
+            __next();
+        __case(op_and)
+        __case(op_or) // short circuit, rhs is not evaluated if lhs decides result
+            __do_try(_handle_logical(vm, instruction, &yes));
+            if (yes) {
+                vm->pc = instruction->operands[0].value_uint32;
+            }
+            __next();
+        __case(op_not)
+            __do_try(_handle_not(vm));
+            __next();
+        // case op_ternary:
+        //     __rhs = _stack_pop_value(vm);
+        //     __lhs = _stack_pop_value(vm);
+        //     value = _stack_pop_value(vm);
+        //     if (value.type != vt_boolean) {
+        //         __throw(js_scripture_sz("Ternary condition must be boolean"));
+        //     }
+        //     _stack_push_value(vm, value.boolean ? __lhs : __rhs);
+        //     break;
+        __case(op_typeof)
+            _handle_typeof(vm);
+            __next();
+        __case(op_stack_dupe) // duplicate value from stack count from top to down
+            enforce(instruction->num_operands == 1);
+            enforce(instruction->operands[0].type == opd_uint8);
+            _stack_push_value(vm, _stack_peek_value(vm, instruction->operands[0].value_uint8));
+            __next();
+        __case(op_jump_if_false)
+        __case(op_jump_if_true)
+            __do_try(_handle_conditional_jump(vm, instruction, &yes));
+            if (yes) {
+                vm->pc = instruction->operands[0].value_uint32;
+            }
+            __next();
+        __case(op_break)
+            _stack_pop_to(vm, sf_loop);
+            enforce(vm->stack.length > 0);
+            frame = _stack_peek(vm, 0);
+            vm->pc = frame->egress;
+            _stack_pop(vm, 1);
+            __next();
+        __case(op_continue)
+            _stack_pop_to(vm, sf_loop);
+            enforce(vm->stack.length > 0);
+            frame = _stack_peek(vm, 0);
+            vm->pc = frame->ingress;
+            __jit(_jit_on_loop);
+            __next();
+        __case(op_for_in_next) // push next value into stack top
+        __case(op_for_of_next) // push next value into stack top
+            __do_try(_handle_for_next(vm, instruction, &yes));
+            if (yes) {
+                vm->pc = instruction->operands[0].value_uint32;
+            }
+            __next();
+        __case(op_stack_swap)
+            enforce(instruction->num_operands == 2);
+            enforce(instruction->operands[0].type == opd_uint8);
+            enforce(instruction->operands[1].type == opd_uint8);
+            _stack_swap(vm, instruction->operands[0].value_uint8, instruction->operands[1].value_uint8);
+            __next();
+        __case(op_slot_declare)
+            enforce(instruction->num_operands == 2);
+            enforce(instruction->operands[0].type == opd_uint16);
+            enforce(instruction->operands[1].type == opd_string);
+            __do_try(_declare_slot(vm, instruction->operands[0].value_uint16, __operand_offset(1), __operand_length(1), _stack_pop_value(vm)));
+            __next();
+        __case(op_slot_get)
+            __do_try(_handle_slot_get(vm, instruction));
+            __next();
+        __case(op_slot_put)
+            __do_try(_handle_slot_put(vm, instruction));
+            __next();
+        __case(op_closure_capture)
+            _closure_capture(vm, instruction);
+            __next();
+        __case(op_global_put)
+            __do_try(_handle_global_put(vm, instruction));
+            __next();
+        __case(op_global_get)
+            __do_try(_handle_global_get(vm, instruction));
+            __next();
+        __case(op_member_get_const)
+            __do_try(_handle_member_get_const(vm, instruction));
+            __next();
+        __case(op_member_update)
+            __do_try(_handle_member_update(vm, instruction));
+            __next();
+        __case(op_slot_update)
+        __case(op_slot_increment)
+        __case(op_slot_decrement)
+            __do_try(_handle_slot_update(vm, instruction));
+            __next();
+        __case(op_compare_jump)
+            __do_try(_handle_compare_jump(vm, instruction, &yes));
+            if (yes) {
+                vm->pc = instruction->operands[0].value_uint32;
+            }
+            __next();
+    __dispatch_end();
+    js_return(js_null());
+#undef __dispatch_end
+#undef __dispatch_begin
+#undef __next
+#undef __case
+#undef __fetch
+#undef __jit
+#undef __throw
+#undef __operand_0_length
+#undef __operand_0_offset
+#undef __debug
+}
+
+// calls js_mark on everything vm refers to, which may promote young values and update references in place, see js_scavenge
+static void _mark_roots(void *context) {
+    struct js_vm *vm = context;
+    struct js_value function;
+#define __mark_map(__arg_map) \
+    js_map_for_each((__arg_map).base, (__arg_map).length, (__arg_map).capacity, k, kl, v, { \
+        (void)k; \
+        (void)kl; \
+        js_mark(&(vm->heap), v); \
+    })
+    __mark_map(vm->globals);
+    buffer_for_each(vm->eval_stack.base, vm->eval_stack.length, vm->eval_stack.capacity, i, v, js_mark(&(vm->heap), v));
+    _call_stack_for_each(vm, frame, {
+        __mark_map(frame->locals);
+        buffer_for_each(frame->slots.base, frame->slots.length, _, i, slot, js_mark(&(vm->heap), &(slot->value)));
+        if (frame->type == sf_function) {
+            // some anonumous functions which are in use by callee
+            // c function's arguments are on eval stack, marked above
+            if (frame->function != NULL) {
+                function.type = vt_function;
+                function.managed = frame->function;
+                js_mark(&(vm->heap), &function); // with closure
+                frame->function = function.managed;
+            }
+        }
+    });
+#undef __mark_map
+}
+
+// young generation only, values surviving it are promoted, then old generation may reach threshold
+void js_gc_young(struct js_vm *vm) {
+    js_scavenge(&(vm->heap), _mark_roots, vm);
+    vm->heap.due = vm->heap.threshold != SIZE_MAX && js_heap_exhausted(&(vm->heap));
+}
+
+static void _gc_retune(struct js_vm *vm) {
+    if (vm->heap.threshold != 0 && vm->heap.threshold != SIZE_MAX) {
+        vm->heap.threshold = max(vm->heap.minimum, (size_t)((double)vm->heap.length * vm->heap.growth));
+    }
+}
+
+// whole heap, young generation is emptied first so that marking and sweeping only deal with old values
+void js_gc(struct js_vm *vm) {
+    js_gc_young(vm);
+    if (vm->heap.phase != gc_idle) { // incremental collection in progress is abandoned, its marks may be stale
+        buffer_for_each(vm->heap.base, vm->heap.length, vm->heap.capacity, i, v, (*v)->in_use = 0);
+    }
+    _mark_roots(vm);
+    js_sweep(&(vm->heap));
+    _gc_retune(vm);
+    vm->heap.due = false;
+}
+
+// old generation outgrowing threshold times growth before incremental collection is done makes it finish at once
+static void _gc_slice(struct js_vm *vm) {
+    struct js_heap *heap = &(vm->heap);
+    bool hurry = heap->phase != gc_idle && (double)heap->length >= (double)heap->threshold * heap->growth;
+    if (js_collect_slice(heap, _mark_roots, vm, hurry ? 0 : heap->slice_objects, hurry ? 0 : heap->slice_microseconds)) {
+        _gc_retune(vm);
+    }
+}
+
+// collect automatically once heap has minimum managed values, then whenever it grows to survivors times growth, minimum 0 disables
+// new values are allocated in young generation which is collected whenever it is full, only survivors count
+void js_gc_configure(struct js_vm *vm, size_t minimum, double growth) {
+    vm->heap.minimum = minimum;
+    vm->heap.growth = growth > 1 ? growth : js_gc_default_growth;
+    vm->heap.threshold = minimum == 0 ? SIZE_MAX : max(minimum, vm->heap.length);
+    if (minimum != 0) {
+        js_alloc_nursery(&(vm->heap));
+    }
+}
+
+// collect old generation incrementally, a slice at a time whenever a few values are allocated, so pauses are bounded
+// each slice visits at most objects values, or runs at most microseconds, 0 and 0 means collecting whole heap at once
+void js_gc_incremental(struct js_vm *vm, size_t objects, uint32_t microseconds) {
+    vm->heap.slice_objects = objects;
+    vm->heap.slice_microseconds = microseconds;
+}
+
+// same calling convention as op_call: callee, frame, then arguments in place on eval stack
+struct js_result js_call(struct js_vm *vm, struct js_value fv, uint16_t argc, struct js_value *argv) {
+    struct js_stack_frame *frame;
+    _stack_reserve(vm);
+    if (fv.type == vt_function) {
+        // backup stack depth, in callee, may throw error, stack won't be cleaned up, if not cleaned here and return at upper vm's 'op_call', and '__do_try' will check stack and found leftover .egress=0 stack, and exit vm, this shouldn't happen
+        uint16_t stack_length_backup = vm->stack.length;
+        uint16_t eval_stack_length_backup = vm->eval_stack.length;
+        // collection may run at callee's safe points, arguments are copied to eval stack, what calling c function holds else must be pinned, see js_pin
+        _stack_push_value(vm, fv);
+        _stack_push(vm, (struct js_stack_frame){.type = sf_function, .function = fv.managed, .egress = 0}); // 0 indicates called by c function
+        // prepare arguments
+        for (uint16_t i = 0; i < argc; i++) {
+            // js_dump_value(argv + i);
+            // printf("\n");
+            // special treat for vt_undefined from such as array element passed to sort callback
+            _stack_push_value(vm, argv[i].type == 0 ? js_null() : argv[i]);
+        }
+        _stack_bind_arguments(vm, _stack_peek(vm, 0));
+        // backup program counter, jump to function ingress, wait for function completion
+        uint32_t pc_backup = vm->pc;
+        _decode(vm);
+        vm->pc = _index_of(vm, fv.managed->function.ingress);
+        struct js_result result = js_run(vm);
+        result.value = js_normalize(result.value);
+        vm->pc = pc_backup;
+        // restore to backuped stack depth
+        _stack_cut(vm, stack_length_backup);
+        vm->eval_stack.length = eval_stack_length_backup;
+        return result;
+    } else if (fv.type == vt_c_function) {
+        // TODO: still need stack?
+        _stack_push_value(vm, fv);
+        _stack_push(vm, (struct js_stack_frame){.type = sf_function});
+        for (uint16_t i = 0; i < argc; i++) {
+            // is it necessart to special treat for vt_undefined like above? maybe not, c_function can handle it
+            _stack_push_value(vm, argv[i]);
+        }
+        frame = _stack_peek(vm, 0);
+        _stack_bind_arguments(vm, frame);
+        struct js_result result = ((js_c_function_type)fv.c_function)(vm, frame->arguments.length, frame->arguments.base);
+        _stack_cut(vm, vm->stack.length - 1); // with values it pinned
+        _stack_pop(vm, 1);
+        return result;
+    } else {
+        js_throw(js_scripture_sz(&(vm->heap), "Not a function"));
+    }
+}
+
+// c function calling js_call keeps value which it holds meanwhile on eval stack until it returns, collection marks it and updates it if moved
+// so use returned pointer instead of value itself, for example, result array being built by callbacks
+struct js_value *js_pin(struct js_vm *vm, struct js_value value) {
+    _stack_push_value(vm, value);
+    return vm->eval_stack.base + vm->eval_stack.length - 1;
+}
+
+struct js_result js_call_by_name(struct js_vm *vm, const char *name, uint16_t name_length, uint16_t argc, struct js_value *argv) {
+    struct js_result result = js_get_variable(vm, name, name_length);
+    if (!result.success) {
+        return result;
+    }
+    return js_call(vm, result.value, argc, argv);
+}
+
+struct js_value js_c_function(js_c_function_type c_function) {
+    return (struct js_value){.type = vt_c_function, .c_function = c_function};
+}
+
+void js_free_vm(struct js_vm *vm) {
+    buffer_free(vm->bytecode.base, vm->bytecode.length, vm->bytecode.capacity);
+    buffer_free(vm->cross_reference.base, vm->cross_reference.length, vm->cross_reference.capacity);
+    buffer_free(vm->decoded.base, vm->decoded.length, vm->decoded.capacity);
+    buffer_free(vm->decoded.indices.base, vm->decoded.indices.length, vm->decoded.indices.capacity);
+    buffer_free(vm->decoded.member_caches.base, vm->decoded.member_caches.length, vm->decoded.member_caches.capacity);
+    buffer_free(vm->decoded.type_feedback.base, vm->decoded.type_feedback.length, vm->decoded.type_feedback.capacity);
+    _jit_free(vm);
+    js_free_heap(&(vm->heap));
+    js_map_free(vm->globals.base, vm->globals.length, vm->globals.capacity);
+    _stack_cut(vm, 0);
+    buffer_free(vm->stack.base, vm->stack.length, vm->stack.capacity);
+    buffer_free(vm->eval_stack.base, vm->eval_stack.length, vm->eval_stack.capacity);
+    buffer_free(vm->slot_stack.base, vm->slot_stack.length, vm->slot_stack.capacity);
+}
+
+struct js_vm js_static_vm_internal(uint8_t *bc, uint32_t bc_len, uint32_t *xref, uint32_t xref_len) {
+    return (struct js_vm){
+        .bytecode = {
+            .base = bc,
+            .length = bc_len,
+            .capacity = bc_len,
+        },
+        .cross_reference = {
+            .base = xref,
+            .length = xref_len,
+            .capacity = xref_len,
+        },
+    };
+}
+
+void js_declare_argc_argv(struct js_vm *vm, int argc, char *argv[]) {
+    js_declare_variable_sz(vm, "argc", js_number(argc));
+    struct js_value arg_vector = js_array(&(vm->heap));
+    for (int i = 0; i < argc; i++) {
+        js_push_array_element(&(vm->heap), &arg_vector, js_scripture_sz(&(vm->heap), argv[i]));
+    }
+    js_declare_variable_sz(vm, "argv", arg_vector);
+}
+
+int js_default_routine(struct js_vm *vm) {
+    struct js_result result = js_run(vm);
+    result.value = js_normalize(result.value);
+    if (result.success) {
+        switch (result.value.type) {
+        case vt_number:
+            return (int)result.value.number;
+        case vt_boolean:
+            return result.value.boolean ? EXIT_SUCCESS : EXIT_FAILURE;
+        default:
+            return EXIT_SUCCESS;
+        }
+    } else {
+        printf("Runtime Error: ");
+        js_dump_value(&(result.value));
+        printf("\n");
+        return EXIT_FAILURE;
+    }
+}
+
+#ifdef DEBUG
+
+void test_vm_structure_size() {
+    // log_expression("%zu", sizeof(struct js_call_stack_frame));
+    log_expression("%zu", sizeof(struct js_bytecode));
+    log_expression("%zu", sizeof(struct js_cross_reference));
+    log_expression("%zu", sizeof(struct js_stack_frame));
+    log_expression("%zu", sizeof(struct js_vm));
+    log_expression("%zu", sizeof(struct _operand));
+    log_expression("%zu", sizeof(struct _instruction));
+    log_expression("%zu", sizeof(struct js_instruction));
+}
+
+void test_instruction_get_put() {
+    // {
+    //     uint8_t base[] = {
+    //         0b11000000, // nop, null, false, true
+    //         0b00010000,
+    //         0b00000001,
+    //         0b00000000,
+    //         0b00000001,
+    //         0b11000000, // nop, uint8, int32, uint32
+    //         0b01000010,
+    //         0b00000101,
+    //         0b00000000, // uint8
+    //         0b00000000, // int32
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000, // uint32
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         0b11000000, // nop, double, string, function
+    //         0b01110110,
+    //         0b00001000,
+    //         0b00000000, // double
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         0b10000000,
+    //         0b00000101, // string
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //         'h',
+    //         'e',
+    //         'l',
+    //         'l',
+    //         'o',
+    //         0b00000011, // function
+    //         0b00000000,
+    //         0b00000000,
+    //         0b00000000,
+    //     };
+    //     struct js_bytecode bytecode = {
+    //         .base = base,
+    //         .length = countof(base),
+    //         .capacity = countof(base),
+    //     };
+    //     buffer_dump(bytecode.base, bytecode.length, bytecode.capacity);
+    //     js_bytecode_dump(&bytecode);
+    // }
+    {
+        struct js_bytecode bytecode = {0};
+        uint32_t offset = 0;
+        js_put_instruction(&bytecode, &offset, op_nop, 0);
+        js_put_instruction(&bytecode, &offset, op_nop, 1, opd_null);
+        js_put_instruction(&bytecode, &offset, op_nop, 2, opd_boolean, opd_boolean, false, true);
+        js_put_instruction(&bytecode, &offset, op_nop, 3, opd_uint8, opd_uint16, opd_uint32, UINT8_MAX, UINT16_MAX, UINT32_MAX);
+        js_put_instruction(&bytecode, &offset, op_nop, 3, opd_double, opd_string, opd_function, -0.123456, 12, "Hello,World!", 666);
+        buffer_dump(bytecode.base, bytecode.length, bytecode.capacity);
+        js_bytecode_dump(&bytecode);
+    }
+}
+
+void test_vm_run() {
+    struct js_vm vm = {};
+    js_add_instruction(&(vm.bytecode), op_nop, 0);
+    js_add_instruction(&(vm.bytecode), op_stack_push, 2, opd_uint8, opd_boolean, sf_value, false);
+    js_add_instruction(&(vm.bytecode), op_variable_declare, 1, opd_string, 3, "foo");
+    js_add_instruction(&(vm.bytecode), op_stack_push, 2, opd_uint8, opd_double, sf_value, 1.23456);
+    js_add_instruction(&(vm.bytecode), op_variable_declare, 1, opd_string, 3, "bar");
+    js_add_instruction(&(vm.bytecode), op_stack_push, 2, opd_uint8, opd_string, sf_value, 5, "hello");
+    js_add_instruction(&(vm.bytecode), op_variable_declare, 1, opd_string, 3, "baz");
+    js_bytecode_dump(&(vm.bytecode));
+    js_run(&vm);
+    js_dump_vm(&vm);
+}
+
 #endif
\ No newline at end of file
@@ -1,223 +1,317 @@
-/*
-Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
-
-This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
-
-This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
-
-You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
-*/
-
-#ifndef JS_VM_H
-#define JS_VM_H
-
-#include "js-data.h"
-
-// sorted by my programming implementation order
-// first implement hardest function call and exception handling
-#define js_opcode_list \
-    X(op_nop) /* 0 */ \
-    X(op_stack_push) /* vary, frame_type, ... */ \
-    X(op_stack_pop) /* 1, uint8 */ \
-    X(op_variable_declare) /* 1, string */ \
-    X(op_variable_delete) /* 1, string */ \
-    X(op_variable_put) /* 1, string */ \
-    X(op_variable_get) /* 1, string */ \
-    X(op_jump) /* 1, uint32 */ \
-    X(op_argument_append) /* 0 */ \
-    X(op_call) /* 0. callee is function/c_function value on stack top */ \
-    X(op_return) /* 0 */ \
-    /* parameter's default value may be expression, so cannot be put into operand */ \
-    X(op_argument_first) /* 0 */ \
-    X(op_argument_get_next) /* 1, string */ \
-    X(op_catch) /* 2, string, uint32 */ \
-    X(op_throw) /* 0 */ \
-    X(op_member_put) /* 0 */ \
-    X(op_member_get) /* 0 */ \
-    X(op_array_append) /* 0 */ \
-    X(op_array_spread) /* 0 */ \
-    X(op_object_optional) /* 0 */ \
-    X(op_argument_spread) /* 0 */ \
-    X(op_argument_get_rest) /* 1, string */ \
-    X(op_add) /* 0 */ \
-    X(op_sub) /* 0 */ \
-    X(op_mul) /* 0 */ \
-    X(op_pow) /* 0 */ \
-    X(op_div) /* 0 */ \
-    X(op_mod) /* 0 */ \
-    X(op_eq) /* 0 */ \
-    X(op_ne) /* 0 */ \
-    X(op_lt) /* 0 */ \
-    X(op_le) /* 0 */ \
-    X(op_gt) /* 0 */ \
-    X(op_ge) /* 0 */ \
-    X(op_and) /* 0 TODO: optimize for rhs no-exec */ \
-    X(op_or) /* 0 TODO: optimize for rhs no-exec */ \
-    X(op_not) /* 0 */ \
-    /* X(op_ternary) 0 */ \
-    X(op_typeof) /* 0 */ \
-    X(op_stack_dupe) /* 1, uint8, number is relative position from top to down */ \
-    X(op_jump_if_false) /* 1, uint32 */ \
-    X(op_jump_if_true) /* 1, uint32 */ \
-    X(op_break) /* 0 */ \
-    X(op_continue) /* 0 */ \
-    X(op_for_in_next) /* 1, uint32 */ \
-    X(op_for_of_next) /* 1, uint32 */ \
-    X(op_stack_swap) /* 2, uint8, uint8, number is relative position from top to down */
-
-#define X(name) name,
-enum js_opcode { js_opcode_list };
-#undef X
-
-#define js_operand_type_list \
-    X(opd_undefined) /* 0 byte, internal use, for default exception value */ \
-    X(opd_null) /* 0 byte */ \
-    X(opd_empty_array) /* 0 byte */ \
-    X(opd_empty_object) /* 0 byte */ \
-    X(opd_boolean) /* 1 byte */ \
-    X(opd_uint8) /* internal use, for some enums */ \
-    X(opd_uint16) /* internal use */ \
-    X(opd_uint32) /* internal use */ \
-    X(opd_double) /* in msvc "long double" is also 64 bit, so not supported */ \
-    X(opd_string) /* length(u32), ...bytes */ \
-    X(opd_function) /* ingress(u32) */
-
-#define X(name) name,
-enum js_operand_type { js_operand_type_list };
-#undef X
-
-#pragma pack(push, 1)
-struct js_bytecode {
-    uint8_t *base;
-    uint32_t length;
-    uint32_t capacity;
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct js_cross_reference { // source line -> instruction offset, may be NULL if direct run from bytecode
-    uint32_t *base;
-    uint32_t length;
-    uint32_t capacity;
-};
-#pragma pack(pop)
-
-// merge call stack and eval stack together
-// sf_loop is to fit all loops' 'break' 'continue' and 'for' loop's 'let' local scope
-#define js_stack_frame_type_list \
-    X(sf_value) \
-    X(sf_function) \
-    X(sf_try) \
-    X(sf_block) \
-    X(sf_loop)
-
-#define X(name) name,
-enum js_stack_frame_type { js_stack_frame_type_list };
-#undef X
-
-#pragma pack(push, 1)
-struct js_stack_frame {
-    uint8_t type;
-    union {
-        struct js_value value;
-        struct {
-            struct js_variable_map locals;
-            uint32_t egress; // function, try, loop
-            union {
-                uint32_t ingress; // loop
-                struct {
-                    // for function and c_function
-                    // if function, read ingress and closure from *function
-                    // if c_function, only use arguments. egress and *function won't be filled
-                    // due to arguments support spread syntax, number of them cannot be determined at compile time, so hard to put into stack
-                    // TODO: what if number of rest arguments exceeds UINT16MAX?
-                    struct js_managed_value *function;
-                    struct {
-                        struct js_value *base;
-                        uint16_t length;
-                        uint16_t capacity;
-                        uint16_t index; // for parameter's getter operations
-                    } arguments;
-                };
-            };
-        };
-    };
-};
-#pragma pack(pop)
-
-// DON'T seperate bytecode and cross_reference outside this structure, because exception handling need these informations
-#pragma pack(push, 1)
-struct js_vm {
-    struct js_bytecode bytecode;
-    struct js_cross_reference cross_reference;
-    struct js_heap heap;
-    struct js_variable_map globals; // global variables, moved from stk_root
-    // struct {
-    //     struct js_call_stack_frame *base;
-    //     uint16_t length;
-    //     uint16_t capacity;
-    // } call_stack;
-    // struct {
-    //     struct js_value *base;
-    //     uint16_t length;
-    //     uint16_t capacity;
-    // } eval_stack;
-    struct {
-        struct js_stack_frame *base;
-        uint16_t length;
-        uint16_t capacity;
-    } stack;
-    uint32_t pc; // program counter, next instruction offset
-};
-#pragma pack(pop)
-
-shared void js_put_instruction(struct js_bytecode *, uint32_t *, uint8_t, uint8_t, ...);
-shared void js_add_instruction(struct js_bytecode *, uint8_t, uint8_t, ...);
-shared void js_add_cross_reference(struct js_cross_reference *, uint32_t, uint32_t);
-shared void js_bytecode_dump(struct js_bytecode *);
-shared void js_dump_vm(struct js_vm *);
-shared struct js_result js_declare_variable(struct js_vm *, const char *, uint16_t, struct js_value);
-static inline struct js_result js_declare_variable_sz(struct js_vm *vm, const char *name, struct js_value value) {
-    return js_declare_variable(vm, name, (uint16_t)strlen(name), value);
-}
-shared struct js_result js_delete_variable(struct js_vm *, const char *, uint16_t);
-static inline struct js_result js_delete_variable_sz(struct js_vm *vm, const char *name) {
-    return js_delete_variable(vm, name, (uint16_t)strlen(name));
-}
-shared struct js_result js_put_variable(struct js_vm *, const char *, uint16_t, struct js_value);
-static inline struct js_result js_put_variable_sz(struct js_vm *vm, const char *name, struct js_value value) {
-    return js_put_variable(vm, name, (uint16_t)strlen(name), value);
-}
-shared struct js_result js_get_variable(struct js_vm *, const char *, uint16_t);
-static inline struct js_result js_get_variable_sz(struct js_vm *vm, const char *name) {
-    return js_get_variable(vm, name, (uint16_t)strlen(name));
-}
-shared struct js_result js_run(struct js_vm *);
-shared void js_gc(struct js_vm *);
-shared struct js_result js_call(struct js_vm *, struct js_value, uint16_t, struct js_value *);
-shared struct js_result js_call_by_name(struct js_vm *, const char *, uint16_t, uint16_t, struct js_value *);
-static inline struct js_result js_call_by_name_sz(struct js_vm *vm, const char *name, uint16_t argc, struct js_value *argv) {
-    return js_call_by_name(vm, name, (uint16_t)strlen(name), argc, argv);
-}
-typedef struct js_result (*js_c_function_type)(struct js_vm *, uint16_t, struct js_value *);
-shared struct js_value js_c_function(js_c_function_type); // move from js-data to clarify function type
-shared void js_free_vm(struct js_vm *);
-shared struct js_vm js_static_vm_internal(uint8_t *, uint32_t, uint32_t *, uint32_t);
-#define js_static_vm(__arg_bc, __arg_xref) js_static_vm_internal(__arg_bc, (uint32_t)sizeof(__arg_bc), __arg_xref, (uint32_t)sizeof(__arg_xref))
-shared void js_declare_argc_argv(struct js_vm *, int, char *[]);
-shared int js_default_routine(struct js_vm *);
-
-// macros for std functions
-
-#define js_declare_std_function(name) js_declare_variable_sz(vm, #name, js_c_function(js_std_##name))
-#define js_return_null() js_return(js_null())
-
-#ifdef DEBUG
-
-shared void test_vm_structure_size();
-shared void test_instruction_get_put();
-shared void test_vm_run();
-
-#endif
-
+/*
+Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef JS_VM_H
+#define JS_VM_H
+
+#include "js-data.h"
+
+// sorted by my programming implementation order
+// first implement hardest function call and exception handling
+#define js_opcode_list \
+    X(op_nop) /* 0, or 1 uint8 as padding, compiler overwrites elided instructions with it */ \
+    X(op_stack_push) /* vary, frame_type, ... */ \
+    X(op_stack_pop) /* 1, uint8 */ \
+    X(op_variable_declare) /* 1, string */ \
+    X(op_variable_delete) /* 1, string */ \
+    X(op_variable_put) /* 1, string */ \
+    X(op_variable_get) /* 1, string */ \
+    X(op_jump) /* 1, uint32 */ \
+    X(op_argument_append) /* 0, bind value below callee becomes first argument, other arguments are left on eval stack */ \
+    X(op_call) /* 0. callee is function/c_function value below sf_function frame, arguments are above it */ \
+    X(op_return) /* 0 */ \
+    /* parameter's default value may be expression, so cannot be put into operand */ \
+    X(op_argument_first) /* 0 */ \
+    X(op_argument_get_next) /* 2, string, uint16 slot */ \
+    X(op_catch) /* 3, string, uint32, uint16 slot */ \
+    X(op_throw) /* 0 */ \
+    X(op_member_put) /* 0 */ \
+    X(op_member_get) /* 0 */ \
+    X(op_array_append) /* 0 */ \
+    X(op_array_spread) /* 0 */ \
+    X(op_object_optional) /* 0 */ \
+    X(op_argument_spread) /* 0 */ \
+    X(op_argument_get_rest) /* 2, string, uint16 slot */ \
+    X(op_add) /* 0 */ \
+    X(op_sub) /* 0 */ \
+    X(op_mul) /* 0 */ \
+    X(op_pow) /* 0 */ \
+    X(op_div) /* 0 */ \
+    X(op_mod) /* 0 */ \
+    X(op_eq) /* 0 */ \
+    X(op_ne) /* 0 */ \
+    X(op_lt) /* 0 */ \
+    X(op_le) /* 0 */ \
+    X(op_gt) /* 0 */ \
+    X(op_ge) /* 0 */ \
+    X(op_and) /* 1, uint32, if operand is false, keep it as result and jump, otherwise pop it. or 0, last operand, only check */ \
+    X(op_or) /* 1, uint32, if operand is true, keep it as result and jump, otherwise pop it. or 0, last operand, only check */ \
+    X(op_not) /* 0 */ \
+    /* X(op_ternary) 0 */ \
+    X(op_typeof) /* 0 */ \
+    X(op_stack_dupe) /* 1, uint8, number is relative position from top to down */ \
+    X(op_jump_if_false) /* 1, uint32 */ \
+    X(op_jump_if_true) /* 1, uint32 */ \
+    X(op_break) /* 0 */ \
+    X(op_continue) /* 0 */ \
+    X(op_for_in_next) /* 1, uint32 */ \
+    X(op_for_of_next) /* 1, uint32 */ \
+    X(op_stack_swap) /* 2, uint8, uint8, number is relative position from top to down */ \
+    /* lexical addressing, depth is number of scope frames from top, name is for fallback and name based lookup */ \
+    X(op_slot_declare) /* 2, uint16 slot, string name */ \
+    X(op_slot_get) /* 3, uint8 depth, uint16 slot, string name */ \
+    X(op_slot_put) /* 3, uint8 depth, uint16 slot, string name */ \
+    /* name not declared in any enclosing scope, resolved directly in globals with per-instruction cache */ \
+    X(op_global_get) /* 1, string */ \
+    X(op_global_put) /* 1, string */ \
+    /* copy variable used by function on stack top into its closure, slot is used if resolved at compile time */ \
+    X(op_closure_capture) /* 0, 1 or 3, [uint8 depth, uint16 slot,] string name, none means every variable visible */ \
+    /* superinstructions, fused by compiler from common sequences */ \
+    X(op_member_get_const) /* 1, string, object.identifier, key is not pushed */ \
+    X(op_member_update) /* 1, uint8 arithmetic opcode, container[selector] op= value, container is kept like op_member_put */ \
+    X(op_slot_update) /* 3, uint8 depth, uint32 slot | arithmetic opcode << 16, string name, local op= value */ \
+    X(op_slot_increment) /* 3, uint8 depth, uint16 slot, string name, local++ */ \
+    X(op_slot_decrement) /* 3, uint8 depth, uint16 slot, string name, local-- */ \
+    X(op_compare_jump) /* 2, uint32, uint8 relational opcode, compare two values and jump if false */ \
+    /* call ending 'return', rewritten by compiler from op_call */ \
+    X(op_tail_call) /* 0, same as op_call, but reuses caller's sf_function frame if callee can't look up anything there by name, followed by op_return */
+
+#define X(name) name,
+enum js_opcode { js_opcode_list };
+#undef X
+
+#define js_operand_type_list \
+    X(opd_undefined) /* 0 byte, internal use, for default exception value */ \
+    X(opd_null) /* 0 byte */ \
+    X(opd_empty_array) /* 0 byte */ \
+    X(opd_empty_object) /* 0 byte */ \
+    X(opd_boolean) /* 1 byte */ \
+    X(opd_uint8) /* internal use, for some enums */ \
+    X(opd_uint16) /* internal use */ \
+    X(opd_uint32) /* internal use */ \
+    X(opd_double) /* in msvc "long double" is also 64 bit, so not supported */ \
+    X(opd_string) /* length(u32), ...bytes */ \
+    X(opd_function) /* ingress(u32) */
+
+#define X(name) name,
+enum js_operand_type { js_operand_type_list };
+#undef X
+
+#pragma pack(push, 1)
+struct js_bytecode {
+    uint8_t *base;
+    uint32_t length;
+    uint32_t capacity;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct js_cross_reference { // source line -> instruction offset, may be NULL if direct run from bytecode
+    uint32_t *base;
+    uint32_t length;
+    uint32_t capacity;
+};
+#pragma pack(pop)
+
+// call stack and eval stack are seperated, each frame remembers eval stack height when pushed, values above it belong to this frame
+// sf_value is only used by op_stack_push to push value into eval stack, there is no such frame
+// sf_loop is to fit all loops' 'break' 'continue' and 'for' loop's 'let' local scope
+#define js_stack_frame_type_list \
+    X(sf_value) \
+    X(sf_function) \
+    X(sf_try) \
+    X(sf_block) \
+    X(sf_loop)
+
+#define X(name) name,
+enum js_stack_frame_type { js_stack_frame_type_list };
+#undef X
+
+// variable declared by compiler resolved let/parameter, indexed by slot number
+// name points into bytecode, only valid while running, used by closure and name based lookup such as format()
+js_value_pack_push
+struct js_slot {
+    struct js_value value; // undefined means not declared or deleted
+    const char *name;
+    uint16_t name_length;
+};
+js_value_pack_pop
+
+#pragma pack(push, 1)
+struct js_stack_frame {
+    uint8_t type;
+    uint16_t eval_height; // eval stack length when pushed
+    uint16_t eval_base; // values above it are temporaries, equals to eval_height except function's arguments are between them
+    struct js_variable_map locals; // declared by name, such as from c functions
+    struct {
+        struct js_slot *base; // inside vm's slot_stack, frame can only declare when on top, so its slots are on top too
+        uint16_t length;
+    } slots;
+    uint32_t egress; // function, try, loop
+    union {
+        uint32_t ingress; // loop
+        struct {
+            // for function and c_function, callee value is on eval stack just below eval_height
+            // if function, read ingress and closure from *function
+            // if c_function, only use arguments. egress and *function won't be filled
+            // arguments are left in place on eval stack by caller, including spreaded ones, bound at op_call
+            struct js_managed_value *function;
+            struct {
+                struct js_value *base; // inside eval stack
+                uint16_t length;
+                uint16_t index; // for parameter's getter operations
+            } arguments;
+        };
+    };
+};
+#pragma pack(pop)
+
+// fixed width form of bytecode instruction, decoded once at load time, defined in js-vm.c
+struct js_instruction;
+// inline cache of one member access site, defined in js-vm.c
+struct js_member_cache;
+// baseline jit state, hot bytecode translated into machine code, defined in js-vm.c
+struct js_jit;
+
+#define js_type_feedback_targets 4
+
+// what flowed through one instruction while profiling, types are bit masks of 1 << js_value_type
+struct js_type_feedback {
+    uint32_t count; // times executed
+    // arithmetic and comparison: lhs, rhs. member access: container, selector. slot update: slot, value
+    uint16_t operands[2];
+    struct {
+        uint8_t type; // vt_function or vt_c_function, 0 means unused
+        union {
+            uint32_t ingress; // of vt_function
+            void *c_function;
+        };
+        uint32_t count;
+    } targets[js_type_feedback_targets]; // distinct callees of op_call and op_tail_call, in order of first call
+    uint32_t megamorphic; // calls to other callees after targets are full
+};
+
+// baseline jit is only for x86-64 linux, define JS_NO_JIT to leave it out
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(JS_NO_JIT)
+    #define JS_JIT
+#endif
+
+// DON'T seperate bytecode and cross_reference outside this structure, because exception handling need these informations
+#pragma pack(push, 1)
+struct js_vm {
+    struct js_bytecode bytecode;
+    struct js_cross_reference cross_reference;
+    struct js_heap heap;
+    struct js_variable_map globals; // global variables, moved from stk_root
+    uint32_t globals_version; // increased when globals' nodes are added, deleted or moved, validates global caches
+    struct {
+        struct js_stack_frame *base;
+        uint16_t length;
+        uint16_t capacity;
+    } stack; // call stack, function, try, block and loop frames
+    // following two are allocated once with max capacity, never move, so pointers such as c function's arguments are stable
+    struct {
+        struct js_value *base;
+        uint16_t length;
+        uint16_t capacity;
+    } eval_stack; // temporary values and arguments
+    struct {
+        struct js_slot *base;
+        uint16_t length;
+        uint16_t capacity;
+    } slot_stack; // frames' slots
+    uint32_t pc; // program counter, next instruction index of decoded stream
+    struct {
+        struct js_instruction *base;
+        uint32_t length;
+        uint32_t capacity;
+        struct {
+            uint32_t *base; // bytecode offset -> instruction index, UINT32_MAX if not instruction boundary
+            uint32_t length;
+            uint32_t capacity;
+        } indices;
+        uint8_t *bytecode_base; // string operands point into bytecode, must be rebased if it is reallocated
+        struct {
+            struct js_member_cache *base;
+            uint32_t length;
+            uint32_t capacity;
+        } member_caches; // indexed by member access instructions' cache
+        struct {
+            struct js_type_feedback *base; // same index as instructions, grown when profiled
+            uint32_t length;
+            uint32_t capacity;
+        } type_feedback;
+    } decoded; // bytecode is source of truth, this cache is refreshed incrementally when bytecode grows
+    struct js_jit *jit; // NULL until something gets hot
+    bool jit_disabled; // interpret only, may be set before js_run
+    bool profiling; // collect type feedback, interpret only, may be set before js_run
+};
+#pragma pack(pop)
+
+shared void js_put_instruction(struct js_bytecode *, uint32_t *, uint8_t, uint8_t, ...);
+shared void js_add_instruction(struct js_bytecode *, uint8_t, uint8_t, ...);
+shared void js_add_cross_reference(struct js_cross_reference *, uint32_t, uint32_t);
+shared void js_bytecode_dump(struct js_bytecode *);
+shared void js_truncate_bytecode(struct js_vm *, uint32_t);
+shared void js_optimize(struct js_bytecode *, struct js_cross_reference *, uint32_t, uint8_t);
+shared void js_dump_vm(struct js_vm *);
+shared void js_member_cache_dump(struct js_vm *);
+shared struct js_type_feedback *js_type_feedback_at(struct js_vm *, uint32_t);
+shared void js_type_feedback_dump(struct js_vm *);
+shared struct js_result js_declare_variable(struct js_vm *, const char *, uint16_t, struct js_value);
+static inline struct js_result js_declare_variable_sz(struct js_vm *vm, const char *name, struct js_value value) {
+    return js_declare_variable(vm, name, (uint16_t)strlen(name), value);
+}
+shared struct js_result js_delete_variable(struct js_vm *, const char *, uint16_t);
+static inline struct js_result js_delete_variable_sz(struct js_vm *vm, const char *name) {
+    return js_delete_variable(vm, name, (uint16_t)strlen(name));
+}
+shared struct js_result js_put_variable(struct js_vm *, const char *, uint16_t, struct js_value);
+static inline struct js_result js_put_variable_sz(struct js_vm *vm, const char *name, struct js_value value) {
+    return js_put_variable(vm, name, (uint16_t)strlen(name), value);
+}
+shared struct js_result js_get_variable(struct js_vm *, const char *, uint16_t);
+static inline struct js_result js_get_variable_sz(struct js_vm *vm, const char *name) {
+    return js_get_variable(vm, name, (uint16_t)strlen(name));
+}
+shared struct js_result js_run(struct js_vm *);
+shared void js_gc(struct js_vm *);
+shared void js_gc_young(struct js_vm *);
+shared void js_gc_configure(struct js_vm *, size_t, double);
+shared void js_gc_incremental(struct js_vm *, size_t, uint32_t);
+shared struct js_result js_call(struct js_vm *, struct js_value, uint16_t, struct js_value *);
+shared struct js_value *js_pin(struct js_vm *, struct js_value);
+shared struct js_result js_call_by_name(struct js_vm *, const char *, uint16_t, uint16_t, struct js_value *);
+static inline struct js_result js_call_by_name_sz(struct js_vm *vm, const char *name, uint16_t argc, struct js_value *argv) {
+    return js_call_by_name(vm, name, (uint16_t)strlen(name), argc, argv);
+}
+typedef struct js_result (*js_c_function_type)(struct js_vm *, uint16_t, struct js_value *);
+shared struct js_value js_c_function(js_c_function_type); // move from js-data to clarify function type
+shared void js_free_vm(struct js_vm *);
+shared struct js_vm js_static_vm_internal(uint8_t *, uint32_t, uint32_t *, uint32_t);
+#define js_static_vm(__arg_bc, __arg_xref) js_static_vm_internal(__arg_bc, (uint32_t)sizeof(__arg_bc), __arg_xref, (uint32_t)sizeof(__arg_xref))
+shared void js_declare_argc_argv(struct js_vm *, int, char *[]);
+shared int js_default_routine(struct js_vm *);
+
+// macros for std functions
+
+#define js_declare_std_function(name) js_declare_variable_sz(vm, #name, js_c_function(js_std_##name))
+#define js_return_null() js_return(js_null())
+#define js_assert(__arg_expr) js_assert_heap(&(vm->heap), __arg_expr) // where there is no vm, use js_assert_heap
+
+#ifdef DEBUG
+
+shared void test_vm_structure_size();
+shared void test_instruction_get_put();
+shared void test_vm_run();
+
+#endif
+
 #endif
\ No newline at end of file
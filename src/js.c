@@ -1,381 +1,519 @@
-/*
-Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
-
-This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
-
-This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
-
-You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
-*/
-
-#include <time.h>
-#ifdef _WIN32
-    #include <windows.h> // SetConsoleCP SetConsoleOutputCP
-#else
-    #include <readline/history.h>
-    #include <readline/readline.h>
-#endif
-#include "js-syntax.h"
-#include "js-std-lang.h"
-#include "js-std-os.h"
-
-static char *_make_filename_internal(char *filename, const char *suffix, const char *directory) {
-#ifdef _WIN32
-    #define pathsep "\\"
-#else
-    #define pathsep "/"
-#endif
-    char *no_ext = dupe_sz(filename);
-    char *dot = strrchr(no_ext, '.');
-    if (dot) {
-        *dot = '\0';
-    }
-    char *ret = NULL;
-    if (directory) {
-        char *lasesep = strrchr(no_ext, pathsep[0]);
-        char *no_ext_no_dir = lasesep ? lasesep + 1 : no_ext;
-        char *dir_no_trailing = dupe_sz(directory);
-        if (ends_with_sz(dir_no_trailing, pathsep)) {
-            dir_no_trailing[strlen(dir_no_trailing) - 1] = '\0';
-        }
-        ret = concat_sz(dir_no_trailing, pathsep, no_ext_no_dir, suffix);
-        free(dir_no_trailing);
-    } else {
-        ret = concat_sz(no_ext, suffix);
-    }
-    free(no_ext);
-    return ret;
-#undef pathsep
-}
-#define _make_filename(__arg_filename, __arg_suffix, __arg_directory, __arg_result, _arg_statement) \
-    do { \
-        char *__arg_result = _make_filename_internal(__arg_filename, __arg_suffix, __arg_directory); \
-        _arg_statement; \
-        free(__arg_result); \
-    } while (0)
-
-static void _write_compiled(struct js_vm *vm, char *source_filename, const char *directory) {
-    _make_filename(source_filename, "-bc.bin", directory, fname, {
-        write_file(fname, "wb", vm->bytecode.base, vm->bytecode.length, vm->bytecode.capacity);
-        printf("Bytecode written to:\n");
-        printf("    %s\n", fname);
-    });
-    _make_filename(source_filename, "-bc.txt", directory, fname, {
-        open_file(fname, "w", fp, {
-            for (uint32_t i = 0; i < vm->bytecode.length; i++) {
-                fprintf(fp, "0x%.2x, ", vm->bytecode.base[i]);
-            }
-        });
-        printf("    %s\n", fname);
-    });
-    _make_filename(source_filename, "-xref.bin", directory, fname, {
-        write_file(fname, "wb", vm->cross_reference.base, vm->cross_reference.length, vm->cross_reference.capacity);
-        printf("Cross reference written to:\n");
-        printf("    %s\n", fname);
-    });
-    _make_filename(source_filename, "-xref.txt", directory, fname, {
-        open_file(fname, "w", fp, {
-            for (uint32_t i = 0; i < vm->cross_reference.length; i++) {
-                fprintf(fp, "0x%.8x, ", vm->cross_reference.base[i]);
-            }
-        });
-        printf("    %s\n", fname);
-    });
-}
-
-struct js_source source = {0};
-struct js_token token = {0};
-struct js_vm vm = {0};
-
-static int _repl() {
-    struct js_source line = {0};
-    printf("Banana Script REPL environment. Copyright (C) 2024-2025 ShaJunXing\n");
-    printf("Type '/?' for more information.\n\n");
-    for (;;) {
-#ifdef _WIN32
-        printf("> ");
-        read_line(stdin, line.base, line.length, line.capacity);
-#else
-        // disable filename completion
-        rl_bind_key('\t', rl_insert);
-        char *s = readline("> ");
-        string_buffer_append_sz(line.base, line.length, line.capacity, s);
-        free(s);
-        if (line.length > 0) {
-            add_history(line.base);
-        }
-#endif
-        // buffer_dump(line.base, line.length, line.capacity);
-        if (line.length > 0) {
-            if (line.base[0] == '/') {
-#define __line_eq(__arg_0) (strcmp(line.base, (__arg_0)) == 0)
-                if (__line_eq("/?")) {
-                    printf("Enter script statements or following commands:\n");
-                    printf("  /?                       show help\n");
-                    printf("  /d                       dump memory\n");
-                    printf("  /q                       quit program\n");
-                    printf("  /u                       unassemble bytecodes\n");
-                    printf("  /w                       write source and binaries to file\n");
-                    printf("\n");
-                } else if (__line_eq("/d")) {
-                    buffer_dump(source.base, source.length, source.capacity);
-                    buffer_dump(vm.bytecode.base, vm.bytecode.length, vm.bytecode.capacity);
-                    js_dump_vm(&vm);
-                } else if (__line_eq("/q")) {
-                    printf("Bye.\n\n");
-                    exit(EXIT_SUCCESS);
-                } else if (__line_eq("/u")) {
-                    js_bytecode_dump(&(vm.bytecode));
-                } else if (__line_eq("/w")) {
-                    time_t now = time(NULL);
-                    char source_filename[64] = {0};
-                    strftime(source_filename, sizeof(source_filename), "%Y-%m-%d-%H-%M-%S.js", localtime(&now));
-                    write_file(source_filename, "w", source.base, source.length, source.capacity);
-                    printf("Source written to:\n");
-                    printf("    %s\n", source_filename);
-                    _write_compiled(&vm, source_filename, NULL);
-                } else {
-                    printf("Unknown command \"%s\"\n", line.base);
-                }
-#undef __line_eq
-            } else {
-                uint32_t src_len_bak = source.length;
-                struct js_token tok_bak = token;
-                uint32_t bc_len_bak = vm.bytecode.length;
-                uint32_t xref_len_bak = vm.cross_reference.length;
-                uint32_t pc_bak = vm.pc;
-                // concat line to source to make sure next_token works correctly
-                string_buffer_append(source.base, source.length, source.capacity, line.base, line.length);
-                // set from eof state to searching state
-                // token.state = ts_searching;
-                // if runtime error happens, for example, if happens inside a function with no return value need to process, for example, print(...), after op_call there is an op_stack_pop, next statement will continue run at following op_stack_pop will failed because stack has been cleared. there are 2 solution: 1. move vm->pc to the end, 2. rollback
-                bool rollback = false;
-                if (js_compile(&source, &token, &(vm.bytecode), &(vm.cross_reference))) {
-                    // log_debug("OK, %u,%u-%u,%u", token.head_line, token.head_offset, token.tail_line, token.tail_offset);
-                    struct js_result result = js_run(&vm);
-                    if (!result.success) {
-                        printf("Runtime Error: ");
-                        js_dump_value(&(result.value));
-                        printf("\n");
-                        rollback = true;
-                    }
-                    printf("\n");
-                } else {
-                    rollback = true;
-                }
-                if (rollback) {
-                    // log_debug("Failed");
-                    source.length = src_len_bak;
-                    token = tok_bak;
-                    vm.bytecode.length = bc_len_bak;
-                    vm.cross_reference.length = xref_len_bak;
-                    vm.pc = pc_bak;
-                }
-            }
-        }
-        buffer_free(line.base, line.length, line.capacity);
-    }
-    return EXIT_SUCCESS;
-}
-
-static int _help(char *arg_0) {
-    printf("Usage: %s [options] <file1.js> [file2.js] ... [script options]\n", arg_0);
-    printf("\n");
-    printf("If no arguments, enter repl environment.\n");
-    printf("One or more source files can be specified, and will be loaded by order.\n");
-    printf("\n");
-    printf("  -b, --bytecode <filename>\n");
-    printf("                           binary bytecode filename, for input\n");
-    printf("                           required if no source file specified\n");
-    printf("  -c, --compile            compile only\n");
-    printf("  -d, --output-directory <dir>\n");
-    printf("                           change compile output directory\n");
-    printf("  -h, --help               show help\n");
-#ifdef DEBUG
-    printf("  -t, --test               run test suit\n");
-#endif
-    printf("  -u, --unassemble         show disassembly only\n");
-    printf("  -x, --cross-reference <filename>\n");
-    printf("                           binary cross reference filename, for input\n");
-    printf("                           optional required if no source file specified\n");
-    printf("\n");
-    return EXIT_SUCCESS;
-}
-
-#ifdef DEBUG
-
-    #define test_function_list \
-        X(test_random_sz) \
-        X(test_random_double) \
-        X(test_buffer) \
-        X(test_string_buffer) \
-        X(test_string_buffer_loop) \
-        /* X(test_string_buffer_append_f) */ \
-        X(test_memmove) \
-        X(test_string_dupe) \
-        /* X(test_read_file) */ \
-        X(test_read_line) \
-        X(test_natural_compare) \
-        X(test_print_stream) \
-        X(test_regex) \
-        X(test_data_structure_size) \
-        X(test_js_map) \
-        X(test_js_map_loop) \
-        X(test_js_value) \
-        X(test_js_value_loop) \
-        X(test_js_value_bug) \
-        X(test_js_string_family) \
-        X(test_js_string_f) \
-        X(test_vm_structure_size) \
-        X(test_instruction_get_put) \
-        X(test_vm_run) \
-        X(test_lexer) \
-        X(test_parser) \
-        X(test_c_function) \
-        X(test_unescape_string) \
-        X(test_free_vm) \
-        X(test_read_source_file)
-
-    #define X(name) #name,
-static const char *test_function_names[] = {test_function_list};
-    #undef X
-
-    #define X(name) name,
-static const void (*test_functions[])() = {test_function_list};
-    #undef X
-
-static int _test(char *arg_0, int argc, char *argv[]) {
-    int selected_id = argc > 0 ? atoi(argv[0]) : -1;
-    int id;
-    for (id = 0; id < countof(test_functions); id++) {
-        if (selected_id == id) {
-            printf("----> %-34s", test_function_names[id]);
-        } else {
-            printf("%4d. %-34s", id, test_function_names[id]);
-        }
-        if (id % 2 == 1) {
-            printf("\n");
-        }
-    }
-    if (id % 2 == 1) {
-        printf("\n");
-    }
-    if (selected_id >= 0 && selected_id < countof(test_functions)) {
-        srand((unsigned)time(NULL));
-        printf("\n");
-        test_functions[selected_id]();
-        return EXIT_SUCCESS;
-    } else {
-        printf("Usage: %s -t,--test <id>, id must be one of the above\n", arg_0);
-        return EXIT_FAILURE;
-    }
-}
-
-#endif
-
-// #ifdef _WIN32
-//     #include <windows.h>
-// #endif
-
-int main(int argc, char *argv[]) {
-#ifdef _WIN32
-    // Set the output code page to UTF-8
-    SetConsoleOutputCP(CP_UTF8);
-    // Set the input code page to UTF-8
-    SetConsoleCP(CP_UTF8);
-#endif
-    js_declare_argc_argv(&vm, argc, argv);
-    js_declare_std_lang_functions(&vm);
-    js_declare_std_os_functions(&vm);
-    if (argc == 1) { // no arguments, enter repl
-        return _repl();
-    }
-    struct {
-        char **base;
-        size_t length;
-        size_t capacity;
-    } source_filenames = {0};
-    char *bytecode_filename = NULL;
-    char *xref_filename = NULL;
-    char *output_directory = NULL;
-    enum { a_compile,
-        a_run,
-        a_unassemble
-    } action = a_run;
-    int i;
-    for (i = 1; i < argc; i++) {
-#define __next_i \
-    if (++i >= argc) \
-    break
-        if (starts_with_sz(argv[i], "-")) {
-            if (equals_sz(argv[i], "-b") || equals_sz(argv[i], "--bytecode")) {
-                __next_i;
-                bytecode_filename = argv[i];
-            } else if (equals_sz(argv[i], "-c") || equals_sz(argv[i], "--compile")) {
-                action = a_compile;
-            } else if (equals_sz(argv[i], "-d") || equals_sz(argv[i], "--output-directory")) {
-                __next_i;
-                output_directory = argv[i];
-            } else if (equals_sz(argv[i], "-h") || equals_sz(argv[i], "--help")) {
-                return _help(argv[0]);
-#ifdef DEBUG
-            } else if (equals_sz(argv[i], "-t") || equals_sz(argv[i], "--test")) {
-                return _test(argv[0], argc - i - 1, argv + i + 1);
-#endif
-            } else if (equals_sz(argv[i], "-u") || equals_sz(argv[i], "--unassemble")) {
-                action = a_unassemble;
-            } else if (equals_sz(argv[i], "-x") || equals_sz(argv[i], "--cross-reference")) {
-                __next_i;
-                xref_filename = argv[i];
-            } else {
-                // other arguments will be passed to script
-                // fatal("Unknown option: %s", argv[i]);
-            }
-        } else {
-            break;
-        }
-#undef __next_i
-    }
-    for (; i < argc; i++) {
-        if (!starts_with_sz(argv[i], "-") && ends_with_sz(argv[i], ".js")) {
-            buffer_push(source_filenames.base, source_filenames.length, source_filenames.capacity, argv[i]);
-        } else {
-            break;
-        }
-    }
-    // do actions
-    if (source_filenames.base != NULL) {
-        for (size_t i = 0; i < source_filenames.length; i++) {
-            if (!js_read_source_file(&source, source_filenames.base[i])) {
-                return EXIT_FAILURE;
-            }
-        }
-        if (!js_compile(&source, &token, &(vm.bytecode), &(vm.cross_reference))) {
-            return EXIT_FAILURE;
-        }
-    }
-    if (action == a_compile) {
-        if (source_filenames.base == NULL) {
-            fatal("Require source files");
-        }
-        _write_compiled(&vm, source_filenames.base[source_filenames.length - 1], output_directory);
-    } else { // run or unassemble
-        // source.base may be NULL if source file size == 0, so use source_filenames.base to check
-        if (source_filenames.base == NULL) {
-            if (bytecode_filename == NULL) {
-                fatal("If no source files specified, bytecode file is required");
-            } else {
-                read_binary_file(bytecode_filename, vm.bytecode.base, vm.bytecode.length, vm.bytecode.capacity);
-            }
-            if (xref_filename != NULL) {
-                read_binary_file(xref_filename, vm.cross_reference.base, vm.cross_reference.length, vm.cross_reference.capacity);
-            }
-        }
-        if (action == a_run) {
-            return js_default_routine(&vm);
-        } else if (action == a_unassemble) {
-            js_bytecode_dump(&(vm.bytecode));
-        }
-    }
-    return EXIT_SUCCESS;
-}
+/*
+Copyright 2024-2025 ShaJunXing <shajunxing@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <time.h>
+#ifdef _WIN32
+    #include <windows.h> // SetConsoleCP SetConsoleOutputCP
+#else
+    #include <readline/history.h>
+    #include <readline/readline.h>
+#endif
+#include "js-syntax.h"
+#include "js-std-lang.h"
+#include "js-std-os.h"
+#ifdef JS_JIT
+    #include <sys/wait.h> // waitpid
+    #include <unistd.h> // fork pipe dup2
+#endif
+
+static char *_make_filename_internal(char *filename, const char *suffix, const char *directory) {
+#ifdef _WIN32
+    #define pathsep "\\"
+#else
+    #define pathsep "/"
+#endif
+    char *no_ext = dupe_sz(filename);
+    char *dot = strrchr(no_ext, '.');
+    if (dot) {
+        *dot = '\0';
+    }
+    char *ret = NULL;
+    if (directory) {
+        char *lasesep = strrchr(no_ext, pathsep[0]);
+        char *no_ext_no_dir = lasesep ? lasesep + 1 : no_ext;
+        char *dir_no_trailing = dupe_sz(directory);
+        if (ends_with_sz(dir_no_trailing, pathsep)) {
+            dir_no_trailing[strlen(dir_no_trailing) - 1] = '\0';
+        }
+        ret = concat_sz(dir_no_trailing, pathsep, no_ext_no_dir, suffix);
+        free(dir_no_trailing);
+    } else {
+        ret = concat_sz(no_ext, suffix);
+    }
+    free(no_ext);
+    return ret;
+#undef pathsep
+}
+#define _make_filename(__arg_filename, __arg_suffix, __arg_directory, __arg_result, _arg_statement) \
+    do { \
+        char *__arg_result = _make_filename_internal(__arg_filename, __arg_suffix, __arg_directory); \
+        _arg_statement; \
+        free(__arg_result); \
+    } while (0)
+
+static void _write_compiled(struct js_vm *vm, char *source_filename, const char *directory) {
+    _make_filename(source_filename, "-bc.bin", directory, fname, {
+        write_file(fname, "wb", vm->bytecode.base, vm->bytecode.length, vm->bytecode.capacity);
+        printf("Bytecode written to:\n");
+        printf("    %s\n", fname);
+    });
+    _make_filename(source_filename, "-bc.txt", directory, fname, {
+        open_file(fname, "w", fp, {
+            for (uint32_t i = 0; i < vm->bytecode.length; i++) {
+                fprintf(fp, "0x%.2x, ", vm->bytecode.base[i]);
+            }
+        });
+        printf("    %s\n", fname);
+    });
+    _make_filename(source_filename, "-xref.bin", directory, fname, {
+        write_file(fname, "wb", vm->cross_reference.base, vm->cross_reference.length, vm->cross_reference.capacity);
+        printf("Cross reference written to:\n");
+        printf("    %s\n", fname);
+    });
+    _make_filename(source_filename, "-xref.txt", directory, fname, {
+        open_file(fname, "w", fp, {
+            for (uint32_t i = 0; i < vm->cross_reference.length; i++) {
+                fprintf(fp, "0x%.8x, ", vm->cross_reference.base[i]);
+            }
+        });
+        printf("    %s\n", fname);
+    });
+}
+
+struct js_source source = {0};
+struct js_token token = {0};
+struct js_vm vm = {0};
+uint8_t optimize_level = 2;
+
+static int _repl() {
+    struct js_source line = {0};
+    printf("Banana Script REPL environment. Copyright (C) 2024-2025 ShaJunXing\n");
+    printf("Type '/?' for more information.\n\n");
+    for (;;) {
+#ifdef _WIN32
+        printf("> ");
+        read_line(stdin, line.base, line.length, line.capacity);
+#else
+        // disable filename completion
+        rl_bind_key('\t', rl_insert);
+        char *s = readline("> ");
+        string_buffer_append_sz(line.base, line.length, line.capacity, s);
+        free(s);
+        if (line.length > 0) {
+            add_history(line.base);
+        }
+#endif
+        // buffer_dump(line.base, line.length, line.capacity);
+        if (line.length > 0) {
+            if (line.base[0] == '/') {
+#define __line_eq(__arg_0) (strcmp(line.base, (__arg_0)) == 0)
+                if (__line_eq("/?")) {
+                    printf("Enter script statements or following commands:\n");
+                    printf("  /?                       show help\n");
+                    printf("  /d                       dump memory\n");
+                    printf("  /o <level>               set optimize level of following input\n");
+                    printf("  /q                       quit program\n");
+                    printf("  /u                       unassemble bytecodes\n");
+                    printf("  /w                       write source and binaries to file\n");
+                    printf("\n");
+                } else if (__line_eq("/d")) {
+                    buffer_dump(source.base, source.length, source.capacity);
+                    buffer_dump(vm.bytecode.base, vm.bytecode.length, vm.bytecode.capacity);
+                    js_dump_vm(&vm);
+                } else if (starts_with_sz(line.base, "/o ")) {
+                    optimize_level = (uint8_t)atoi(line.base + 3);
+                    printf("Optimize level: %u\n", optimize_level);
+                } else if (__line_eq("/q")) {
+                    printf("Bye.\n\n");
+                    exit(EXIT_SUCCESS);
+                } else if (__line_eq("/u")) {
+                    js_bytecode_dump(&(vm.bytecode));
+                } else if (__line_eq("/w")) {
+                    time_t now = time(NULL);
+                    char source_filename[64] = {0};
+                    strftime(source_filename, sizeof(source_filename), "%Y-%m-%d-%H-%M-%S.js", localtime(&now));
+                    write_file(source_filename, "w", source.base, source.length, source.capacity);
+                    printf("Source written to:\n");
+                    printf("    %s\n", source_filename);
+                    _write_compiled(&vm, source_filename, NULL);
+                } else {
+                    printf("Unknown command \"%s\"\n", line.base);
+                }
+#undef __line_eq
+            } else {
+                uint32_t src_len_bak = source.length;
+                struct js_token tok_bak = token;
+                uint32_t bc_len_bak = vm.bytecode.length;
+                uint32_t xref_len_bak = vm.cross_reference.length;
+                uint32_t pc_bak = vm.pc;
+                // concat line to source to make sure next_token works correctly
+                string_buffer_append(source.base, source.length, source.capacity, line.base, line.length);
+                // set from eof state to searching state
+                // token.state = ts_searching;
+                // if runtime error happens, for example, if happens inside a function with no return value need to process, for example, print(...), after op_call there is an op_stack_pop, next statement will continue run at following op_stack_pop will failed because stack has been cleared. there are 2 solution: 1. move vm->pc to the end, 2. rollback
+                bool rollback = false;
+                if (js_compile(&source, &token, &(vm.bytecode), &(vm.cross_reference))) {
+                    js_optimize(&(vm.bytecode), &(vm.cross_reference), bc_len_bak, optimize_level);
+                    // log_debug("OK, %u,%u-%u,%u", token.head_line, token.head_offset, token.tail_line, token.tail_offset);
+                    struct js_result result = js_run(&vm);
+                    if (!result.success) {
+                        printf("Runtime Error: ");
+                        js_dump_value(&(result.value));
+                        printf("\n");
+                        rollback = true;
+                    }
+                    printf("\n");
+                } else {
+                    rollback = true;
+                }
+                if (rollback) {
+                    // log_debug("Failed");
+                    source.length = src_len_bak;
+                    token = tok_bak;
+                    js_truncate_bytecode(&vm, bc_len_bak);
+                    vm.cross_reference.length = xref_len_bak;
+                    vm.pc = pc_bak;
+                }
+            }
+        }
+        buffer_free(line.base, line.length, line.capacity);
+    }
+    return EXIT_SUCCESS;
+}
+
+#ifdef JS_JIT
+
+// runs program in child process with stdout captured, returns exit code, or -1 if killed
+static int _run_captured(bool jit_disabled, struct js_source *output) {
+    int fds[2], status;
+    char chunk[4096];
+    ssize_t n;
+    pid_t pid;
+    fflush(stdout);
+    if (pipe(fds) != 0 || (pid = fork()) < 0) {
+        fatal("%s", strerror(errno));
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+        vm.jit_disabled = jit_disabled;
+        exit(js_default_routine(&vm));
+    }
+    close(fds[1]);
+    while ((n = read(fds[0], chunk, sizeof(chunk))) > 0) {
+        string_buffer_append(output->base, output->length, output->capacity, chunk, (uint32_t)n);
+    }
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// length of rest of the line, at most 60 characters
+static int _line_length(char *base, uint32_t length) {
+    uint32_t i = 0;
+    while (i < length && i < 60 && base[i] != '\n') {
+        i++;
+    }
+    return (int)i;
+}
+
+// runs program interpreted, then with jit, their outputs and exit codes must be same
+static int _differential() {
+    struct js_source interpreted = {0}, compiled = {0};
+    int interpreted_ret = _run_captured(true, &interpreted);
+    int compiled_ret = _run_captured(false, &compiled);
+    uint32_t i, line = 1;
+    fwrite(interpreted.base, 1, interpreted.length, stdout);
+    fflush(stdout);
+    for (i = 0; i < interpreted.length && i < compiled.length && interpreted.base[i] == compiled.base[i]; i++) {
+        if (interpreted.base[i] == '\n') {
+            line++;
+        }
+    }
+    if (i == interpreted.length && i == compiled.length && interpreted_ret == compiled_ret) {
+        fprintf(stderr, "Differential: same output of %u bytes, exit code %d\n", i, interpreted_ret);
+        return interpreted_ret;
+    }
+    if (i < interpreted.length || i < compiled.length) {
+        fprintf(stderr, "Differential: output differs at line %u byte %u\n", line, i);
+        fprintf(stderr, "    interpreted: %.*s\n", _line_length(interpreted.base + i, interpreted.length - i), interpreted.base + i);
+        fprintf(stderr, "    jit:         %.*s\n", _line_length(compiled.base + i, compiled.length - i), compiled.base + i);
+    }
+    fprintf(stderr, "Differential: exit code %d interpreted, %d jit\n", interpreted_ret, compiled_ret);
+    return EXIT_FAILURE;
+}
+
+#endif
+
+static int _help(char *arg_0) {
+    printf("Usage: %s [options] <file1.js> [file2.js] ... [script options]\n", arg_0);
+    printf("\n");
+    printf("If no arguments, enter repl environment.\n");
+    printf("One or more source files can be specified, and will be loaded by order.\n");
+    printf("\n");
+    printf("  -b, --bytecode <filename>\n");
+    printf("                           binary bytecode filename, for input\n");
+    printf("                           required if no source file specified\n");
+    printf("  -c, --compile            compile only\n");
+    printf("  -d, --output-directory <dir>\n");
+    printf("                           change compile output directory\n");
+    printf("  -f, --type-feedback      profile operand types and call targets, print them with disassembly after run\n");
+    printf("  -g, --gc <minimum>[,<growth>]\n");
+    printf("                           collect young generation whenever it is full, and whole heap once\n");
+    printf("                           old generation has minimum managed values, then whenever it grows\n");
+    printf("                           to survivors times growth, 0 disables both,\n");
+    printf("                           default %d,%g\n", js_gc_default_minimum, js_gc_default_growth);
+    printf("  -h, --help               show help\n");
+    printf("  -i, --incremental <budget>[us]\n");
+    printf("                           collect old generation a slice at a time, each visits budget managed\n");
+    printf("                           values, or runs budget microseconds with suffix 'us', 0 collects at once\n");
+#ifdef JS_JIT
+    printf("  -j, --jit-differential   run interpreted then with jit, compare outputs and exit codes\n");
+#endif
+    printf("  -m, --member-cache       print hit rates of member access inline caches after run\n");
+#ifdef JS_JIT
+    printf("  -n, --no-jit             interpret only, don't compile hot code into machine code\n");
+#endif
+    printf("  -O, --optimize <level>   0 none, 1 fold constants and thread jumps\n");
+    printf("                           2 also remove dead code and fuse sequences, default\n");
+#ifdef DEBUG
+    printf("  -t, --test               run test suit\n");
+#endif
+    printf("  -u, --unassemble         show disassembly only\n");
+    printf("  -x, --cross-reference <filename>\n");
+    printf("                           binary cross reference filename, for input\n");
+    printf("                           optional required if no source file specified\n");
+    printf("\n");
+    return EXIT_SUCCESS;
+}
+
+#ifdef DEBUG
+
+    #define test_function_list \
+        X(test_random_sz) \
+        X(test_random_double) \
+        X(test_buffer) \
+        X(test_string_buffer) \
+        X(test_string_buffer_loop) \
+        /* X(test_string_buffer_append_f) */ \
+        X(test_memmove) \
+        X(test_string_dupe) \
+        /* X(test_read_file) */ \
+        X(test_read_line) \
+        X(test_natural_compare) \
+        X(test_print_stream) \
+        X(test_regex) \
+        X(test_data_structure_size) \
+        X(test_js_map) \
+        X(test_js_map_loop) \
+        X(test_js_value) \
+        X(test_js_value_loop) \
+        X(test_js_value_bug) \
+        X(test_js_string_family) \
+        X(test_js_string_f) \
+        X(test_vm_structure_size) \
+        X(test_instruction_get_put) \
+        X(test_vm_run) \
+        X(test_lexer) \
+        X(test_parser) \
+        X(test_c_function) \
+        X(test_unescape_string) \
+        X(test_free_vm) \
+        X(test_read_source_file)
+
+    #define X(name) #name,
+static const char *test_function_names[] = {test_function_list};
+    #undef X
+
+    #define X(name) name,
+static const void (*test_functions[])() = {test_function_list};
+    #undef X
+
+static int _test(char *arg_0, int argc, char *argv[]) {
+    int selected_id = argc > 0 ? atoi(argv[0]) : -1;
+    int id;
+    for (id = 0; id < countof(test_functions); id++) {
+        if (selected_id == id) {
+            printf("----> %-34s", test_function_names[id]);
+        } else {
+            printf("%4d. %-34s", id, test_function_names[id]);
+        }
+        if (id % 2 == 1) {
+            printf("\n");
+        }
+    }
+    if (id % 2 == 1) {
+        printf("\n");
+    }
+    if (selected_id >= 0 && selected_id < countof(test_functions)) {
+        srand((unsigned)time(NULL));
+        printf("\n");
+        test_functions[selected_id]();
+        return EXIT_SUCCESS;
+    } else {
+        printf("Usage: %s -t,--test <id>, id must be one of the above\n", arg_0);
+        return EXIT_FAILURE;
+    }
+}
+
+#endif
+
+// #ifdef _WIN32
+//     #include <windows.h>
+// #endif
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+    // Set the output code page to UTF-8
+    SetConsoleOutputCP(CP_UTF8);
+    // Set the input code page to UTF-8
+    SetConsoleCP(CP_UTF8);
+#endif
+    js_declare_argc_argv(&vm, argc, argv);
+    js_declare_std_lang_functions(&vm);
+    js_declare_std_os_functions(&vm);
+    if (argc == 1) { // no arguments, enter repl
+        return _repl();
+    }
+    struct {
+        char **base;
+        size_t length;
+        size_t capacity;
+    } source_filenames = {0};
+    char *bytecode_filename = NULL;
+    char *xref_filename = NULL;
+    char *output_directory = NULL;
+    enum { a_compile,
+        a_run,
+        a_unassemble
+    } action = a_run;
+    bool member_cache = false;
+    bool type_feedback = false;
+#ifdef JS_JIT
+    bool differential = false;
+#endif
+    int i;
+    for (i = 1; i < argc; i++) {
+#define __next_i \
+    if (++i >= argc) \
+    break
+        if (starts_with_sz(argv[i], "-")) {
+            if (equals_sz(argv[i], "-b") || equals_sz(argv[i], "--bytecode")) {
+                __next_i;
+                bytecode_filename = argv[i];
+            } else if (equals_sz(argv[i], "-c") || equals_sz(argv[i], "--compile")) {
+                action = a_compile;
+            } else if (equals_sz(argv[i], "-d") || equals_sz(argv[i], "--output-directory")) {
+                __next_i;
+                output_directory = argv[i];
+            } else if (equals_sz(argv[i], "-f") || equals_sz(argv[i], "--type-feedback")) {
+                type_feedback = vm.profiling = true;
+            } else if (equals_sz(argv[i], "-g") || equals_sz(argv[i], "--gc")) {
+                __next_i;
+                char *end;
+                size_t minimum = (size_t)strtoull(argv[i], &end, 10);
+                js_gc_configure(&vm, minimum, *end == ',' ? strtod(end + 1, NULL) : js_gc_default_growth);
+            } else if (equals_sz(argv[i], "-h") || equals_sz(argv[i], "--help")) {
+                return _help(argv[0]);
+            } else if (equals_sz(argv[i], "-i") || equals_sz(argv[i], "--incremental")) {
+                __next_i;
+                char *end;
+                size_t budget = (size_t)strtoull(argv[i], &end, 10);
+                if (equals_sz(end, "us")) {
+                    js_gc_incremental(&vm, 0, (uint32_t)budget);
+                } else {
+                    js_gc_incremental(&vm, budget, 0);
+                }
+#ifdef JS_JIT
+            } else if (equals_sz(argv[i], "-j") || equals_sz(argv[i], "--jit-differential")) {
+                differential = true;
+#endif
+            } else if (equals_sz(argv[i], "-m") || equals_sz(argv[i], "--member-cache")) {
+                member_cache = true;
+            } else if (equals_sz(argv[i], "-n") || equals_sz(argv[i], "--no-jit")) {
+                vm.jit_disabled = true;
+            } else if (equals_sz(argv[i], "-O") || equals_sz(argv[i], "--optimize")) {
+                __next_i;
+                optimize_level = (uint8_t)atoi(argv[i]);
+#ifdef DEBUG
+            } else if (equals_sz(argv[i], "-t") || equals_sz(argv[i], "--test")) {
+                return _test(argv[0], argc - i - 1, argv + i + 1);
+#endif
+            } else if (equals_sz(argv[i], "-u") || equals_sz(argv[i], "--unassemble")) {
+                action = a_unassemble;
+            } else if (equals_sz(argv[i], "-x") || equals_sz(argv[i], "--cross-reference")) {
+                __next_i;
+                xref_filename = argv[i];
+            } else {
+                // other arguments will be passed to script
+                // fatal("Unknown option: %s", argv[i]);
+            }
+        } else {
+            break;
+        }
+#undef __next_i
+    }
+    for (; i < argc; i++) {
+        if (!starts_with_sz(argv[i], "-") && ends_with_sz(argv[i], ".js")) {
+            buffer_push(source_filenames.base, source_filenames.length, source_filenames.capacity, argv[i]);
+        } else {
+            break;
+        }
+    }
+    // do actions
+    if (source_filenames.base != NULL) {
+        for (size_t i = 0; i < source_filenames.length; i++) {
+            if (!js_read_source_file(&source, source_filenames.base[i])) {
+                return EXIT_FAILURE;
+            }
+        }
+        if (!js_compile(&source, &token, &(vm.bytecode), &(vm.cross_reference))) {
+            return EXIT_FAILURE;
+        }
+        js_optimize(&(vm.bytecode), &(vm.cross_reference), 0, optimize_level);
+    }
+    if (action == a_compile) {
+        if (source_filenames.base == NULL) {
+            fatal("Require source files");
+        }
+        _write_compiled(&vm, source_filenames.base[source_filenames.length - 1], output_directory);
+    } else { // run or unassemble
+        // source.base may be NULL if source file size == 0, so use source_filenames.base to check
+        if (source_filenames.base == NULL) {
+            if (bytecode_filename == NULL) {
+                fatal("If no source files specified, bytecode file is required");
+            } else {
+                read_binary_file(bytecode_filename, vm.bytecode.base, vm.bytecode.length, vm.bytecode.capacity);
+            }
+            if (xref_filename != NULL) {
+                read_binary_file(xref_filename, vm.cross_reference.base, vm.cross_reference.length, vm.cross_reference.capacity);
+            }
+        }
+        if (action == a_run) {
+#ifdef JS_JIT
+            if (differential) {
+                return _differential();
+            }
+#endif
+            int ret = js_default_routine(&vm);
+            if (member_cache) {
+                js_member_cache_dump(&vm);
+            }
+            if (type_feedback) {
+                js_type_feedback_dump(&vm);
+            }
+            return ret;
+        } else if (action == a_unassemble) {
+            js_bytecode_dump(&(vm.bytecode));
+        }
+    }
+    return EXIT_SUCCESS;
+}